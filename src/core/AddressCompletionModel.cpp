@@ -31,18 +31,29 @@
 #include <QtCore/QDir>
 #include <QtCore/QFileInfo>
 #include <QtCore/QMimeDatabase>
+#include <QtConcurrent/QtConcurrentRun>
 #include <QtWidgets/QFileIconProvider>
 
 namespace Otter
 {
 
+const int AddressCompletionModel::m_entriesLimit(20);
+
 AddressCompletionModel::AddressCompletionModel(QObject *parent) : QAbstractListModel(parent),
+	m_historyWatcher(nullptr),
+	m_localPathsWatcher(nullptr),
 	m_types(UnknownCompletionType),
 	m_updateTimer(0),
+	m_isUpdating(false),
 	m_showCompletionCategories(true)
 {
 }
 
+AddressCompletionModel::~AddressCompletionModel()
+{
+	cancelJobs();
+}
+
 void AddressCompletionModel::timerEvent(QTimerEvent *event)
 {
 	if (event->timerId() == m_updateTimer)
@@ -53,17 +64,41 @@ void AddressCompletionModel::timerEvent(QTimerEvent *event)
 
 		if (!m_filter.isEmpty())
 		{
-			updateModel();
+			m_isUpdating = true;
 
-			emit completionReady(m_filter);
+			updateModel();
 		}
 	}
 }
 
+void AddressCompletionModel::cancelJobs()
+{
+	if (m_isCancelled)
+	{
+		m_isCancelled->storeRelease(1);
+		m_isCancelled.reset();
+	}
+
+	if (m_historyWatcher)
+	{
+		m_historyWatcher->disconnect(this);
+		m_historyWatcher->deleteLater();
+		m_historyWatcher = nullptr;
+	}
+
+	if (m_localPathsWatcher)
+	{
+		m_localPathsWatcher->disconnect(this);
+		m_localPathsWatcher->deleteLater();
+		m_localPathsWatcher = nullptr;
+	}
+}
+
 void AddressCompletionModel::updateModel()
 {
-	QVector<CompletionEntry> completions;
-	completions.reserve(10);
+	cancelJobs();
+
+	m_isCancelled = std::make_shared<QAtomicInt>(0);
 
 	if (m_types.testFlag(SearchSuggestionsCompletionType))
 	{
@@ -72,6 +107,7 @@ void AddressCompletionModel::updateModel()
 		QString title(m_defaultSearchEngine.title);
 		QString text(m_filter);
 		QIcon icon(m_defaultSearchEngine.icon);
+		QVector<CompletionEntry> completions;
 
 		if (searchEngine.isValid())
 		{
@@ -101,16 +137,22 @@ void AddressCompletionModel::updateModel()
 		completionEntry.keyword = keyword;
 
 		completions.append(completionEntry);
+
+		m_sections[SearchSuggestionsCompletionType] = completions;
+	}
+	else
+	{
+		m_sections.remove(SearchSuggestionsCompletionType);
 	}
 
 	if (m_types.testFlag(BookmarksCompletionType))
 	{
+		const QDateTime currentDateTime(QDateTime::currentDateTime());
 		const QVector<BookmarksModel::BookmarkMatch> bookmarks(BookmarksManager::findBookmarks(m_filter));
-
-		if (m_showCompletionCategories && !bookmarks.isEmpty())
-		{
-			completions.append(CompletionEntry(QUrl(), tr("Bookmarks"), QString(), QIcon(), QDateTime(), HeaderType));
-		}
+		QVector<CompletionEntry> completions;
+		QVector<CompletionEntry> keywordEntries;
+		QVector<CompletionEntry> rankedEntries;
+		QVector<qint64> scores;
 
 		for (int i = 0; i < bookmarks.count(); ++i)
 		{
@@ -120,57 +162,81 @@ void AddressCompletionModel::updateModel()
 			if (completionEntry.keyword.startsWith(m_filter))
 			{
 				completionEntry.match = completionEntry.keyword;
+
+				keywordEntries.append(completionEntry);
 			}
+			else
+			{
+				rankedEntries.append(completionEntry);
+				scores.append(calculateFrecency(bookmarks.at(i).bookmark->data(BookmarksModel::VisitsRole).toInt(), bookmarks.at(i).bookmark->data(BookmarksModel::TimeVisitedRole).toDateTime(), currentDateTime, false));
+			}
+		}
 
-			completions.append(completionEntry);
+		const QVector<int> topEntries(getTopEntries(scores, (m_entriesLimit - keywordEntries.count())));
+
+		if (m_showCompletionCategories && (!keywordEntries.isEmpty() || !topEntries.isEmpty()))
+		{
+			completions.append(CompletionEntry(QUrl(), tr("Bookmarks"), QString(), QIcon(), QDateTime(), HeaderType));
+		}
+
+#if QT_VERSION >= 0x050500
+		completions.append(keywordEntries);
+#else
+		completions += keywordEntries;
+#endif
+
+		for (int i = 0; i < topEntries.count(); ++i)
+		{
+			completions.append(rankedEntries.at(topEntries.at(i)));
 		}
+
+		m_sections[BookmarksCompletionType] = completions;
+	}
+	else
+	{
+		m_sections.remove(BookmarksCompletionType);
 	}
 
 	if (m_types.testFlag(LocalPathSuggestionsCompletionType) && m_filter.contains(QDir::separator()))
 	{
 		const QString directory(m_filter.section(QDir::separator(), 0, -2) + QDir::separator());
-		const QString prefix(m_filter.section(QDir::separator(), -1, -1));
-		const QList<QFileInfo> entries(QDir(Utils::normalizePath(directory)).entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot));
-		const QFileIconProvider iconProvider;
-		bool wasAdded(!m_showCompletionCategories);
 
-		for (int i = 0; i < entries.count(); ++i)
-		{
-			if (entries.at(i).fileName().startsWith(prefix, Qt::CaseInsensitive))
-			{
-				const QString path(directory + entries.at(i).fileName());
-				const QMimeType type(QMimeDatabase().mimeTypeForFile(entries.at(i), QMimeDatabase::MatchExtension));
+		m_sections[LocalPathSuggestionsCompletionType] = filterEntries(m_sections.value(LocalPathSuggestionsCompletionType), m_filter);
 
-				if (!wasAdded)
-				{
-					completions.append(CompletionEntry(QUrl(), tr("Local files"), QString(), QIcon(), QDateTime(), HeaderType));
+		m_localPathsWatcher = new QFutureWatcher<QList<QFileInfo> >(this);
+		m_localPathsWatcher->setProperty("directory", directory);
 
-					wasAdded = true;
-				}
+		connect(m_localPathsWatcher, SIGNAL(finished()), this, SLOT(handleLocalPathsFinished()));
 
-				completions.append(CompletionEntry(QUrl::fromLocalFile(QDir::toNativeSeparators(path)), path, path, QIcon::fromTheme(type.iconName(), iconProvider.icon(entries.at(i))), QDateTime(), LocalPathType));
-			}
-		}
+		m_localPathsWatcher->setFuture(QtConcurrent::run(&AddressCompletionModel::createLocalPathCompletions, directory, m_filter.section(QDir::separator(), -1, -1), m_isCancelled));
+	}
+	else
+	{
+		m_sections.remove(LocalPathSuggestionsCompletionType);
 	}
 
 	if (m_types.testFlag(HistoryCompletionType))
 	{
-		const QVector<HistoryModel::HistoryEntryMatch> entries(HistoryManager::findEntries(m_filter));
+		const HistoryModel *browsingHistoryModel(HistoryManager::getBrowsingHistoryModel());
+		const HistoryModel *typedHistoryModel(HistoryManager::getTypedHistoryModel());
 
-		if (m_showCompletionCategories && !entries.isEmpty())
-		{
-			completions.append(CompletionEntry(QUrl(), tr("History"), QString(), QIcon(), QDateTime(), HeaderType));
-		}
+		m_sections[HistoryCompletionType] = filterEntries(m_sections.value(HistoryCompletionType), m_filter);
 
-		for (int i = 0; i < entries.count(); ++i)
-		{
-			completions.append(CompletionEntry(entries.at(i).entry->data(HistoryModel::UrlRole).toUrl(), entries.at(i).entry->data(HistoryModel::TitleRole).toString(), entries.at(i).match, entries.at(i).entry->data(Qt::DecorationRole).value<QIcon>(), entries.at(i).entry->data(HistoryModel::TimeVisitedRole).toDateTime(), (entries.at(i).isTypedIn ? TypedInHistoryType : HistoryType)));
-		}
+		m_historyWatcher = new QFutureWatcher<QVector<CompletionEntry> >(this);
+
+		connect(m_historyWatcher, SIGNAL(finished()), this, SLOT(handleHistoryFinished()));
+
+		m_historyWatcher->setFuture(QtConcurrent::run(&AddressCompletionModel::createHistoryCompletions, (typedHistoryModel ? typedHistoryModel->getIndex() : std::make_shared<const HistoryStore::Index>()), (browsingHistoryModel ? browsingHistoryModel->getIndex() : std::make_shared<const HistoryStore::Index>()), m_filter, QDateTime::currentDateTime(), m_isCancelled));
+	}
+	else
+	{
+		m_sections.remove(HistoryCompletionType);
 	}
 
 	if (m_types.testFlag(TypedHistoryCompletionType))
 	{
 		const QVector<HistoryModel::HistoryEntryMatch> entries(HistoryManager::findEntries(QString(), true));
+		QVector<CompletionEntry> completions;
 
 		if (m_showCompletionCategories && !entries.isEmpty())
 		{
@@ -181,12 +247,18 @@ void AddressCompletionModel::updateModel()
 		{
 			completions.append(CompletionEntry(entries.at(i).entry->data(HistoryModel::UrlRole).toUrl(), entries.at(i).entry->data(HistoryModel::TitleRole).toString(), entries.at(i).match, entries.at(i).entry->data(Qt::DecorationRole).value<QIcon>(), entries.at(i).entry->data(HistoryModel::TimeVisitedRole).toDateTime(), TypedInHistoryType));
 		}
+
+		m_sections[TypedHistoryCompletionType] = completions;
+	}
+	else
+	{
+		m_sections.remove(TypedHistoryCompletionType);
 	}
 
 	if (m_types.testFlag(SpecialPagesCompletionType))
 	{
 		const QStringList specialPages(AddonsManager::getSpecialPages());
-		bool wasAdded(!m_showCompletionCategories);
+		QVector<CompletionEntry> completions;
 
 		for (int i = 0; i < specialPages.count(); ++i)
 		{
@@ -194,23 +266,128 @@ void AddressCompletionModel::updateModel()
 
 			if (information.url.toString().startsWith(m_filter))
 			{
-				if (!wasAdded)
+				if (m_showCompletionCategories && completions.isEmpty())
 				{
 					completions.append(CompletionEntry(QUrl(), tr("Special pages"), QString(), QIcon(), QDateTime(), HeaderType));
-
-					wasAdded = true;
 				}
 
 				completions.append(CompletionEntry(information.url, information.getTitle(), QString(), information.icon, QDateTime(), SpecialPageType));
 			}
 		}
+
+		m_sections[SpecialPagesCompletionType] = completions;
+	}
+	else
+	{
+		m_sections.remove(SpecialPagesCompletionType);
+	}
+
+	updateCompletions();
+}
+
+void AddressCompletionModel::updateCompletions()
+{
+	const QVector<CompletionType> types({SearchSuggestionsCompletionType, BookmarksCompletionType, LocalPathSuggestionsCompletionType, HistoryCompletionType, TypedHistoryCompletionType, SpecialPagesCompletionType});
+	QVector<CompletionEntry> completions;
+
+	for (int i = 0; i < types.count(); ++i)
+	{
+#if QT_VERSION >= 0x050500
+		completions.append(m_sections.value(types.at(i)));
+#else
+		completions += m_sections.value(types.at(i));
+#endif
 	}
 
-	beginResetModel();
+	setCompletions(completions);
+
+	if (m_isUpdating && !m_historyWatcher && !m_localPathsWatcher)
+	{
+		m_isUpdating = false;
+
+		emit completionReady(m_filter);
+	}
+}
+
+void AddressCompletionModel::handleHistoryFinished()
+{
+	if (!m_historyWatcher)
+	{
+		return;
+	}
+
+	QVector<CompletionEntry> entries(m_historyWatcher->result());
+	QVector<CompletionEntry> completions;
+
+	m_historyWatcher->deleteLater();
+	m_historyWatcher = nullptr;
+
+	const HistoryModel *browsingHistoryModel(HistoryManager::getBrowsingHistoryModel());
+	const HistoryModel *typedHistoryModel(HistoryManager::getTypedHistoryModel());
+
+	for (int i = 0; i < entries.count(); ++i)
+	{
+		CompletionEntry &entry(entries[i]);
+
+		if (entry.type == TypedInHistoryType && typedHistoryModel)
+		{
+			entry.icon = typedHistoryModel->getIcon(entry.url);
+		}
+
+		if (entry.icon.isNull() && browsingHistoryModel)
+		{
+			entry.icon = browsingHistoryModel->getIcon(entry.url);
+		}
+	}
+
+	if (m_showCompletionCategories && !entries.isEmpty())
+	{
+		completions.append(CompletionEntry(QUrl(), tr("History"), QString(), QIcon(), QDateTime(), HeaderType));
+	}
+
+#if QT_VERSION >= 0x050500
+	completions.append(entries);
+#else
+	completions += entries;
+#endif
+
+	m_sections[HistoryCompletionType] = completions;
+
+	updateCompletions();
+}
+
+void AddressCompletionModel::handleLocalPathsFinished()
+{
+	if (!m_localPathsWatcher)
+	{
+		return;
+	}
+
+	const QString directory(m_localPathsWatcher->property("directory").toString());
+	const QList<QFileInfo> entries(m_localPathsWatcher->result());
+	const QFileIconProvider iconProvider;
+	const QMimeDatabase mimeDatabase;
+	QVector<CompletionEntry> completions;
+
+	m_localPathsWatcher->deleteLater();
+	m_localPathsWatcher = nullptr;
+
+	if (m_showCompletionCategories && !entries.isEmpty())
+	{
+		completions.append(CompletionEntry(QUrl(), tr("Local files"), QString(), QIcon(), QDateTime(), HeaderType));
+	}
+
+	for (int i = 0; i < entries.count(); ++i)
+	{
+		const QString path(directory + entries.at(i).fileName());
+		const QMimeType type(mimeDatabase.mimeTypeForFile(entries.at(i), QMimeDatabase::MatchExtension));
+
+		completions.append(CompletionEntry(QUrl::fromLocalFile(QDir::toNativeSeparators(path)), path, path, QIcon::fromTheme(type.iconName(), iconProvider.icon(entries.at(i))), QDateTime(), LocalPathType));
+	}
 
-	m_completions = completions;
+	m_sections[LocalPathSuggestionsCompletionType] = completions;
 
-	endResetModel();
+	updateCompletions();
 }
 
 void AddressCompletionModel::setFilter(const QString &filter, CompletionTypes types)
@@ -269,11 +446,12 @@ void AddressCompletionModel::setFilter(const QString &filter, CompletionTypes ty
 			m_updateTimer = 0;
 		}
 
-		beginResetModel();
+		cancelJobs();
 
-		m_completions.clear();
+		m_sections.clear();
+		m_isUpdating = false;
 
-		endResetModel();
+		setCompletions({});
 
 		emit completionReady(QString());
 	}
@@ -283,6 +461,219 @@ void AddressCompletionModel::setFilter(const QString &filter, CompletionTypes ty
 	}
 }
 
+void AddressCompletionModel::setCompletions(const QVector<CompletionEntry> &completions)
+{
+	const int oldCount(m_completions.count());
+	const int newCount(completions.count());
+	int start(0);
+	int end(0);
+
+	while (start < oldCount && start < newCount && isSameEntry(m_completions.at(start), completions.at(start)))
+	{
+		++start;
+	}
+
+	while (end < (oldCount - start) && end < (newCount - start) && isSameEntry(m_completions.at(oldCount - end - 1), completions.at(newCount - end - 1)))
+	{
+		++end;
+	}
+
+	if ((oldCount - start - end) > 0)
+	{
+		beginRemoveRows(QModelIndex(), start, (oldCount - end - 1));
+
+		m_completions.remove(start, (oldCount - start - end));
+
+		endRemoveRows();
+	}
+
+	if ((newCount - start - end) > 0)
+	{
+		beginInsertRows(QModelIndex(), start, (newCount - end - 1));
+
+		for (int i = start; i < (newCount - end); ++i)
+		{
+			m_completions.insert(i, completions.at(i));
+		}
+
+		endInsertRows();
+	}
+}
+
+QVector<AddressCompletionModel::CompletionEntry> AddressCompletionModel::createHistoryCompletions(std::shared_ptr<const HistoryStore::Index> typedHistory, std::shared_ptr<const HistoryStore::Index> browsingHistory, const QString &filter, const QDateTime &currentDateTime, std::shared_ptr<QAtomicInt> isCancelled)
+{
+	const QVector<const HistoryStore::Index*> indexes({typedHistory.get(), browsingHistory.get()});
+	QVector<CompletionEntry> rankedEntries;
+	QVector<int> visits;
+	QHash<QUrl, int> positions;
+
+	for (int i = 0; i < indexes.count(); ++i)
+	{
+		const HistoryStore::Index *index(indexes.at(i));
+		const QVector<CompletionIndex::Match> urls(index->completionIndex.findUrls(filter));
+		const bool isTypedIn(index == typedHistory.get());
+
+		for (int j = 0; j < urls.count(); ++j)
+		{
+			if ((j % 1000) == 0 && isCancelled->loadAcquire() != 0)
+			{
+				return {};
+			}
+
+			const QVector<quint64> identifiers(index->urls.value(urls.at(j).url));
+
+			if (identifiers.isEmpty())
+			{
+				continue;
+			}
+
+			HistoryStore::Entry entry(index->entries.value(identifiers.first()));
+
+			for (int k = 1; k < identifiers.count(); ++k)
+			{
+				const HistoryStore::Entry &visit(index->entries.value(identifiers.at(k)));
+
+				if (visit.time > entry.time)
+				{
+					entry = visit;
+				}
+			}
+
+			const QHash<QUrl, int>::const_iterator iterator(positions.constFind(urls.at(j).url));
+
+			if (iterator == positions.constEnd())
+			{
+				positions[urls.at(j).url] = rankedEntries.count();
+
+				rankedEntries.append(CompletionEntry(entry.url, entry.title, urls.at(j).match, QIcon(), entry.time, (isTypedIn ? TypedInHistoryType : HistoryType)));
+				visits.append(identifiers.count());
+			}
+			else
+			{
+				CompletionEntry &completionEntry(rankedEntries[iterator.value()]);
+				completionEntry.timeVisited = qMax(completionEntry.timeVisited, entry.time);
+
+				visits[iterator.value()] = qMax(visits.at(iterator.value()), identifiers.count());
+			}
+		}
+	}
+
+	if (isCancelled->loadAcquire() != 0)
+	{
+		return {};
+	}
+
+	QVector<qint64> scores;
+	scores.reserve(rankedEntries.count());
+
+	for (int i = 0; i < rankedEntries.count(); ++i)
+	{
+		scores.append(calculateFrecency(visits.at(i), rankedEntries.at(i).timeVisited, currentDateTime, (rankedEntries.at(i).type == TypedInHistoryType)));
+	}
+
+	const QVector<int> topEntries(getTopEntries(scores, m_entriesLimit));
+	QVector<CompletionEntry> completions;
+	completions.reserve(topEntries.count());
+
+	for (int i = 0; i < topEntries.count(); ++i)
+	{
+		completions.append(rankedEntries.at(topEntries.at(i)));
+	}
+
+	return completions;
+}
+
+QVector<AddressCompletionModel::CompletionEntry> AddressCompletionModel::filterEntries(const QVector<CompletionEntry> &entries, const QString &filter)
+{
+	QVector<CompletionEntry> filteredEntries;
+
+	for (int i = 0; i < entries.count(); ++i)
+	{
+		if (entries.at(i).type != HeaderType && (entries.at(i).match.isEmpty() ? entries.at(i).url.toString() : entries.at(i).match).startsWith(filter, Qt::CaseInsensitive))
+		{
+			filteredEntries.append(entries.at(i));
+		}
+	}
+
+	if (!filteredEntries.isEmpty() && !entries.isEmpty() && entries.first().type == HeaderType)
+	{
+		filteredEntries.prepend(entries.first());
+	}
+
+	return filteredEntries;
+}
+
+QList<QFileInfo> AddressCompletionModel::createLocalPathCompletions(const QString &directory, const QString &prefix, std::shared_ptr<QAtomicInt> isCancelled)
+{
+	const QList<QFileInfo> entries(QDir(Utils::normalizePath(directory)).entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot));
+	QList<QFileInfo> matchingEntries;
+
+	for (int i = 0; i < entries.count(); ++i)
+	{
+		if (isCancelled->loadAcquire() != 0)
+		{
+			return {};
+		}
+
+		if (entries.at(i).fileName().startsWith(prefix, Qt::CaseInsensitive))
+		{
+			matchingEntries.append(entries.at(i));
+		}
+	}
+
+	return matchingEntries;
+}
+
+QVector<int> AddressCompletionModel::getTopEntries(const QVector<qint64> &scores, int limit)
+{
+	QVector<int> entries;
+	entries.reserve(scores.count());
+
+	for (int i = 0; i < scores.count(); ++i)
+	{
+		entries.append(i);
+	}
+
+	limit = qBound(0, limit, entries.count());
+
+	std::partial_sort(entries.begin(), (entries.begin() + limit), entries.end(), [&](int first, int second)
+	{
+		return (scores.at(first) > scores.at(second) || (scores.at(first) == scores.at(second) && first < second));
+	});
+
+	entries.resize(limit);
+
+	return entries;
+}
+
+qint64 AddressCompletionModel::calculateFrecency(int visits, const QDateTime &timeVisited, const QDateTime &currentDateTime, bool isTypedIn)
+{
+	const qint64 days(timeVisited.isValid() ? timeVisited.daysTo(currentDateTime) : -1);
+	qint64 weight(10);
+
+	if (days >= 0)
+	{
+		if (days <= 4)
+		{
+			weight = 100;
+		}
+		else if (days <= 14)
+		{
+			weight = 70;
+		}
+		else if (days <= 31)
+		{
+			weight = 50;
+		}
+		else if (days <= 90)
+		{
+			weight = 30;
+		}
+	}
+
+	return (qMax(1, visits) * weight * (isTypedIn ? 2 : 1));
+}
+
 QVariant AddressCompletionModel::data(const QModelIndex &index, int role) const
 {
 	if (index.column() == 0 && index.row() >= 0 && index.row() < m_completions.count())
@@ -335,6 +726,11 @@ int AddressCompletionModel::rowCount(const QModelIndex &index) const
 	return (index.isValid() ? 0 : m_completions.count());
 }
 
+bool AddressCompletionModel::isSameEntry(const CompletionEntry &first, const CompletionEntry &second)
+{
+	return (first.type == second.type && first.url == second.url && first.text == second.text && first.title == second.title && first.match == second.match && first.keyword == second.keyword && first.timeVisited == second.timeVisited);
+}
+
 bool AddressCompletionModel::event(QEvent *event)
 {
 	if (event->type() == QEvent::LanguageChange && m_completions.count() > 0)
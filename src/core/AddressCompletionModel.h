@@ -22,11 +22,16 @@
 #ifndef OTTER_ADDRESSCOMPLETIONMODEL_H
 #define OTTER_ADDRESSCOMPLETIONMODEL_H
 
+#include "../core/HistoryStore.h"
 #include "../core/SearchEnginesManager.h"
 
 #include <QtCore/QAbstractListModel>
+#include <QtCore/QFileInfo>
+#include <QtCore/QFutureWatcher>
 #include <QtCore/QUrl>
 
+#include <memory>
+
 namespace Otter
 {
 
@@ -92,6 +97,7 @@ public:
 	};
 
 	explicit AddressCompletionModel(QObject *parent = nullptr);
+	~AddressCompletionModel();
 
 	QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
 	QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
@@ -104,16 +110,36 @@ public slots:
 
 protected:
 	void timerEvent(QTimerEvent *event) override;
+	void cancelJobs();
 	void updateModel();
+	void updateCompletions();
+	void setCompletions(const QVector<CompletionEntry> &completions);
+	static QVector<CompletionEntry> createHistoryCompletions(std::shared_ptr<const HistoryStore::Index> typedHistory, std::shared_ptr<const HistoryStore::Index> browsingHistory, const QString &filter, const QDateTime &currentDateTime, std::shared_ptr<QAtomicInt> isCancelled);
+	static QVector<CompletionEntry> filterEntries(const QVector<CompletionEntry> &entries, const QString &filter);
+	static QList<QFileInfo> createLocalPathCompletions(const QString &directory, const QString &prefix, std::shared_ptr<QAtomicInt> isCancelled);
+	static QVector<int> getTopEntries(const QVector<qint64> &scores, int limit);
+	static qint64 calculateFrecency(int visits, const QDateTime &timeVisited, const QDateTime &currentDateTime, bool isTypedIn);
+	static bool isSameEntry(const CompletionEntry &first, const CompletionEntry &second);
+
+protected slots:
+	void handleHistoryFinished();
+	void handleLocalPathsFinished();
 
 private:
+	QFutureWatcher<QVector<CompletionEntry> > *m_historyWatcher;
+	QFutureWatcher<QList<QFileInfo> > *m_localPathsWatcher;
+	std::shared_ptr<QAtomicInt> m_isCancelled;
 	QVector<CompletionEntry> m_completions;
+	QHash<int, QVector<CompletionEntry> > m_sections;
 	QString m_filter;
 	SearchEnginesManager::SearchEngineDefinition m_defaultSearchEngine;
 	AddressCompletionModel::CompletionTypes m_types;
 	int m_updateTimer;
+	bool m_isUpdating;
 	bool m_showCompletionCategories;
 
+	static const int m_entriesLimit;
+
 signals:
 	void completionReady(const QString &filter);
 };
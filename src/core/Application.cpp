@@ -22,6 +22,7 @@
 #include "AddonsManager.h"
 #include "BookmarksManager.h"
 #include "Console.h"
+#include "ContentBlockingManager.h"
 #include "GesturesManager.h"
 #include "HandlersManager.h"
 #include "HistoryManager.h"
@@ -377,6 +378,7 @@ Application::Application(int &argc, char **argv) : QApplication(argc, argv)
 	}
 
 	SessionsManager::createInstance(profilePath, cachePath, isPrivate, isReadOnly);
+	SessionsManager::preloadSession(m_commandLineParser.value(QLatin1String("session")).isEmpty() ? QLatin1String("default") : m_commandLineParser.value(QLatin1String("session")));
 
 	if (!isReadOnly && !Migrator::run())
 	{
@@ -1237,7 +1239,7 @@ QString Application::createReport(ReportOptions options)
 		stream << QLatin1String("\n\t");
 		stream.setFieldWidth(20);
 		stream << QLatin1String("History");
-		stream << SessionsManager::getWritableDataPath(QLatin1String("browsingHistory.json"));
+		stream << SessionsManager::getWritableDataPath(QLatin1String("browsingHistory.dat"));
 		stream.setFieldWidth(0);
 		stream << QLatin1String("\n\t");
 		stream.setFieldWidth(20);
@@ -1249,6 +1251,24 @@ QString Application::createReport(ReportOptions options)
 
 	if (options.testFlag(SettingsReport))
 	{
+		const ContentBlockingManager::CacheStatistics contentBlockingStatistics(ContentBlockingManager::getCacheStatistics());
+
+		stream << QLatin1String("Content Blocking Cache:\n\t");
+		stream.setFieldWidth(20);
+		stream << QLatin1String("Entries");
+		stream << contentBlockingStatistics.size;
+		stream.setFieldWidth(0);
+		stream << QLatin1String("\n\t");
+		stream.setFieldWidth(20);
+		stream << QLatin1String("Hits");
+		stream << contentBlockingStatistics.hits;
+		stream.setFieldWidth(0);
+		stream << QLatin1String("\n\t");
+		stream.setFieldWidth(20);
+		stream << QLatin1String("Misses");
+		stream << contentBlockingStatistics.misses;
+		stream.setFieldWidth(0);
+		stream << QLatin1String("\n\n");
 		stream << SettingsManager::createReport();
 	}
 
@@ -1322,7 +1342,7 @@ bool Application::canClose()
 
 	for (int i = 0; i < transfers.count(); ++i)
 	{
-		if (transfers.at(i)->getState() == Transfer::RunningState)
+		if (transfers.at(i)->getState() == Transfer::RunningState || transfers.at(i)->getState() == Transfer::QueuedState)
 		{
 			++runningTransfers;
 		}
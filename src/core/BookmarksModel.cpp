@@ -29,6 +29,7 @@
 #include <QtCore/QFile>
 #include <QtCore/QMimeData>
 #include <QtCore/QSaveFile>
+#include <QtCore/QSet>
 #include <QtWidgets/QMessageBox>
 
 namespace Otter
@@ -704,6 +705,7 @@ void BookmarksModel::removeBookmarkUrl(BookmarksItem *bookmark)
 			if (m_urls[url].isEmpty())
 			{
 				m_urls.remove(url);
+				m_completionIndex.removeUrl(url);
 			}
 		}
 	}
@@ -734,6 +736,8 @@ void BookmarksModel::readdBookmarkUrl(BookmarksItem *bookmark)
 			if (!m_urls.contains(url))
 			{
 				m_urls[url] = QVector<BookmarksItem*>();
+
+				m_completionIndex.addUrl(url);
 			}
 
 			m_urls[url].append(bookmark);
@@ -932,10 +936,8 @@ QStringList BookmarksModel::getKeywords() const
 
 QVector<BookmarksModel::BookmarkMatch> BookmarksModel::findBookmarks(const QString &prefix) const
 {
-	QVector<BookmarksItem*> matchedBookmarks;
-	QVector<BookmarksModel::BookmarkMatch> allMatches;
-	QVector<BookmarksModel::BookmarkMatch> currentMatches;
-	QMultiMap<QDateTime, BookmarksModel::BookmarkMatch> matchesMap;
+	QSet<BookmarksItem*> matchedBookmarks;
+	QVector<QPair<qint64, BookmarkMatch> > keywordMatches;
 	QHash<QString, BookmarksItem*>::const_iterator keywordsIterator;
 
 	for (keywordsIterator = m_keywords.constBegin(); keywordsIterator != m_keywords.constEnd(); ++keywordsIterator)
@@ -946,51 +948,51 @@ QVector<BookmarksModel::BookmarkMatch> BookmarksModel::findBookmarks(const QStri
 			match.bookmark = keywordsIterator.value();
 			match.match = keywordsIterator.key();
 
-			matchesMap.insert(match.bookmark->data(TimeVisitedRole).toDateTime(), match);
+			keywordMatches.append(qMakePair(match.bookmark->data(TimeVisitedRole).toDateTime().toMSecsSinceEpoch(), match));
 
-			matchedBookmarks.append(match.bookmark);
+			matchedBookmarks.insert(match.bookmark);
 		}
 	}
 
-	currentMatches = matchesMap.values().toVector();
+	const QVector<CompletionIndex::Match> urls(m_completionIndex.findUrls(prefix));
+	QVector<QPair<qint64, BookmarkMatch> > urlMatches;
+	urlMatches.reserve(urls.count());
 
-	matchesMap.clear();
-
-	for (int i = (currentMatches.count() - 1); i >= 0; --i)
+	for (int i = 0; i < urls.count(); ++i)
 	{
-		allMatches.append(currentMatches.at(i));
-	}
+		const QVector<BookmarksItem*> bookmarks(m_urls.value(urls.at(i).url));
 
-	QHash<QUrl, QVector<BookmarksItem*> >::const_iterator urlsIterator;
-
-	for (urlsIterator = m_urls.constBegin(); urlsIterator != m_urls.constEnd(); ++urlsIterator)
-	{
-		if (urlsIterator.value().isEmpty() || matchedBookmarks.contains(urlsIterator.value().first()))
+		if (bookmarks.isEmpty() || matchedBookmarks.contains(bookmarks.first()))
 		{
 			continue;
 		}
 
-		const QString result(Utils::matchUrl(urlsIterator.key(), prefix));
+		BookmarkMatch match;
+		match.bookmark = bookmarks.first();
+		match.match = urls.at(i).match;
 
-		if (!result.isEmpty())
-		{
-			BookmarkMatch match;
-			match.bookmark = urlsIterator.value().first();
-			match.match = result;
+		urlMatches.append(qMakePair(match.bookmark->data(TimeVisitedRole).toDateTime().toMSecsSinceEpoch(), match));
+	}
 
-			matchesMap.insert(match.bookmark->data(TimeVisitedRole).toDateTime(), match);
+	const auto compareMatches([&](const QPair<qint64, BookmarkMatch> &first, const QPair<qint64, BookmarkMatch> &second)
+	{
+		return (first.first > second.first);
+	});
 
-			matchedBookmarks.append(match.bookmark);
-		}
-	}
+	std::stable_sort(keywordMatches.begin(), keywordMatches.end(), compareMatches);
+	std::stable_sort(urlMatches.begin(), urlMatches.end(), compareMatches);
 
-	currentMatches = matchesMap.values().toVector();
+	QVector<BookmarksModel::BookmarkMatch> allMatches;
+	allMatches.reserve(keywordMatches.count() + urlMatches.count());
 
-	matchesMap.clear();
+	for (int i = 0; i < keywordMatches.count(); ++i)
+	{
+		allMatches.append(keywordMatches.at(i).second);
+	}
 
-	for (int i = (currentMatches.count() - 1); i >= 0; --i)
+	for (int i = 0; i < urlMatches.count(); ++i)
 	{
-		allMatches.append(currentMatches.at(i));
+		allMatches.append(urlMatches.at(i).second);
 	}
 
 	return allMatches;
@@ -1199,6 +1201,7 @@ bool BookmarksModel::setData(const QModelIndex &index, const QVariant &value, in
 			if (m_urls[oldUrl].isEmpty())
 			{
 				m_urls.remove(oldUrl);
+				m_completionIndex.removeUrl(oldUrl);
 			}
 		}
 
@@ -1207,6 +1210,8 @@ bool BookmarksModel::setData(const QModelIndex &index, const QVariant &value, in
 			if (!m_urls.contains(newUrl))
 			{
 				m_urls[newUrl] = QVector<BookmarksItem*>();
+
+				m_completionIndex.addUrl(newUrl);
 			}
 
 			m_urls[newUrl].append(bookmark);
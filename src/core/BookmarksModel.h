@@ -21,6 +21,8 @@
 #ifndef OTTER_BOOKMARKSMODEL_H
 #define OTTER_BOOKMARKSMODEL_H
 
+#include "CompletionIndex.h"
+
 #include <QtCore/QUrl>
 #include <QtCore/QXmlStreamReader>
 #include <QtCore/QXmlStreamWriter>
@@ -137,6 +139,7 @@ private:
 	QHash<QUrl, QVector<BookmarksItem*> > m_urls;
 	QHash<QString, BookmarksItem*> m_keywords;
 	QMap<quint64, BookmarksItem*> m_identifiers;
+	CompletionIndex m_completionIndex;
 	FormatMode m_mode;
 
 signals:
@@ -0,0 +1,137 @@
+/**************************************************************************
+* Otter Browser: Web browser controlled by the user, not vice-versa.
+* Copyright (C) 2017 Michal Dutkiewicz aka Emdek <michal@emdek.pl>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+**************************************************************************/
+
+#include "CompletionIndex.h"
+
+#include <QtCore/QHash>
+
+namespace Otter
+{
+
+void CompletionIndex::addUrl(const QUrl &url)
+{
+	const QStringList terms(getTerms(url));
+
+	for (int i = 0; i < terms.count(); ++i)
+	{
+		Posting posting;
+		posting.url = url;
+		posting.text = terms.at(i);
+		posting.priority = i;
+
+		m_terms[terms.at(i).toLower()].append(posting);
+	}
+}
+
+void CompletionIndex::removeUrl(const QUrl &url)
+{
+	const QStringList terms(getTerms(url));
+
+	for (int i = 0; i < terms.count(); ++i)
+	{
+		const QMap<QString, QVector<Posting> >::iterator iterator(m_terms.find(terms.at(i).toLower()));
+
+		if (iterator == m_terms.end())
+		{
+			continue;
+		}
+
+		QVector<Posting> &postings(iterator.value());
+
+		for (int j = (postings.count() - 1); j >= 0; --j)
+		{
+			if (postings.at(j).url == url && postings.at(j).priority == i)
+			{
+				postings.remove(j);
+			}
+		}
+
+		if (postings.isEmpty())
+		{
+			m_terms.erase(iterator);
+		}
+	}
+}
+
+void CompletionIndex::clear()
+{
+	m_terms.clear();
+}
+
+QStringList CompletionIndex::getTerms(const QUrl &url)
+{
+	QStringList terms({url.toString()});
+	const QString match(url.toString(QUrl::RemoveScheme).mid(2));
+
+	terms.append(match);
+
+	if (match.startsWith(QLatin1String("www.")) && url.host().count(QLatin1Char('.')) > 1)
+	{
+		terms.append(match.mid(4));
+	}
+
+	return terms;
+}
+
+QVector<CompletionIndex::Match> CompletionIndex::findUrls(const QString &prefix) const
+{
+	const QString term(prefix.toLower());
+	QVector<Match> matches;
+	QHash<QUrl, int> positions;
+	QHash<QUrl, int> priorities;
+	QMap<QString, QVector<Posting> >::const_iterator iterator;
+
+	for (iterator = m_terms.lowerBound(term); (iterator != m_terms.constEnd() && iterator.key().startsWith(term)); ++iterator)
+	{
+		const QVector<Posting> &postings(iterator.value());
+
+		for (int i = 0; i < postings.count(); ++i)
+		{
+			const Posting &posting(postings.at(i));
+			const QHash<QUrl, int>::iterator positionsIterator(positions.find(posting.url));
+
+			if (positionsIterator == positions.end())
+			{
+				Match match;
+				match.url = posting.url;
+				match.match = posting.text;
+
+				positions[posting.url] = matches.count();
+				priorities[posting.url] = posting.priority;
+
+				matches.append(match);
+			}
+			else if (posting.priority < priorities[posting.url])
+			{
+				matches[positionsIterator.value()].match = posting.text;
+
+				priorities[posting.url] = posting.priority;
+			}
+		}
+	}
+
+	return matches;
+}
+
+bool CompletionIndex::isEmpty() const
+{
+	return m_terms.isEmpty();
+}
+
+}
@@ -0,0 +1,62 @@
+/**************************************************************************
+* Otter Browser: Web browser controlled by the user, not vice-versa.
+* Copyright (C) 2017 Michal Dutkiewicz aka Emdek <michal@emdek.pl>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+**************************************************************************/
+
+#ifndef OTTER_COMPLETIONINDEX_H
+#define OTTER_COMPLETIONINDEX_H
+
+#include <QtCore/QMap>
+#include <QtCore/QStringList>
+#include <QtCore/QUrl>
+#include <QtCore/QVector>
+
+namespace Otter
+{
+
+class CompletionIndex final
+{
+public:
+	struct Match
+	{
+		QUrl url;
+		QString match;
+	};
+
+	void addUrl(const QUrl &url);
+	void removeUrl(const QUrl &url);
+	void clear();
+	QVector<Match> findUrls(const QString &prefix) const;
+	bool isEmpty() const;
+
+protected:
+	struct Posting
+	{
+		QUrl url;
+		QString text;
+		int priority = 0;
+	};
+
+	static QStringList getTerms(const QUrl &url);
+
+private:
+	QMap<QString, QVector<Posting> > m_terms;
+};
+
+}
+
+#endif
@@ -0,0 +1,914 @@
+/**************************************************************************
+* Otter Browser: Web browser controlled by the user, not vice-versa.
+* Copyright (C) 2017 Michal Dutkiewicz aka Emdek <michal@emdek.pl>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+**************************************************************************/
+
+#include "ContentBlockingIndex.h"
+
+#include <QtCore/QMap>
+#include <QtCore/QSaveFile>
+
+#include <algorithm>
+#include <limits>
+
+namespace Otter
+{
+
+QHash<NetworkManager::ResourceType, ContentBlockingIndex::RuleOption> ContentBlockingIndex::m_resourceTypes({{NetworkManager::ImageType, ImageOption}, {NetworkManager::ScriptType, ScriptOption}, {NetworkManager::StyleSheetType, StyleSheetOption}, {NetworkManager::ObjectType, ObjectOption}, {NetworkManager::XmlHttpRequestType, XmlHttpRequestOption}, {NetworkManager::SubFrameType, SubDocumentOption},{NetworkManager::PopupType, PopupOption}, {NetworkManager::ObjectSubrequestType, ObjectSubRequestOption}, {NetworkManager::WebSocketType, WebSocketOption}});
+const quint32 ContentBlockingIndex::m_magic(0x4943424f);
+const quint32 ContentBlockingIndex::m_version(3);
+
+ContentBlockingIndex::ContentBlockingIndex(QFile *file, const QByteArray &buffer, const uchar *data, qint64 size) :
+	m_file(file),
+	m_buffer(buffer),
+	m_data(file ? data : reinterpret_cast<const uchar*>(m_buffer.constData())),
+	m_header(reinterpret_cast<const Header*>(m_data)),
+	m_size(file ? size : m_buffer.size())
+{
+}
+
+ContentBlockingIndex::~ContentBlockingIndex()
+{
+	if (m_file)
+	{
+		m_file->unmap(const_cast<uchar*>(m_data));
+
+		delete m_file;
+	}
+}
+
+ContentBlockingIndex* ContentBlockingIndex::load(const QString &path, const SourceInformation &source)
+{
+	QFile *file(new QFile(path));
+
+	if (!file->open(QIODevice::ReadOnly))
+	{
+		delete file;
+
+		return nullptr;
+	}
+
+	const qint64 size(file->size());
+	const uchar *data((size >= static_cast<qint64>(sizeof(Header))) ? file->map(0, size) : nullptr);
+
+	file->close();
+
+	if (!data || !isValid(data, size))
+	{
+		delete file;
+
+		return nullptr;
+	}
+
+	const Header *header(reinterpret_cast<const Header*>(data));
+
+	if (header->sourceSize != source.size || header->sourceModified != (source.lastModified.isValid() ? source.lastModified.toMSecsSinceEpoch() : 0) || header->cosmeticFiltersMode != static_cast<quint32>(source.cosmeticFiltersMode) || header->areWildcardsEnabled != (source.areWildcardsEnabled ? 1u : 0u))
+	{
+		delete file;
+
+		return nullptr;
+	}
+
+	return new ContentBlockingIndex(file, QByteArray(), data, size);
+}
+
+ContentBlockingIndex* ContentBlockingIndex::load(const QByteArray &data)
+{
+	if (!isValid(reinterpret_cast<const uchar*>(data.constData()), data.size()))
+	{
+		return nullptr;
+	}
+
+	return new ContentBlockingIndex(nullptr, data, nullptr, 0);
+}
+
+ContentBlockingIndex::RequestInformation ContentBlockingIndex::createRequest(const QUrl &baseUrl, const QUrl &requestUrl, NetworkManager::ResourceType resourceType)
+{
+	RequestInformation request;
+	request.baseHost = baseUrl.host();
+	request.url = requestUrl.url();
+	request.host = requestUrl.host();
+	request.resourceType = resourceType;
+
+	if (request.url.startsWith(QLatin1String("//")))
+	{
+		request.urlStart = 2;
+	}
+
+	if (!request.host.isEmpty())
+	{
+		request.hostStart = request.url.indexOf(request.host, request.urlStart);
+		request.hostEnd = ((request.hostStart < 0) ? -1 : (request.hostStart + request.host.length()));
+	}
+
+	int tokenStart(-1);
+
+	for (int i = request.urlStart; i <= request.url.length(); ++i)
+	{
+		if (i < request.url.length() && isTokenCharacter(request.url.at(i)))
+		{
+			if (tokenStart < 0)
+			{
+				tokenStart = i;
+			}
+
+			continue;
+		}
+
+		if (tokenStart >= 0)
+		{
+			const quint32 token(createToken(request.url.constData() + tokenStart, (i - tokenStart)));
+
+			if (std::find(request.tokens.constBegin(), request.tokens.constEnd(), token) == request.tokens.constEnd())
+			{
+				request.tokens.append(token);
+			}
+
+			tokenStart = -1;
+		}
+	}
+
+	return request;
+}
+
+QByteArray ContentBlockingIndex::compile(const IndexDefinition &definition)
+{
+	QHash<QString, quint32> stringIdentifiers;
+	QVector<StringEntry> strings;
+	QString characters;
+	const auto createString([&](const QString &string) -> quint32
+	{
+		if (stringIdentifiers.contains(string))
+		{
+			return stringIdentifiers.value(string);
+		}
+
+		const quint32 identifier(static_cast<quint32>(strings.count()));
+		StringEntry entry;
+		entry.offset = static_cast<quint32>(characters.length());
+		entry.length = static_cast<quint32>(string.length());
+
+		strings.append(entry);
+		stringIdentifiers[string] = identifier;
+
+		characters.append(string);
+
+		return identifier;
+	});
+
+	QVector<QVector<quint32> > ruleTokens;
+	ruleTokens.reserve(definition.rules.count());
+
+	QHash<quint32, int> tokenFrequencies;
+
+	for (int i = 0; i < definition.rules.count(); ++i)
+	{
+		const QVector<quint32> tokens(getRuleTokens(definition.rules.at(i)));
+
+		for (int j = 0; j < tokens.count(); ++j)
+		{
+			++tokenFrequencies[tokens.at(j)];
+		}
+
+		ruleTokens.append(tokens);
+	}
+
+	QMap<quint32, QVector<int> > buckets;
+
+	for (int i = 0; i < ruleTokens.count(); ++i)
+	{
+		const QVector<quint32> &tokens(ruleTokens.at(i));
+		quint32 selectedToken(0);
+		int selectedTokenFrequency(0);
+
+		for (int j = 0; j < tokens.count(); ++j)
+		{
+			const int frequency(tokenFrequencies.value(tokens.at(j)));
+
+			if (selectedToken == 0 || frequency < selectedTokenFrequency)
+			{
+				selectedToken = tokens.at(j);
+				selectedTokenFrequency = frequency;
+			}
+		}
+
+		buckets[selectedToken].append(i);
+	}
+
+	QVector<TokenEntry> tokens;
+	tokens.reserve(buckets.count());
+
+	QVector<Rule> rules;
+	rules.reserve(definition.rules.count());
+
+	QVector<quint32> domains;
+	QMap<quint32, QVector<int> >::const_iterator iterator;
+
+	for (iterator = buckets.constBegin(); iterator != buckets.constEnd(); ++iterator)
+	{
+		TokenEntry token;
+		token.token = iterator.key();
+		token.firstRule = static_cast<quint32>(rules.count());
+		token.rulesCount = static_cast<quint32>(iterator.value().count());
+
+		tokens.append(token);
+
+		for (int i = 0; i < iterator.value().count(); ++i)
+		{
+			const RuleDefinition &ruleDefinition(definition.rules.at(iterator.value().at(i)));
+			Rule rule;
+			rule.rule = createString(ruleDefinition.rule);
+			rule.pattern = createString(ruleDefinition.pattern);
+			rule.profile = createString(ruleDefinition.profile);
+			rule.options = ruleDefinition.options;
+			rule.blockedDomains = static_cast<quint32>(domains.count());
+			rule.blockedDomainsCount = static_cast<quint32>(ruleDefinition.blockedDomains.count());
+
+			for (int j = 0; j < ruleDefinition.blockedDomains.count(); ++j)
+			{
+				domains.append(createString(ruleDefinition.blockedDomains.at(j)));
+			}
+
+			rule.allowedDomains = static_cast<quint32>(domains.count());
+			rule.allowedDomainsCount = static_cast<quint32>(ruleDefinition.allowedDomains.count());
+
+			for (int j = 0; j < ruleDefinition.allowedDomains.count(); ++j)
+			{
+				domains.append(createString(ruleDefinition.allowedDomains.at(j)));
+			}
+
+			rule.match = ruleDefinition.match;
+			rule.flags = ((ruleDefinition.isException ? IsExceptionFlag : NoFlags) | (ruleDefinition.needsDomainCheck ? NeedsDomainCheckFlag : NoFlags));
+
+			rules.append(rule);
+		}
+	}
+
+	QVector<quint32> styleSheet;
+	styleSheet.reserve(definition.styleSheet.count());
+
+	for (int i = 0; i < definition.styleSheet.count(); ++i)
+	{
+		styleSheet.append(createString(definition.styleSheet.at(i)));
+	}
+
+	const auto createStyleSheetList([&](const QMultiHash<QString, QString> &list) -> QVector<StyleSheetEntry>
+	{
+		QStringList domainNames(list.uniqueKeys());
+		domainNames.sort();
+
+		QVector<StyleSheetEntry> entries;
+		entries.reserve(list.count());
+
+		for (int i = 0; i < domainNames.count(); ++i)
+		{
+			const quint32 domain(createString(domainNames.at(i)));
+			const QStringList selectors(list.values(domainNames.at(i)));
+
+			for (int j = 0; j < selectors.count(); ++j)
+			{
+				StyleSheetEntry entry;
+				entry.domain = domain;
+				entry.selector = createString(selectors.at(j));
+
+				entries.append(entry);
+			}
+		}
+
+		return entries;
+	});
+	const QVector<StyleSheetEntry> styleSheetBlackList(createStyleSheetList(definition.styleSheetBlackList));
+	const QVector<StyleSheetEntry> styleSheetWhiteList(createStyleSheetList(definition.styleSheetWhiteList));
+	Header header = Header();
+	header.magic = m_magic;
+	header.version = m_version;
+	header.sourceSize = definition.source.size;
+	header.sourceModified = (definition.source.lastModified.isValid() ? definition.source.lastModified.toMSecsSinceEpoch() : 0);
+	header.cosmeticFiltersMode = static_cast<quint32>(definition.source.cosmeticFiltersMode);
+	header.areWildcardsEnabled = (definition.source.areWildcardsEnabled ? 1 : 0);
+
+	QByteArray data(sizeof(Header), 0);
+	const auto appendSection([&](SectionType type, const void *source, int count)
+	{
+		while (data.size() % 8 != 0)
+		{
+			data.append('\0');
+		}
+
+		header.sections[type].offset = static_cast<quint32>(data.size());
+		header.sections[type].count = static_cast<quint32>(count);
+
+		data.append(reinterpret_cast<const char*>(source), static_cast<int>(count * getElementSize(type)));
+	});
+
+	appendSection(StringsSection, strings.constData(), strings.count());
+	appendSection(CharactersSection, characters.constData(), characters.length());
+	appendSection(TokensSection, tokens.constData(), tokens.count());
+	appendSection(RulesSection, rules.constData(), rules.count());
+	appendSection(DomainsSection, domains.constData(), domains.count());
+	appendSection(StyleSheetSection, styleSheet.constData(), styleSheet.count());
+	appendSection(StyleSheetBlackListSection, styleSheetBlackList.constData(), styleSheetBlackList.count());
+	appendSection(StyleSheetWhiteListSection, styleSheetWhiteList.constData(), styleSheetWhiteList.count());
+
+	data.replace(0, sizeof(Header), reinterpret_cast<const char*>(&header), sizeof(Header));
+
+	return data;
+}
+
+QString ContentBlockingIndex::getString(quint32 identifier) const
+{
+	if (identifier >= getSectionCount(StringsSection))
+	{
+		return QString();
+	}
+
+	const StringEntry &entry(getSection<StringEntry>(StringsSection)[identifier]);
+
+	return QString(getSection<QChar>(CharactersSection) + entry.offset, static_cast<int>(entry.length));
+}
+
+QString ContentBlockingIndex::getRawString(quint32 identifier) const
+{
+	if (identifier >= getSectionCount(StringsSection))
+	{
+		return QString();
+	}
+
+	const StringEntry &entry(getSection<StringEntry>(StringsSection)[identifier]);
+
+	return QString::fromRawData(getSection<QChar>(CharactersSection) + entry.offset, static_cast<int>(entry.length));
+}
+
+QStringList ContentBlockingIndex::getStyleSheet() const
+{
+	const quint32 *styleSheet(getSection<quint32>(StyleSheetSection));
+	const quint32 count(getSectionCount(StyleSheetSection));
+	QStringList result;
+	result.reserve(static_cast<int>(count));
+
+	for (quint32 i = 0; i < count; ++i)
+	{
+		result.append(getString(styleSheet[i]));
+	}
+
+	return result;
+}
+
+QVector<ContentBlockingIndex::RuleDefinition> ContentBlockingIndex::getRules() const
+{
+	const Rule *rules(getSection<Rule>(RulesSection));
+	const quint32 *domains(getSection<quint32>(DomainsSection));
+	const quint32 count(getSectionCount(RulesSection));
+	QVector<RuleDefinition> definitions;
+	definitions.reserve(static_cast<int>(count));
+
+	for (quint32 i = 0; i < count; ++i)
+	{
+		const Rule &rule(rules[i]);
+		RuleDefinition definition;
+		definition.rule = getString(rule.rule);
+		definition.pattern = getString(rule.pattern);
+		definition.profile = getString(rule.profile);
+		definition.options = rule.options;
+		definition.match = static_cast<RuleMatch>(rule.match);
+		definition.isException = (rule.flags & IsExceptionFlag);
+		definition.needsDomainCheck = (rule.flags & NeedsDomainCheckFlag);
+
+		for (quint32 j = 0; j < rule.blockedDomainsCount; ++j)
+		{
+			definition.blockedDomains.append(getString(domains[rule.blockedDomains + j]));
+		}
+
+		for (quint32 j = 0; j < rule.allowedDomainsCount; ++j)
+		{
+			definition.allowedDomains.append(getString(domains[rule.allowedDomains + j]));
+		}
+
+		definitions.append(definition);
+	}
+
+	return definitions;
+}
+
+QStringList ContentBlockingIndex::getStyleSheetBlackList(const QString &domain) const
+{
+	return getStyleSheetList(StyleSheetBlackListSection, domain);
+}
+
+QStringList ContentBlockingIndex::getStyleSheetWhiteList(const QString &domain) const
+{
+	return getStyleSheetList(StyleSheetWhiteListSection, domain);
+}
+
+QStringList ContentBlockingIndex::getStyleSheetWhiteList() const
+{
+	const StyleSheetEntry *entries(getSection<StyleSheetEntry>(StyleSheetWhiteListSection));
+	const quint32 count(getSectionCount(StyleSheetWhiteListSection));
+	QStringList result;
+	result.reserve(static_cast<int>(count));
+
+	for (quint32 i = 0; i < count; ++i)
+	{
+		result.append(getString(entries[i].selector));
+	}
+
+	result.removeDuplicates();
+
+	return result;
+}
+
+QStringList ContentBlockingIndex::getStyleSheetList(SectionType type, const QString &domain) const
+{
+	const StyleSheetEntry *begin(getSection<StyleSheetEntry>(type));
+	const StyleSheetEntry *end(begin + getSectionCount(type));
+	const StyleSheetEntry *iterator(std::lower_bound(begin, end, domain, [&](const StyleSheetEntry &entry, const QString &value)
+	{
+		return (getRawString(entry.domain) < value);
+	}));
+	QStringList result;
+
+	while (iterator != end && getRawString(iterator->domain) == domain)
+	{
+		result.append(getString(iterator->selector));
+
+		++iterator;
+	}
+
+	return result;
+}
+
+ContentBlockingManager::CheckResult ContentBlockingIndex::checkUrl(const RequestInformation &request) const
+{
+	const TokenEntry *tokensBegin(getSection<TokenEntry>(TokensSection));
+	const TokenEntry *tokensEnd(tokensBegin + getSectionCount(TokensSection));
+	const Rule *blockingRule(nullptr);
+	const Rule *exceptionRule(nullptr);
+
+	for (int i = -1; i < request.tokens.count(); ++i)
+	{
+		const quint32 token((i < 0) ? 0 : request.tokens.at(i));
+		const TokenEntry *entry(std::lower_bound(tokensBegin, tokensEnd, token, [](const TokenEntry &tokenEntry, quint32 value)
+		{
+			return (tokenEntry.token < value);
+		}));
+
+		if (entry == tokensEnd || entry->token != token)
+		{
+			continue;
+		}
+
+		for (quint32 j = 0; j < entry->rulesCount; ++j)
+		{
+			const Rule *rule(getSection<Rule>(RulesSection) + entry->firstRule + j);
+
+			if (!checkRuleMatch(rule, request) || !checkRuleOptions(rule, request))
+			{
+				continue;
+			}
+
+			if (rule->flags & IsExceptionFlag)
+			{
+				exceptionRule = rule;
+
+				break;
+			}
+
+			blockingRule = rule;
+		}
+
+		if (exceptionRule)
+		{
+			break;
+		}
+	}
+
+	ContentBlockingManager::CheckResult result;
+
+	if (exceptionRule)
+	{
+		const RuleOptions ruleOptions(static_cast<RuleOption>(exceptionRule->options));
+
+		result.profile = getString(exceptionRule->profile);
+		result.rule = getString(exceptionRule->rule);
+		result.isException = true;
+
+		if (ruleOptions.testFlag(ElementHideOption))
+		{
+			result.comesticFiltersMode = ContentBlockingManager::NoFiltersMode;
+		}
+		else if (ruleOptions.testFlag(GenericHideOption))
+		{
+			result.comesticFiltersMode = ContentBlockingManager::DomainOnlyFiltersMode;
+		}
+	}
+	else if (blockingRule)
+	{
+		result.profile = getString(blockingRule->profile);
+		result.rule = getString(blockingRule->rule);
+		result.isBlocked = true;
+	}
+
+	return result;
+}
+
+const QChar* ContentBlockingIndex::getCharacters(quint32 identifier, int *length) const
+{
+	const StringEntry &entry(getSection<StringEntry>(StringsSection)[identifier]);
+
+	*length = static_cast<int>(entry.length);
+
+	return (getSection<QChar>(CharactersSection) + entry.offset);
+}
+
+QVector<quint32> ContentBlockingIndex::getRuleTokens(const RuleDefinition &rule)
+{
+	const QString &pattern(rule.pattern);
+	const bool hasStartAnchor(rule.needsDomainCheck || rule.match == StartMatch || rule.match == ExactMatch);
+	const bool hasEndAnchor(rule.match == EndMatch || rule.match == ExactMatch);
+	QVector<quint32> tokens;
+	int tokenStart(-1);
+
+	for (int i = 0; i <= pattern.length(); ++i)
+	{
+		if (i < pattern.length() && isTokenCharacter(pattern.at(i)))
+		{
+			if (tokenStart < 0)
+			{
+				tokenStart = i;
+			}
+
+			continue;
+		}
+
+		if (tokenStart < 0)
+		{
+			continue;
+		}
+
+		const bool hasStartBoundary((tokenStart > 0) ? (pattern.at(tokenStart - 1) != QLatin1Char('*')) : hasStartAnchor);
+		const bool hasEndBoundary((i < pattern.length()) ? (pattern.at(i) != QLatin1Char('*')) : hasEndAnchor);
+
+		if (hasStartBoundary && hasEndBoundary)
+		{
+			const quint32 token(createToken(pattern.constData() + tokenStart, (i - tokenStart)));
+
+			if (!tokens.contains(token))
+			{
+				tokens.append(token);
+			}
+		}
+
+		tokenStart = -1;
+	}
+
+	return tokens;
+}
+
+quint32 ContentBlockingIndex::getSectionCount(SectionType type) const
+{
+	return m_header->sections[type].count;
+}
+
+quint32 ContentBlockingIndex::createToken(const QChar *characters, int length)
+{
+	quint32 token(2166136261u);
+
+	for (int i = 0; i < length; ++i)
+	{
+		token ^= characters[i].toLower().unicode();
+		token *= 16777619u;
+	}
+
+	return ((token == 0) ? 1 : token);
+}
+
+quint32 ContentBlockingIndex::getElementSize(SectionType type)
+{
+	switch (type)
+	{
+		case StringsSection:
+			return sizeof(StringEntry);
+		case CharactersSection:
+			return sizeof(QChar);
+		case TokensSection:
+			return sizeof(TokenEntry);
+		case RulesSection:
+			return sizeof(Rule);
+		case StyleSheetBlackListSection:
+		case StyleSheetWhiteListSection:
+			return sizeof(StyleSheetEntry);
+		default:
+			return sizeof(quint32);
+	}
+}
+
+bool ContentBlockingIndex::save(const QString &path, const QByteArray &data)
+{
+	QSaveFile file(path);
+
+	if (!file.open(QIODevice::WriteOnly))
+	{
+		return false;
+	}
+
+	file.write(data);
+
+	return file.commit();
+}
+
+bool ContentBlockingIndex::checkRuleMatch(const Rule *rule, const RequestInformation &request) const
+{
+	int length(0);
+	const QChar *pattern(getCharacters(rule->pattern, &length));
+	const bool matchEnd(rule->match == EndMatch || rule->match == ExactMatch);
+
+	if (rule->flags & NeedsDomainCheckFlag)
+	{
+		for (int i = request.hostStart; (i >= 0 && i < request.hostEnd); ++i)
+		{
+			if ((i == request.hostStart || request.url.at(i - 1) == QLatin1Char('.')) && matchPattern(pattern, length, request.url, i, matchEnd))
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	if (rule->match == StartMatch || rule->match == ExactMatch)
+	{
+		return matchPattern(pattern, length, request.url, request.urlStart, matchEnd);
+	}
+
+	const bool hasLiteralStart(length > 0 && pattern[0] != QLatin1Char('*') && pattern[0] != QLatin1Char('^'));
+
+	for (int i = request.urlStart; i <= request.url.length(); ++i)
+	{
+		if (hasLiteralStart && (i == request.url.length() || request.url.at(i) != pattern[0]))
+		{
+			continue;
+		}
+
+		if (matchPattern(pattern, length, request.url, i, matchEnd))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool ContentBlockingIndex::checkRuleOptions(const Rule *rule, const RequestInformation &request) const
+{
+	const RuleOptions ruleOptions(static_cast<RuleOption>(rule->options));
+	const bool hasBlockedDomains(rule->blockedDomainsCount > 0);
+	const bool hasAllowedDomains(rule->allowedDomainsCount > 0);
+	bool isBlocked(hasBlockedDomains ? hasDomain(request.baseHost, rule->blockedDomains, rule->blockedDomainsCount) : true);
+	isBlocked = (hasAllowedDomains ? !hasDomain(request.baseHost, rule->allowedDomains, rule->allowedDomainsCount) : isBlocked);
+
+	if (ruleOptions.testFlag(ThirdPartyExceptionOption) || ruleOptions.testFlag(ThirdPartyOption))
+	{
+		if (request.baseHost.isEmpty() || isSubdomain(request.host, request.baseHost))
+		{
+			isBlocked = ruleOptions.testFlag(ThirdPartyExceptionOption);
+		}
+		else if (!hasBlockedDomains && !hasAllowedDomains)
+		{
+			isBlocked = ruleOptions.testFlag(ThirdPartyOption);
+		}
+	}
+
+	if (ruleOptions != NoOption)
+	{
+		QHash<NetworkManager::ResourceType, RuleOption>::const_iterator iterator;
+
+		for (iterator = m_resourceTypes.constBegin(); iterator != m_resourceTypes.constEnd(); ++iterator)
+		{
+			const bool supportsException(iterator.value() != WebSocketOption && iterator.value() != PopupOption);
+
+			if (ruleOptions.testFlag(iterator.value()) || (supportsException && ruleOptions.testFlag(static_cast<RuleOption>(iterator.value() * 2))))
+			{
+				if (request.resourceType == iterator.key())
+				{
+					isBlocked = (isBlocked ? ruleOptions.testFlag(iterator.value()) : isBlocked);
+				}
+				else if (supportsException)
+				{
+					isBlocked = (isBlocked ? ruleOptions.testFlag(static_cast<RuleOption>(iterator.value() * 2)) : isBlocked);
+				}
+				else
+				{
+					isBlocked = false;
+				}
+			}
+		}
+	}
+	else if (request.resourceType == NetworkManager::PopupType)
+	{
+		isBlocked = false;
+	}
+
+	return isBlocked;
+}
+
+bool ContentBlockingIndex::hasDomain(const QString &host, quint32 domains, quint32 count) const
+{
+	const quint32 *identifiers(getSection<quint32>(DomainsSection) + domains);
+
+	for (quint32 i = 0; i < count; ++i)
+	{
+		int length(0);
+		const QChar *domain(getCharacters(identifiers[i], &length));
+
+		if (std::search(host.constBegin(), host.constEnd(), domain, (domain + length)) != host.constEnd())
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool ContentBlockingIndex::matchPattern(const QChar *pattern, int length, const QString &url, int position, bool matchEnd)
+{
+	for (int i = 0; i < length; ++i)
+	{
+		const QChar character(pattern[i]);
+
+		if (character == QLatin1Char('*'))
+		{
+			while (i < length && pattern[i] == QLatin1Char('*'))
+			{
+				++i;
+			}
+
+			if (i == length)
+			{
+				return true;
+			}
+
+			for (int j = position; j <= url.length(); ++j)
+			{
+				if (matchPattern((pattern + i), (length - i), url, j, matchEnd))
+				{
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		if (character == QLatin1Char('^'))
+		{
+			if (position < url.length())
+			{
+				if (!isSeparator(url.at(position)))
+				{
+					return false;
+				}
+
+				++position;
+			}
+
+			continue;
+		}
+
+		if (position >= url.length() || url.at(position) != character)
+		{
+			return false;
+		}
+
+		++position;
+	}
+
+	return (!matchEnd || position == url.length());
+}
+
+bool ContentBlockingIndex::isSubdomain(const QString &host, const QString &domain)
+{
+	if (host == domain)
+	{
+		return true;
+	}
+
+	return (host.length() > domain.length() && domain.contains(QLatin1Char('.')) && host.endsWith(domain) && host.at(host.length() - domain.length() - 1) == QLatin1Char('.'));
+}
+
+bool ContentBlockingIndex::isSeparator(const QChar &character)
+{
+	return (!character.isLetterOrNumber() && character != QLatin1Char('_') && character != QLatin1Char('-') && character != QLatin1Char('.') && character != QLatin1Char('%'));
+}
+
+bool ContentBlockingIndex::isTokenCharacter(const QChar &character)
+{
+	return (character.isLetterOrNumber() || character == QLatin1Char('%'));
+}
+
+bool ContentBlockingIndex::isValid(const uchar *data, qint64 size)
+{
+	if (!data || size < static_cast<qint64>(sizeof(Header)))
+	{
+		return false;
+	}
+
+	const Header *header(reinterpret_cast<const Header*>(data));
+
+	if (header->magic != m_magic || header->version != m_version)
+	{
+		return false;
+	}
+
+	for (int i = 0; i < SectionsCount; ++i)
+	{
+		const SectionType type(static_cast<SectionType>(i));
+
+		if (header->sections[i].offset % 8 != 0 || header->sections[i].offset < sizeof(Header) || (static_cast<qint64>(header->sections[i].offset) + (static_cast<qint64>(header->sections[i].count) * getElementSize(type))) > size)
+		{
+			return false;
+		}
+	}
+
+	const quint32 stringsCount(header->sections[StringsSection].count);
+	const quint32 charactersCount(header->sections[CharactersSection].count);
+	const quint32 rulesCount(header->sections[RulesSection].count);
+	const quint32 domainsCount(header->sections[DomainsSection].count);
+	const StringEntry *strings(reinterpret_cast<const StringEntry*>(data + header->sections[StringsSection].offset));
+
+	for (quint32 i = 0; i < stringsCount; ++i)
+	{
+		if ((static_cast<quint64>(strings[i].offset) + strings[i].length) > charactersCount || strings[i].length > static_cast<quint32>(std::numeric_limits<int>::max()))
+		{
+			return false;
+		}
+	}
+
+	const TokenEntry *tokens(reinterpret_cast<const TokenEntry*>(data + header->sections[TokensSection].offset));
+
+	for (quint32 i = 0; i < header->sections[TokensSection].count; ++i)
+	{
+		if ((static_cast<quint64>(tokens[i].firstRule) + tokens[i].rulesCount) > rulesCount)
+		{
+			return false;
+		}
+	}
+
+	const Rule *rules(reinterpret_cast<const Rule*>(data + header->sections[RulesSection].offset));
+
+	for (quint32 i = 0; i < rulesCount; ++i)
+	{
+		const Rule &rule(rules[i]);
+
+		if (rule.rule >= stringsCount || rule.pattern >= stringsCount || rule.profile >= stringsCount || rule.match > ExactMatch || (static_cast<quint64>(rule.blockedDomains) + rule.blockedDomainsCount) > domainsCount || (static_cast<quint64>(rule.allowedDomains) + rule.allowedDomainsCount) > domainsCount)
+		{
+			return false;
+		}
+	}
+
+	const QVector<SectionType> identifiersSections({DomainsSection, StyleSheetSection});
+
+	for (int i = 0; i < identifiersSections.count(); ++i)
+	{
+		const quint32 *identifiers(reinterpret_cast<const quint32*>(data + header->sections[identifiersSections.at(i)].offset));
+
+		for (quint32 j = 0; j < header->sections[identifiersSections.at(i)].count; ++j)
+		{
+			if (identifiers[j] >= stringsCount)
+			{
+				return false;
+			}
+		}
+	}
+
+	const QVector<SectionType> styleSheetSections({StyleSheetBlackListSection, StyleSheetWhiteListSection});
+
+	for (int i = 0; i < styleSheetSections.count(); ++i)
+	{
+		const StyleSheetEntry *entries(reinterpret_cast<const StyleSheetEntry*>(data + header->sections[styleSheetSections.at(i)].offset));
+
+		for (quint32 j = 0; j < header->sections[styleSheetSections.at(i)].count; ++j)
+		{
+			if (entries[j].domain >= stringsCount || entries[j].selector >= stringsCount)
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+}
@@ -0,0 +1,240 @@
+/**************************************************************************
+* Otter Browser: Web browser controlled by the user, not vice-versa.
+* Copyright (C) 2017 Michal Dutkiewicz aka Emdek <michal@emdek.pl>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+**************************************************************************/
+
+#ifndef OTTER_CONTENTBLOCKINGINDEX_H
+#define OTTER_CONTENTBLOCKINGINDEX_H
+
+#include "ContentBlockingManager.h"
+
+#include <QtCore/QDateTime>
+#include <QtCore/QFile>
+#include <QtCore/QMultiHash>
+#include <QtCore/QStringList>
+#include <QtCore/QVarLengthArray>
+#include <QtCore/QVector>
+
+namespace Otter
+{
+
+class ContentBlockingIndex final
+{
+public:
+	enum RuleOption : quint32
+	{
+		NoOption = 0,
+		ThirdPartyOption = 1,
+		ThirdPartyExceptionOption = 2,
+		StyleSheetOption = 4,
+		StyleSheetExceptionOption = 8,
+		ScriptOption = 16,
+		ScriptExceptionOption = 32,
+		ImageOption = 64,
+		ImageExceptionOption = 128,
+		ObjectOption = 256,
+		ObjectExceptionOption = 512,
+		ObjectSubRequestOption = 1024,
+		ObjectSubRequestExceptionOption = 2048,
+		SubDocumentOption = 4096,
+		SubDocumentExceptionOption = 8192,
+		XmlHttpRequestOption = 16384,
+		XmlHttpRequestExceptionOption = 32768,
+		WebSocketOption = 65536,
+		PopupOption = 131072,
+		ElementHideOption = 262144,
+		GenericHideOption = 524288
+	};
+
+	Q_DECLARE_FLAGS(RuleOptions, RuleOption)
+
+	enum RuleMatch
+	{
+		ContainsMatch = 0,
+		StartMatch,
+		EndMatch,
+		ExactMatch
+	};
+
+	enum RuleFlag
+	{
+		NoFlags = 0,
+		IsExceptionFlag = 1,
+		NeedsDomainCheckFlag = 2
+	};
+
+	struct RuleDefinition
+	{
+		QString rule;
+		QString pattern;
+		QString profile;
+		QStringList blockedDomains;
+		QStringList allowedDomains;
+		quint32 options = 0;
+		RuleMatch match = ContainsMatch;
+		bool isException = false;
+		bool needsDomainCheck = false;
+	};
+
+	struct RequestInformation
+	{
+		QString baseHost;
+		QString url;
+		QString host;
+		QVarLengthArray<quint32, 64> tokens;
+		NetworkManager::ResourceType resourceType = NetworkManager::OtherType;
+		int urlStart = 0;
+		int hostStart = -1;
+		int hostEnd = -1;
+	};
+
+	struct SourceInformation
+	{
+		QDateTime lastModified;
+		qint64 size = 0;
+		int cosmeticFiltersMode = 0;
+		bool areWildcardsEnabled = true;
+	};
+
+	struct IndexDefinition
+	{
+		QVector<RuleDefinition> rules;
+		QStringList styleSheet;
+		QMultiHash<QString, QString> styleSheetBlackList;
+		QMultiHash<QString, QString> styleSheetWhiteList;
+		SourceInformation source;
+	};
+
+	struct Rule
+	{
+		quint32 rule;
+		quint32 pattern;
+		quint32 profile;
+		quint32 options;
+		quint32 blockedDomains;
+		quint32 blockedDomainsCount;
+		quint32 allowedDomains;
+		quint32 allowedDomainsCount;
+		quint32 match;
+		quint32 flags;
+	};
+
+	~ContentBlockingIndex();
+
+	static ContentBlockingIndex* load(const QString &path, const SourceInformation &source);
+	static ContentBlockingIndex* load(const QByteArray &data);
+	static RequestInformation createRequest(const QUrl &baseUrl, const QUrl &requestUrl, NetworkManager::ResourceType resourceType);
+	static QByteArray compile(const IndexDefinition &definition);
+	static bool save(const QString &path, const QByteArray &data);
+	QString getString(quint32 identifier) const;
+	QString getRawString(quint32 identifier) const;
+	QStringList getStyleSheet() const;
+	QVector<RuleDefinition> getRules() const;
+	QStringList getStyleSheetBlackList(const QString &domain) const;
+	QStringList getStyleSheetWhiteList(const QString &domain) const;
+	QStringList getStyleSheetWhiteList() const;
+	ContentBlockingManager::CheckResult checkUrl(const RequestInformation &request) const;
+
+protected:
+	enum SectionType
+	{
+		StringsSection = 0,
+		CharactersSection,
+		TokensSection,
+		RulesSection,
+		DomainsSection,
+		StyleSheetSection,
+		StyleSheetBlackListSection,
+		StyleSheetWhiteListSection,
+		SectionsCount
+	};
+
+	struct Section
+	{
+		quint32 offset;
+		quint32 count;
+	};
+
+	struct Header
+	{
+		quint32 magic;
+		quint32 version;
+		qint64 sourceSize;
+		qint64 sourceModified;
+		quint32 cosmeticFiltersMode;
+		quint32 areWildcardsEnabled;
+		Section sections[SectionsCount];
+	};
+
+	struct StringEntry
+	{
+		quint32 offset;
+		quint32 length;
+	};
+
+	struct StyleSheetEntry
+	{
+		quint32 domain;
+		quint32 selector;
+	};
+
+	struct TokenEntry
+	{
+		quint32 token;
+		quint32 firstRule;
+		quint32 rulesCount;
+	};
+
+	explicit ContentBlockingIndex(QFile *file, const QByteArray &buffer, const uchar *data, qint64 size);
+
+	template<typename T> const T* getSection(SectionType type) const
+	{
+		return reinterpret_cast<const T*>(m_data + m_header->sections[type].offset);
+	}
+
+	const QChar* getCharacters(quint32 identifier, int *length) const;
+	QStringList getStyleSheetList(SectionType type, const QString &domain) const;
+	static QVector<quint32> getRuleTokens(const RuleDefinition &rule);
+	static quint32 getElementSize(SectionType type);
+	static quint32 createToken(const QChar *characters, int length);
+	quint32 getSectionCount(SectionType type) const;
+	bool checkRuleMatch(const Rule *rule, const RequestInformation &request) const;
+	bool checkRuleOptions(const Rule *rule, const RequestInformation &request) const;
+	bool hasDomain(const QString &host, quint32 domains, quint32 count) const;
+	static bool matchPattern(const QChar *pattern, int length, const QString &url, int position, bool matchEnd);
+	static bool isSubdomain(const QString &host, const QString &domain);
+	static bool isSeparator(const QChar &character);
+	static bool isTokenCharacter(const QChar &character);
+	static bool isValid(const uchar *data, qint64 size);
+
+private:
+	QFile *m_file;
+	QByteArray m_buffer;
+	const uchar *m_data;
+	const Header *m_header;
+	qint64 m_size;
+
+	static QHash<NetworkManager::ResourceType, RuleOption> m_resourceTypes;
+	static const quint32 m_magic;
+	static const quint32 m_version;
+};
+
+}
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(Otter::ContentBlockingIndex::RuleOptions)
+
+#endif
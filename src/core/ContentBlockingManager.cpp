@@ -20,6 +20,7 @@
 
 #include "ContentBlockingManager.h"
 #include "Console.h"
+#include "ContentBlockingIndex.h"
 #include "ContentBlockingProfile.h"
 #include "JsonSettings.h"
 #include "SettingsManager.h"
@@ -29,6 +30,8 @@
 #include <QtCore/QDir>
 #include <QtCore/QJsonArray>
 #include <QtCore/QJsonObject>
+#include <QtCore/QSet>
+#include <QtConcurrent/QtConcurrentRun>
 #include <QtGui/QStandardItemModel>
 
 namespace Otter
@@ -36,13 +39,21 @@ namespace Otter
 
 ContentBlockingManager* ContentBlockingManager::m_instance(nullptr);
 QVector<ContentBlockingProfile*> ContentBlockingManager::m_profiles;
-ContentBlockingManager::CosmeticFiltersMode ContentBlockingManager::m_cosmeticFiltersMode(AllFiltersMode);
-bool ContentBlockingManager::m_areWildcardsEnabled(true);
+QReadWriteLock ContentBlockingManager::m_profilesLock;
+QAtomicInt ContentBlockingManager::m_cosmeticFiltersMode(AllFiltersMode);
+QAtomicInt ContentBlockingManager::m_areWildcardsEnabled(1);
+QCache<quint64, ContentBlockingManager::CachedDecision> ContentBlockingManager::m_cache(1024);
+QMutex ContentBlockingManager::m_cacheMutex;
+QAtomicInt ContentBlockingManager::m_cacheHits(0);
+QAtomicInt ContentBlockingManager::m_cacheMisses(0);
+QCache<quint64, ContentBlockingManager::GenericStyleSheet> ContentBlockingManager::m_genericStyleSheets(4);
+QHash<quint64, ContentBlockingManager::MergedIndex> ContentBlockingManager::m_mergedIndexes;
+QMutex ContentBlockingManager::m_mergedIndexesMutex;
 
 ContentBlockingManager::ContentBlockingManager(QObject *parent) : QObject(parent),
 	m_saveTimer(0)
 {
-	m_areWildcardsEnabled = SettingsManager::getOption(SettingsManager::ContentBlocking_EnableWildcardsOption).toBool();
+	m_areWildcardsEnabled.store(SettingsManager::getOption(SettingsManager::ContentBlocking_EnableWildcardsOption).toBool() ? 1 : 0);
 
 	handleOptionChanged(SettingsManager::ContentBlocking_CosmeticFiltersModeOption, SettingsManager::getOption(SettingsManager::ContentBlocking_CosmeticFiltersModeOption).toString());
 
@@ -54,6 +65,21 @@ void ContentBlockingManager::createInstance()
 	if (!m_instance)
 	{
 		m_instance = new ContentBlockingManager(QCoreApplication::instance());
+
+		const QVector<ContentBlockingProfile*> profiles(getProfiles());
+
+		if (SettingsManager::getOption(SettingsManager::ContentBlocking_EnableContentBlockingOption).toBool())
+		{
+			const QStringList names(SettingsManager::getOption(SettingsManager::ContentBlocking_ProfilesOption).toStringList());
+
+			for (int i = 0; i < profiles.count(); ++i)
+			{
+				if (names.contains(profiles.at(i)->getName()))
+				{
+					profiles.at(i)->loadRules();
+				}
+			}
+		}
 	}
 }
 
@@ -154,8 +180,14 @@ void ContentBlockingManager::addProfile(ContentBlockingProfile *profile)
 {
 	if (profile)
 	{
+		m_profilesLock.lockForWrite();
+
 		m_profiles.append(profile);
 
+		m_profilesLock.unlock();
+
+		clearCache();
+
 		getInstance()->scheduleSave();
 
 		connect(profile, SIGNAL(profileModified(QString)), m_instance, SLOT(scheduleSave()));
@@ -167,7 +199,9 @@ void ContentBlockingManager::handleOptionChanged(int identifier, const QVariant
 	switch (identifier)
 	{
 		case SettingsManager::ContentBlocking_EnableWildcardsOption:
-			m_areWildcardsEnabled = value.toBool();
+			m_areWildcardsEnabled.store(value.toBool() ? 1 : 0);
+
+			clearCache();
 
 			break;
 		case SettingsManager::ContentBlocking_CosmeticFiltersModeOption:
@@ -176,18 +210,20 @@ void ContentBlockingManager::handleOptionChanged(int identifier, const QVariant
 
 				if (cosmeticFiltersMode == QLatin1String("none"))
 				{
-					m_cosmeticFiltersMode = NoFiltersMode;
+					m_cosmeticFiltersMode.store(NoFiltersMode);
 				}
 				else if (cosmeticFiltersMode == QLatin1String("domainOnly"))
 				{
-					m_cosmeticFiltersMode = DomainOnlyFiltersMode;
+					m_cosmeticFiltersMode.store(DomainOnlyFiltersMode);
 				}
 				else
 				{
-					m_cosmeticFiltersMode = AllFiltersMode;
+					m_cosmeticFiltersMode.store(AllFiltersMode);
 				}
 			}
 
+			clearCache();
+
 			break;
 		default:
 			return;
@@ -227,8 +263,14 @@ void ContentBlockingManager::removeProfile(ContentBlockingProfile *profile)
 	localSettings.setObject(localMainObject);
 	localSettings.save();
 
+	m_profilesLock.lockForWrite();
+
 	m_profiles.removeAll(profile);
 
+	m_profilesLock.unlock();
+
+	clearCache();
+
 	profile->deleteLater();
 }
 
@@ -344,25 +386,75 @@ ContentBlockingManager::CheckResult ContentBlockingManager::checkUrl(const QVect
 		return CheckResult();
 	}
 
+	const QString host(baseUrl.host());
+	const QString url(requestUrl.url());
+	QReadLocker locker(&m_profilesLock);
+	const quint64 profilesKey(getProfilesKey(profiles));
+	quint64 key(profilesKey);
+	key = ((key ^ qHash(host)) * 1099511628211ULL);
+	key = ((key ^ qHash(url)) * 1099511628211ULL);
+	key = ((key ^ static_cast<quint32>(resourceType)) * 1099511628211ULL);
+
+	m_cacheMutex.lock();
+
+	const CachedDecision *cachedDecision(m_cache.object(key));
+
+	if (cachedDecision && cachedDecision->profiles == profilesKey && cachedDecision->resourceType == resourceType && cachedDecision->host == host && cachedDecision->url == url)
+	{
+		const CheckResult result(cachedDecision->result);
+
+		m_cacheMutex.unlock();
+
+		m_cacheHits.ref();
+
+		return result;
+	}
+
+	m_cacheMutex.unlock();
+
+	m_cacheMisses.ref();
+
+	const ContentBlockingIndex::RequestInformation request(ContentBlockingIndex::createRequest(baseUrl, requestUrl, resourceType));
+	const std::shared_ptr<const ContentBlockingIndex> mergedIndex(getMergedIndex(profiles, profilesKey));
 	CheckResult result;
 
-	for (int i = 0; i < profiles.count(); ++i)
+	if (mergedIndex)
 	{
-		if (profiles[i] >= 0 && profiles[i] < m_profiles.count())
+		result = mergedIndex->checkUrl(request);
+	}
+	else
+	{
+		for (int i = 0; i < profiles.count(); ++i)
 		{
-			const CheckResult currentResult(m_profiles.at(profiles[i])->checkUrl(baseUrl, requestUrl, resourceType));
-
-			if (currentResult.isBlocked)
-			{
-				result = currentResult;
-			}
-			else if (currentResult.isException)
+			if (profiles[i] >= 0 && profiles[i] < m_profiles.count())
 			{
-				return currentResult;
+				const CheckResult currentResult(m_profiles.at(profiles[i])->checkUrl(request));
+
+				if (currentResult.isBlocked)
+				{
+					result = currentResult;
+				}
+				else if (currentResult.isException)
+				{
+					result = currentResult;
+
+					break;
+				}
 			}
 		}
 	}
 
+	CachedDecision *decision(new CachedDecision());
+	decision->host = host;
+	decision->url = url;
+	decision->result = result;
+	decision->profiles = profilesKey;
+	decision->resourceType = resourceType;
+
+	m_cacheMutex.lock();
+	m_cache.insert(key, decision);
+	m_cacheMutex.unlock();
+
 	return result;
 }
 
@@ -384,49 +476,267 @@ QStringList ContentBlockingManager::createSubdomainList(const QString &domain)
 	return subdomainList;
 }
 
-QStringList ContentBlockingManager::getStyleSheet(const QVector<int> &profiles)
+void ContentBlockingManager::clearCache()
+{
+	m_cacheMutex.lock();
+	m_cache.clear();
+	m_genericStyleSheets.clear();
+	m_cacheMutex.unlock();
+
+	m_mergedIndexesMutex.lock();
+	m_mergedIndexes.clear();
+	m_mergedIndexesMutex.unlock();
+}
+
+void ContentBlockingManager::appendStyleSheetRule(QString &styleSheet, const QString &selector)
+{
+	if (selector.contains(QLatin1Char('{')) || selector.contains(QLatin1Char('}')))
+	{
+		return;
+	}
+
+	styleSheet.append(selector);
+	styleSheet.append(QLatin1String(" {display:none !important;}\n"));
+}
+
+void ContentBlockingManager::createMergedIndex(quint64 identifier, quint64 key, const QStringList &names, const QVector<std::shared_ptr<const ContentBlockingIndex> > &indexes)
+{
+	ContentBlockingIndex::IndexDefinition definition;
+	QSet<QString> rules;
+
+	for (int i = 0; i < indexes.count(); ++i)
+	{
+		const QVector<ContentBlockingIndex::RuleDefinition> profileRules(indexes.at(i)->getRules());
+
+		for (int j = 0; j < profileRules.count(); ++j)
+		{
+			if (rules.contains(profileRules.at(j).rule))
+			{
+				continue;
+			}
+
+			ContentBlockingIndex::RuleDefinition rule(profileRules.at(j));
+			rule.profile = names.at(i);
+
+			rules.insert(rule.rule);
+
+			definition.rules.append(rule);
+		}
+	}
+
+	const std::shared_ptr<const ContentBlockingIndex> index(ContentBlockingIndex::load(ContentBlockingIndex::compile(definition)));
+	QMutexLocker locker(&m_mergedIndexesMutex);
+
+	if (m_mergedIndexes.contains(identifier) && m_mergedIndexes[identifier].pendingKey == key)
+	{
+		m_mergedIndexes[identifier].index = index;
+		m_mergedIndexes[identifier].key = key;
+	}
+}
+
+std::shared_ptr<const ContentBlockingIndex> ContentBlockingManager::getMergedIndex(const QVector<int> &profiles, quint64 key)
 {
-	QStringList styleSheet;
+	if (profiles.count() < 2)
+	{
+		return std::shared_ptr<const ContentBlockingIndex>();
+	}
+
+	quint64 identifier(14695981039346656037ULL);
 
 	for (int i = 0; i < profiles.count(); ++i)
 	{
-		if (profiles[i] >= 0 && profiles[i] < m_profiles.count())
+		identifier = ((identifier ^ static_cast<quint32>(profiles[i])) * 1099511628211ULL);
+	}
+
+	QMutexLocker locker(&m_mergedIndexesMutex);
+	MergedIndex &mergedIndex(m_mergedIndexes[identifier]);
+
+	if (mergedIndex.profiles == profiles)
+	{
+		if (mergedIndex.index && mergedIndex.key == key)
 		{
-			styleSheet += m_profiles.at(profiles[i])->getStyleSheet();
+			return mergedIndex.index;
+		}
+
+		if (mergedIndex.pendingKey == key)
+		{
+			return std::shared_ptr<const ContentBlockingIndex>();
 		}
 	}
 
-	return styleSheet;
+	QVector<std::shared_ptr<const ContentBlockingIndex> > indexes;
+	indexes.reserve(profiles.count());
+
+	QStringList names;
+	names.reserve(profiles.count());
+
+	for (int i = 0; i < profiles.count(); ++i)
+	{
+		if (profiles[i] < 0 || profiles[i] >= m_profiles.count())
+		{
+			continue;
+		}
+
+		const std::shared_ptr<const ContentBlockingIndex> index(m_profiles.at(profiles[i])->getIndex());
+
+		if (!index)
+		{
+			return std::shared_ptr<const ContentBlockingIndex>();
+		}
+
+		indexes.append(index);
+		names.append(m_profiles.at(profiles[i])->getName());
+	}
+
+	mergedIndex.index.reset();
+	mergedIndex.profiles = profiles;
+	mergedIndex.pendingKey = key;
+
+	QtConcurrent::run(&ContentBlockingManager::createMergedIndex, identifier, key, names, indexes);
+
+	return std::shared_ptr<const ContentBlockingIndex>();
 }
 
-QStringList ContentBlockingManager::getStyleSheetBlackList(const QString &domain, const QVector<int> &profiles)
+quint64 ContentBlockingManager::getProfilesKey(const QVector<int> &profiles)
 {
-	QStringList data;
+	quint64 key(14695981039346656037ULL);
 
 	for (int i = 0; i < profiles.count(); ++i)
 	{
-		if (profiles[i] >= 0 && profiles[i] < m_profiles.count())
+		const int generation((profiles[i] >= 0 && profiles[i] < m_profiles.count()) ? m_profiles.at(profiles[i])->getGeneration() : -1);
+
+		key = ((key ^ static_cast<quint32>(profiles[i])) * 1099511628211ULL);
+		key = ((key ^ static_cast<quint32>(generation)) * 1099511628211ULL);
+	}
+
+	return key;
+}
+
+QString ContentBlockingManager::createCosmeticFiltersStyleSheet(const QVector<std::shared_ptr<const ContentBlockingIndex> > &indexes, quint64 key, const QString &domain, CosmeticFiltersMode mode)
+{
+	const QStringList domainList(createSubdomainList(domain));
+	QStringList blackList;
+	QSet<QString> whiteList;
+
+	for (int i = 0; i < indexes.count(); ++i)
+	{
+		for (int j = 0; j < domainList.count(); ++j)
+		{
+			const QStringList domainWhiteList(indexes.at(i)->getStyleSheetWhiteList(domainList.at(j)));
+
+			for (int k = 0; k < domainWhiteList.count(); ++k)
+			{
+				whiteList.insert(domainWhiteList.at(k));
+			}
+
+			blackList.append(indexes.at(i)->getStyleSheetBlackList(domainList.at(j)));
+		}
+	}
+
+	QString styleSheet;
+
+	if (mode == AllFiltersMode)
+	{
+		const GenericStyleSheet genericStyleSheet(getGenericStyleSheet(indexes, key));
+
+		styleSheet = genericStyleSheet.styleSheet;
+
+		blackList.append(genericStyleSheet.exceptions);
+	}
+
+	blackList.removeDuplicates();
+
+	for (int i = 0; i < blackList.count(); ++i)
+	{
+		if (!whiteList.contains(blackList.at(i)))
 		{
-			data.append(m_profiles.at(profiles[i])->getStyleSheetBlackList(domain));
+			appendStyleSheetRule(styleSheet, blackList.at(i));
 		}
 	}
 
-	return data;
+	return styleSheet;
 }
 
-QStringList ContentBlockingManager::getStyleSheetWhiteList(const QString &domain, const QVector<int> &profiles)
+ContentBlockingManager::GenericStyleSheet ContentBlockingManager::getGenericStyleSheet(const QVector<std::shared_ptr<const ContentBlockingIndex> > &indexes, quint64 key)
 {
-	QStringList data;
+	m_cacheMutex.lock();
+
+	if (m_genericStyleSheets.contains(key))
+	{
+		const GenericStyleSheet genericStyleSheet(*m_genericStyleSheets.object(key));
+
+		m_cacheMutex.unlock();
+
+		return genericStyleSheet;
+	}
+
+	m_cacheMutex.unlock();
+
+	QStringList selectors;
+	QSet<QString> whiteList;
+
+	for (int i = 0; i < indexes.count(); ++i)
+	{
+		const QStringList indexWhiteList(indexes.at(i)->getStyleSheetWhiteList());
+
+		for (int j = 0; j < indexWhiteList.count(); ++j)
+		{
+			whiteList.insert(indexWhiteList.at(j));
+		}
+
+		selectors.append(indexes.at(i)->getStyleSheet());
+	}
+
+	selectors.removeDuplicates();
+
+	GenericStyleSheet *genericStyleSheet(new GenericStyleSheet());
+
+	for (int i = 0; i < selectors.count(); ++i)
+	{
+		if (whiteList.contains(selectors.at(i)))
+		{
+			genericStyleSheet->exceptions.append(selectors.at(i));
+		}
+		else
+		{
+			appendStyleSheetRule(genericStyleSheet->styleSheet, selectors.at(i));
+		}
+	}
+
+	const GenericStyleSheet result(*genericStyleSheet);
+
+	m_cacheMutex.lock();
+	m_genericStyleSheets.insert(key, genericStyleSheet);
+	m_cacheMutex.unlock();
+
+	return result;
+}
+
+QFuture<QString> ContentBlockingManager::getCosmeticFiltersStyleSheet(const QVector<int> &profiles, const QString &domain, CosmeticFiltersMode mode)
+{
+	QVector<std::shared_ptr<const ContentBlockingIndex> > indexes;
+	indexes.reserve(profiles.count());
+
+	m_profilesLock.lockForRead();
 
 	for (int i = 0; i < profiles.count(); ++i)
 	{
 		if (profiles[i] >= 0 && profiles[i] < m_profiles.count())
 		{
-			data.append(m_profiles.at(profiles[i])->getStyleSheetWhiteList(domain));
+			const std::shared_ptr<const ContentBlockingIndex> index(m_profiles.at(profiles[i])->getIndex());
+
+			if (index)
+			{
+				indexes.append(index);
+			}
 		}
 	}
 
-	return data;
+	const quint64 key(getProfilesKey(profiles));
+
+	m_profilesLock.unlock();
+
+	return QtConcurrent::run(&ContentBlockingManager::createCosmeticFiltersStyleSheet, indexes, key, domain, mode);
 }
 
 QVector<ContentBlockingProfile*> ContentBlockingManager::getProfiles()
@@ -461,7 +771,8 @@ QVector<ContentBlockingProfile*> ContentBlockingManager::getProfiles()
 
 		profiles.sort();
 
-		m_profiles.reserve(profiles.count());
+		QVector<ContentBlockingProfile*> loadedProfiles;
+		loadedProfiles.reserve(profiles.count());
 
 		QJsonObject localMainObject(JsonSettings(SessionsManager::getWritableDataPath(QLatin1String("contentBlocking.json"))).object());
 		const QHash<QString, ContentBlockingProfile::ProfileCategory> categoryTitles({{QLatin1String("advertisements"), ContentBlockingProfile::AdvertisementsCategory}, {QLatin1String("annoyance"), ContentBlockingProfile::AnnoyanceCategory}, {QLatin1String("privacy"), ContentBlockingProfile::PrivacyCategory}, {QLatin1String("social"), ContentBlockingProfile::SocialCategory}, {QLatin1String("regional"), ContentBlockingProfile::RegionalCategory}, {QLatin1String("other"), ContentBlockingProfile::OtherCategory}});
@@ -523,13 +834,19 @@ QVector<ContentBlockingProfile*> ContentBlockingManager::getProfiles()
 
 			ContentBlockingProfile *profile(new ContentBlockingProfile(profiles.at(i), title, updateUrl, QDateTime::fromString(profileObject.value(QLatin1String("lastUpdate")).toString(), Qt::ISODate), languages, profileObject.value(QLatin1String("updateInterval")).toInt(), categoryTitles.value(profileObject.value(QLatin1String("category")).toString()), flags, m_instance));
 
-			m_profiles.append(profile);
+			loadedProfiles.append(profile);
 
 			connect(profile, SIGNAL(profileModified(QString)), m_instance, SIGNAL(profileModified(QString)));
 			connect(profile, SIGNAL(profileModified(QString)), m_instance, SLOT(scheduleSave()));
 		}
 
-		m_profiles.squeeze();
+		loadedProfiles.squeeze();
+
+		m_profilesLock.lockForWrite();
+
+		m_profiles = loadedProfiles;
+
+		m_profilesLock.unlock();
 	}
 
 	return m_profiles;
@@ -545,6 +862,8 @@ QVector<int> ContentBlockingManager::getProfileList(const QStringList &names)
 		getProfiles();
 	}
 
+	QReadLocker locker(&m_profilesLock);
+
 	for (int i = 0; i < m_profiles.count(); ++i)
 	{
 		if (names.contains(m_profiles.at(i)->getName()))
@@ -556,14 +875,29 @@ QVector<int> ContentBlockingManager::getProfileList(const QStringList &names)
 	return profiles;
 }
 
+ContentBlockingManager::CacheStatistics ContentBlockingManager::getCacheStatistics()
+{
+	CacheStatistics statistics;
+	statistics.hits = m_cacheHits.load();
+	statistics.misses = m_cacheMisses.load();
+
+	m_cacheMutex.lock();
+
+	statistics.size = m_cache.size();
+
+	m_cacheMutex.unlock();
+
+	return statistics;
+}
+
 ContentBlockingManager::CosmeticFiltersMode ContentBlockingManager::getCosmeticFiltersMode()
 {
-	return m_cosmeticFiltersMode;
+	return static_cast<CosmeticFiltersMode>(m_cosmeticFiltersMode.load());
 }
 
 bool ContentBlockingManager::areWildcardsEnabled()
 {
-	return m_areWildcardsEnabled;
+	return (m_areWildcardsEnabled.load() != 0);
 }
 
 }
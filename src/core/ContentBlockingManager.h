@@ -23,12 +23,20 @@
 
 #include "NetworkManager.h"
 
+#include <QtCore/QAtomicInt>
+#include <QtCore/QCache>
+#include <QtCore/QFuture>
+#include <QtCore/QMutex>
+#include <QtCore/QReadWriteLock>
 #include <QtCore/QUrl>
 #include <QtGui/QStandardItemModel>
 
+#include <memory>
+
 namespace Otter
 {
 
+class ContentBlockingIndex;
 class ContentBlockingProfile;
 
 class ContentBlockingManager final : public QObject
@@ -52,6 +60,13 @@ public:
 		bool isException = false;
 	};
 
+	struct CacheStatistics
+	{
+		int hits = 0;
+		int misses = 0;
+		int size = 0;
+	};
+
 	static void createInstance();
 	static void addProfile(ContentBlockingProfile *profile);
 	static void removeProfile(ContentBlockingProfile *profile);
@@ -60,11 +75,10 @@ public:
 	static ContentBlockingProfile* getProfile(const QString &profile);
 	static CheckResult checkUrl(const QVector<int> &profiles, const QUrl &baseUrl, const QUrl &requestUrl, NetworkManager::ResourceType resourceType);
 	static QStringList createSubdomainList(const QString &domain);
-	static QStringList getStyleSheet(const QVector<int> &profiles);
-	static QStringList getStyleSheetBlackList(const QString &domain, const QVector<int> &profiles);
-	static QStringList getStyleSheetWhiteList(const QString &domain, const QVector<int> &profiles);
+	static QFuture<QString> getCosmeticFiltersStyleSheet(const QVector<int> &profiles, const QString &domain, CosmeticFiltersMode mode);
 	static QVector<ContentBlockingProfile*> getProfiles();
 	static QVector<int> getProfileList(const QStringList &names);
+	static CacheStatistics getCacheStatistics();
 	static CosmeticFiltersMode getCosmeticFiltersMode();
 	static bool areWildcardsEnabled();
 
@@ -72,9 +86,39 @@ public slots:
 	void scheduleSave();
 
 protected:
+	struct CachedDecision
+	{
+		QString host;
+		QString url;
+		CheckResult result;
+		quint64 profiles = 0;
+		NetworkManager::ResourceType resourceType = NetworkManager::OtherType;
+	};
+
+	struct MergedIndex
+	{
+		std::shared_ptr<const ContentBlockingIndex> index;
+		QVector<int> profiles;
+		quint64 key = 0;
+		quint64 pendingKey = 0;
+	};
+
+	struct GenericStyleSheet
+	{
+		QString styleSheet;
+		QStringList exceptions;
+	};
+
 	explicit ContentBlockingManager(QObject *parent);
 
 	void timerEvent(QTimerEvent *event) override;
+	static void clearCache();
+	static void appendStyleSheetRule(QString &styleSheet, const QString &selector);
+	static void createMergedIndex(quint64 identifier, quint64 key, const QStringList &names, const QVector<std::shared_ptr<const ContentBlockingIndex> > &indexes);
+	static QString createCosmeticFiltersStyleSheet(const QVector<std::shared_ptr<const ContentBlockingIndex> > &indexes, quint64 key, const QString &domain, CosmeticFiltersMode mode);
+	static GenericStyleSheet getGenericStyleSheet(const QVector<std::shared_ptr<const ContentBlockingIndex> > &indexes, quint64 key);
+	static std::shared_ptr<const ContentBlockingIndex> getMergedIndex(const QVector<int> &profiles, quint64 key);
+	static quint64 getProfilesKey(const QVector<int> &profiles);
 
 protected slots:
 	void handleOptionChanged(int identifier, const QVariant &value);
@@ -84,8 +128,16 @@ private:
 
 	static ContentBlockingManager *m_instance;
 	static QVector<ContentBlockingProfile*> m_profiles;
-	static CosmeticFiltersMode m_cosmeticFiltersMode;
-	static bool m_areWildcardsEnabled;
+	static QReadWriteLock m_profilesLock;
+	static QAtomicInt m_cosmeticFiltersMode;
+	static QAtomicInt m_areWildcardsEnabled;
+	static QCache<quint64, CachedDecision> m_cache;
+	static QMutex m_cacheMutex;
+	static QAtomicInt m_cacheHits;
+	static QAtomicInt m_cacheMisses;
+	static QCache<quint64, GenericStyleSheet> m_genericStyleSheets;
+	static QHash<quint64, MergedIndex> m_mergedIndexes;
+	static QMutex m_mergedIndexesMutex;
 
 signals:
 	void profileModified(const QString &profile);
@@ -25,22 +25,20 @@
 #include "NetworkManagerFactory.h"
 #include "SessionsManager.h"
 
-#include <QtConcurrent/QtConcurrentRun>
 #include <QtCore/QCoreApplication>
 #include <QtCore/QDir>
+#include <QtCore/QFileInfo>
 #include <QtCore/QTextStream>
+#include <QtConcurrent/QtConcurrentRun>
 #include <QtNetwork/QNetworkReply>
 #include <QtNetwork/QNetworkRequest>
 
 namespace Otter
 {
 
-QVector<QChar> ContentBlockingProfile::m_separators({QLatin1Char('_'), QLatin1Char('-'), QLatin1Char('.'), QLatin1Char('%')});
-QHash<QString, ContentBlockingProfile::RuleOption> ContentBlockingProfile::m_options({{QLatin1String("third-party"), ThirdPartyOption}, {QLatin1String("stylesheet"), StyleSheetOption}, {QLatin1String("image"), ImageOption}, {QLatin1String("script"), ScriptOption}, {QLatin1String("object"), ObjectOption}, {QLatin1String("object-subrequest"), ObjectSubRequestOption}, {QLatin1String("object_subrequest"), ObjectSubRequestOption}, {QLatin1String("subdocument"), SubDocumentOption}, {QLatin1String("xmlhttprequest"), XmlHttpRequestOption}, {QLatin1String("websocket"), WebSocketOption}, {QLatin1String("popup"), PopupOption}, {QLatin1String("elemhide"), ElementHideOption}, {QLatin1String("generichide"), GenericHideOption}});
-QHash<NetworkManager::ResourceType, ContentBlockingProfile::RuleOption> ContentBlockingProfile::m_resourceTypes({{NetworkManager::ImageType, ImageOption}, {NetworkManager::ScriptType, ScriptOption}, {NetworkManager::StyleSheetType, StyleSheetOption}, {NetworkManager::ObjectType, ObjectOption}, {NetworkManager::XmlHttpRequestType, XmlHttpRequestOption}, {NetworkManager::SubFrameType, SubDocumentOption},{NetworkManager::PopupType, PopupOption}, {NetworkManager::ObjectSubrequestType, ObjectSubRequestOption}, {NetworkManager::WebSocketType, WebSocketOption}});
+QHash<QString, ContentBlockingIndex::RuleOption> ContentBlockingProfile::m_options({{QLatin1String("third-party"), ContentBlockingIndex::ThirdPartyOption}, {QLatin1String("stylesheet"), ContentBlockingIndex::StyleSheetOption}, {QLatin1String("image"), ContentBlockingIndex::ImageOption}, {QLatin1String("script"), ContentBlockingIndex::ScriptOption}, {QLatin1String("object"), ContentBlockingIndex::ObjectOption}, {QLatin1String("object-subrequest"), ContentBlockingIndex::ObjectSubRequestOption}, {QLatin1String("object_subrequest"), ContentBlockingIndex::ObjectSubRequestOption}, {QLatin1String("subdocument"), ContentBlockingIndex::SubDocumentOption}, {QLatin1String("xmlhttprequest"), ContentBlockingIndex::XmlHttpRequestOption}, {QLatin1String("websocket"), ContentBlockingIndex::WebSocketOption}, {QLatin1String("popup"), ContentBlockingIndex::PopupOption}, {QLatin1String("elemhide"), ContentBlockingIndex::ElementHideOption}, {QLatin1String("generichide"), ContentBlockingIndex::GenericHideOption}});
 
 ContentBlockingProfile::ContentBlockingProfile(const QString &name, const QString &title, const QUrl &updateUrl, const QDateTime &lastUpdate, const QStringList &languages, int updateInterval, const ProfileCategory &category, const ProfileFlags &flags, QObject *parent) : QObject(parent),
-	m_root(nullptr),
 	m_networkReply(nullptr),
 	m_name(name),
 	m_title(title),
@@ -49,9 +47,11 @@ ContentBlockingProfile::ContentBlockingProfile(const QString &name, const QStrin
 	m_category(category),
 	m_flags(flags),
 	m_updateInterval(updateInterval),
+	m_loadingIdentifier(0),
 	m_isUpdating(false),
 	m_isEmpty(true),
-	m_wasLoaded(false)
+	m_isLoading(false),
+	m_needsLoading(false)
 {
 	if (languages.isEmpty())
 	{
@@ -68,23 +68,32 @@ ContentBlockingProfile::ContentBlockingProfile(const QString &name, const QStrin
 	loadHeader(getPath());
 }
 
+ContentBlockingProfile::~ContentBlockingProfile()
+{
+	m_mutex.lock();
+
+	m_needsLoading = false;
+
+	++m_loadingIdentifier;
+
+	QFuture<void> loadingFuture(m_loadingFuture);
+
+	m_mutex.unlock();
+
+	loadingFuture.waitForFinished();
+}
+
 void ContentBlockingProfile::clear()
 {
-	if (!m_wasLoaded)
-	{
-		return;
-	}
+	QMutexLocker locker(&m_mutex);
 
-	if (m_root)
-	{
-		QtConcurrent::run(this, &ContentBlockingProfile::deleteNode, m_root);
-	}
+	m_needsLoading = false;
 
-	m_styleSheet.clear();
-	m_styleSheetWhiteList.clear();
-	m_styleSheetBlackList.clear();
+	++m_loadingIdentifier;
 
-	m_wasLoaded = false;
+	std::atomic_store(&m_index, std::shared_ptr<const ContentBlockingIndex>());
+
+	m_generation.ref();
 }
 
 void ContentBlockingProfile::loadHeader(const QString &path)
@@ -141,7 +150,7 @@ void ContentBlockingProfile::loadHeader(const QString &path)
 	}
 }
 
-void ContentBlockingProfile::parseRuleLine(QString line)
+void ContentBlockingProfile::parseRuleLine(QString line, ContentBlockingIndex::IndexDefinition &definition) const
 {
 	if (line.indexOf(QLatin1Char('!')) == 0 || line.isEmpty())
 	{
@@ -152,7 +161,7 @@ void ContentBlockingProfile::parseRuleLine(QString line)
 	{
 		if (ContentBlockingManager::getCosmeticFiltersMode() == ContentBlockingManager::AllFiltersMode)
 		{
-			m_styleSheet.append(line.mid(2));
+			definition.styleSheet.append(line.mid(2));
 		}
 
 		return;
@@ -162,7 +171,7 @@ void ContentBlockingProfile::parseRuleLine(QString line)
 	{
 		if (ContentBlockingManager::getCosmeticFiltersMode() != ContentBlockingManager::NoFiltersMode)
 		{
-			parseStyleSheetRule(line.split(QLatin1String("##")), m_styleSheetBlackList);
+			parseStyleSheetRule(line.split(QLatin1String("##")), definition.styleSheetBlackList);
 		}
 
 		return;
@@ -172,7 +181,7 @@ void ContentBlockingProfile::parseRuleLine(QString line)
 	{
 		if (ContentBlockingManager::getCosmeticFiltersMode() != ContentBlockingManager::NoFiltersMode)
 		{
-			parseStyleSheetRule(line.split(QLatin1String("#@#")), m_styleSheetWhiteList);
+			parseStyleSheetRule(line.split(QLatin1String("#@#")), definition.styleSheetWhiteList);
 		}
 
 		return;
@@ -206,8 +215,8 @@ void ContentBlockingProfile::parseRuleLine(QString line)
 
 	QStringList allowedDomains;
 	QStringList blockedDomains;
-	RuleOptions ruleOptions;
-	RuleMatch ruleMatch(ContainsMatch);
+	ContentBlockingIndex::RuleOptions ruleOptions;
+	ContentBlockingIndex::RuleMatch ruleMatch(ContentBlockingIndex::ContainsMatch);
 	bool isException(false);
 	bool needsDomainCheck(false);
 
@@ -227,14 +236,14 @@ void ContentBlockingProfile::parseRuleLine(QString line)
 
 	if (line.startsWith(QLatin1Char('|')))
 	{
-		ruleMatch = StartMatch;
+		ruleMatch = ContentBlockingIndex::StartMatch;
 
 		line = line.mid(1);
 	}
 
 	if (line.endsWith(QLatin1Char('|')))
 	{
-		ruleMatch = (ruleMatch == StartMatch ? ExactMatch : EndMatch);
+		ruleMatch = ((ruleMatch == ContentBlockingIndex::StartMatch) ? ContentBlockingIndex::ExactMatch : ContentBlockingIndex::EndMatch);
 
 		line = line.left(line.length() - 1);
 	}
@@ -246,9 +255,9 @@ void ContentBlockingProfile::parseRuleLine(QString line)
 
 		if (m_options.contains(optionName))
 		{
-			const RuleOption option(m_options.value(optionName));
+			const ContentBlockingIndex::RuleOption option(m_options.value(optionName));
 
-			if ((!isException || optionException) && (option == ElementHideOption || option == GenericHideOption))
+			if ((!isException || optionException) && (option == ContentBlockingIndex::ElementHideOption || option == ContentBlockingIndex::GenericHideOption))
 			{
 				continue;
 			}
@@ -256,9 +265,9 @@ void ContentBlockingProfile::parseRuleLine(QString line)
 			{
 				ruleOptions |= option;
 			}
-			else if (option != WebSocketOption && option != PopupOption)
+			else if (option != ContentBlockingIndex::WebSocketOption && option != ContentBlockingIndex::PopupOption)
 			{
-				ruleOptions |= static_cast<RuleOption>(option * 2);
+				ruleOptions |= static_cast<ContentBlockingIndex::RuleOption>(option * 2);
 			}
 		}
 		else if (optionName.startsWith(QLatin1String("domain")))
@@ -283,7 +292,17 @@ void ContentBlockingProfile::parseRuleLine(QString line)
 		}
 	}
 
-	addRule(new ContentBlockingRule(rule, blockedDomains, allowedDomains, ruleOptions, ruleMatch, isException, needsDomainCheck), line);
+	ContentBlockingIndex::RuleDefinition definitionRule;
+	definitionRule.rule = rule;
+	definitionRule.pattern = line;
+	definitionRule.blockedDomains = blockedDomains;
+	definitionRule.allowedDomains = allowedDomains;
+	definitionRule.options = static_cast<quint32>(ruleOptions);
+	definitionRule.match = ruleMatch;
+	definitionRule.isException = isException;
+	definitionRule.needsDomainCheck = needsDomainCheck;
+
+	definition.rules.append(definitionRule);
 }
 
 void ContentBlockingProfile::parseStyleSheetRule(const QStringList &line, QMultiHash<QString, QString> &list) const
@@ -296,290 +315,6 @@ void ContentBlockingProfile::parseStyleSheetRule(const QStringList &line, QMulti
 	}
 }
 
-void ContentBlockingProfile::addRule(ContentBlockingRule *rule, const QString &ruleString) const
-{
-	Node *node(m_root);
-
-	for (int i = 0; i < ruleString.length(); ++i)
-	{
-		const QChar value(ruleString.at(i));
-		bool childrenExists(false);
-
-		for (int j = 0; j < node->children.count(); ++j)
-		{
-			Node *nextNode(node->children.at(j));
-
-			if (nextNode->value == value)
-			{
-				node = nextNode;
-
-				childrenExists = true;
-
-				break;
-			}
-		}
-
-		if (!childrenExists)
-		{
-			Node *newNode(new Node());
-			newNode->value = value;
-
-			if (value == QLatin1Char('^'))
-			{
-				node->children.insert(0, newNode);
-			}
-			else
-			{
-				node->children.append(newNode);
-			}
-
-			node = newNode;
-		}
-	}
-
-	node->rules.append(rule);
-}
-
-void ContentBlockingProfile::deleteNode(Node *node) const
-{
-	for (int i = 0; i < node->children.count(); ++i)
-	{
-		deleteNode(node->children.at(i));
-	}
-
-	for (int i = 0; i < node->rules.count(); ++i)
-	{
-		delete node->rules.at(i);
-	}
-
-	delete node;
-}
-
-ContentBlockingManager::CheckResult ContentBlockingProfile::checkUrlSubstring(Node *node, const QString &subString, QString currentRule, NetworkManager::ResourceType resourceType)
-{
-	ContentBlockingManager::CheckResult result;
-	ContentBlockingManager::CheckResult currentResult;
-
-	for (int i = 0; i < subString.length(); ++i)
-	{
-		const QChar treeChar(subString.at(i));
-		bool childrenExists(false);
-
-		currentResult = evaluateRulesInNode(node, currentRule, resourceType);
-
-		if (currentResult.isBlocked)
-		{
-			result = currentResult;
-		}
-		else if (currentResult.isException)
-		{
-			return currentResult;
-		}
-
-		for (int j = 0; j < node->children.count(); ++j)
-		{
-			Node *nextNode(node->children.at(j));
-
-			if (nextNode->value == QLatin1Char('*'))
-			{
-				const QString wildcardSubString(subString.mid(i));
-
-				for (int k = 0; k < wildcardSubString.length(); ++k)
-				{
-					currentResult = checkUrlSubstring(nextNode, wildcardSubString.right(wildcardSubString.length() - k), currentRule + wildcardSubString.left(k), resourceType);
-
-					if (currentResult.isBlocked)
-					{
-						result = currentResult;
-					}
-					else if (currentResult.isException)
-					{
-						return currentResult;
-					}
-				}
-			}
-
-			if (nextNode->value == QLatin1Char('^') && !treeChar.isDigit() && !treeChar.isLetter() && !m_separators.contains(treeChar))
-			{
-				currentResult = checkUrlSubstring(nextNode, subString.mid(i), currentRule, resourceType);
-
-				if (currentResult.isBlocked)
-				{
-					result = currentResult;
-				}
-				else if (currentResult.isException)
-				{
-					return currentResult;
-				}
-			}
-
-			if (nextNode->value == treeChar)
-			{
-				node = nextNode;
-
-				childrenExists = true;
-
-				break;
-			}
-		}
-
-		if (!childrenExists)
-		{
-			return result;
-		}
-
-		currentRule += treeChar;
-	}
-
-	currentResult = evaluateRulesInNode(node, currentRule, resourceType);
-
-	if (currentResult.isBlocked)
-	{
-		result = currentResult;
-	}
-	else if (currentResult.isException)
-	{
-		return currentResult;
-	}
-
-	for (int i = 0; i < node->children.count(); ++i)
-	{
-		if (node->children.at(i)->value == QLatin1Char('^'))
-		{
-			currentResult = evaluateRulesInNode(node, currentRule, resourceType);
-
-			if (currentResult.isBlocked)
-			{
-				result = currentResult;
-			}
-			else if (currentResult.isException)
-			{
-				return currentResult;
-			}
-		}
-	}
-
-	return result;
-}
-
-ContentBlockingManager::CheckResult ContentBlockingProfile::checkRuleMatch(ContentBlockingRule *rule, const QString &currentRule, NetworkManager::ResourceType resourceType) const
-{
-	switch (rule->ruleMatch)
-	{
-		case StartMatch:
-			if (!m_requestUrl.startsWith(currentRule))
-			{
-				return ContentBlockingManager::CheckResult();
-			}
-
-			break;
-		case EndMatch:
-			if (!m_requestUrl.endsWith(currentRule))
-			{
-				return ContentBlockingManager::CheckResult();
-			}
-
-			break;
-		case ExactMatch:
-			if (m_requestUrl != currentRule)
-			{
-				return ContentBlockingManager::CheckResult();
-			}
-
-			break;
-		default:
-			if (!m_requestUrl.contains(currentRule))
-			{
-				return ContentBlockingManager::CheckResult();
-			}
-
-			break;
-	}
-
-	const QStringList requestSubdomainList(ContentBlockingManager::createSubdomainList(m_requestHost));
-
-	if (rule->needsDomainCheck && !requestSubdomainList.contains(currentRule.left(currentRule.indexOf(m_domainExpression))))
-	{
-		return ContentBlockingManager::CheckResult();
-	}
-
-	const bool hasBlockedDomains(!rule->blockedDomains.isEmpty());
-	const bool hasAllowedDomains(!rule->allowedDomains.isEmpty());
-	bool isBlocked(hasBlockedDomains ? resolveDomainExceptions(m_baseUrlHost, rule->blockedDomains) : true);
-	isBlocked = (hasAllowedDomains ? !resolveDomainExceptions(m_baseUrlHost, rule->allowedDomains) : isBlocked);
-
-	if (rule->ruleOptions.testFlag(ThirdPartyExceptionOption) || rule->ruleOptions.testFlag(ThirdPartyOption))
-	{
-		if (m_baseUrlHost.isEmpty() || requestSubdomainList.contains(m_baseUrlHost))
-		{
-			isBlocked = rule->ruleOptions.testFlag(ThirdPartyExceptionOption);
-		}
-		else if (!hasBlockedDomains && !hasAllowedDomains)
-		{
-			isBlocked = rule->ruleOptions.testFlag(ThirdPartyOption);
-		}
-	}
-
-	if (rule->ruleOptions != NoOption)
-	{
-		QHash<NetworkManager::ResourceType, RuleOption>::const_iterator iterator;
-
-		for (iterator = m_resourceTypes.begin(); iterator != m_resourceTypes.end(); ++iterator)
-		{
-			const bool supportsException(iterator.value() != WebSocketOption && iterator.value() != PopupOption);
-
-			if (rule->ruleOptions.testFlag(iterator.value()) || (supportsException && rule->ruleOptions.testFlag(static_cast<RuleOption>(iterator.value() * 2))))
-			{
-				if (resourceType == iterator.key())
-				{
-					isBlocked = (isBlocked ? rule->ruleOptions.testFlag(iterator.value()) : isBlocked);
-				}
-				else if (supportsException)
-				{
-					isBlocked = (isBlocked ? rule->ruleOptions.testFlag(static_cast<RuleOption>(iterator.value() * 2)) : isBlocked);
-				}
-				else
-				{
-					isBlocked = false;
-				}
-			}
-		}
-	}
-	else if (resourceType == NetworkManager::PopupType)
-	{
-		isBlocked = false;
-	}
-
-	if (isBlocked)
-	{
-		ContentBlockingManager::CheckResult result;
-		result.rule = rule->rule;
-
-		if (rule->isException)
-		{
-			result.isBlocked = false;
-			result.isException = true;
-
-			if (rule->ruleOptions.testFlag(ElementHideOption))
-			{
-				result.comesticFiltersMode = ContentBlockingManager::NoFiltersMode;
-			}
-			else if (rule->ruleOptions.testFlag(GenericHideOption))
-			{
-				result.comesticFiltersMode = ContentBlockingManager::DomainOnlyFiltersMode;
-			}
-
-			return result;
-		}
-
-		result.isBlocked = true;
-
-		return result;
-	}
-
-	return ContentBlockingManager::CheckResult();
-}
-
 void ContentBlockingProfile::replyFinished()
 {
 	m_isUpdating = false;
@@ -599,6 +334,8 @@ void ContentBlockingProfile::replyFinished()
 	{
 		Console::addMessage(QCoreApplication::translate("main", "Failed to update content blocking profile: %1").arg(m_networkReply->errorString()), Console::OtherCategory, Console::ErrorLevel, getPath());
 
+		cancelLoading();
+
 		return;
 	}
 
@@ -611,6 +348,8 @@ void ContentBlockingProfile::replyFinished()
 		{
 			Console::addMessage(QCoreApplication::translate("main", "Failed to update content blocking profile: checksum mismatch"), Console::OtherCategory, Console::ErrorLevel, getPath());
 
+			cancelLoading();
+
 			return;
 		}
 	}
@@ -623,6 +362,8 @@ void ContentBlockingProfile::replyFinished()
 	{
 		Console::addMessage(QCoreApplication::translate("main", "Failed to update content blocking profile: %1").arg(file.errorString()), Console::OtherCategory, Console::ErrorLevel, file.fileName());
 
+		cancelLoading();
+
 		return;
 	}
 
@@ -638,14 +379,17 @@ void ContentBlockingProfile::replyFinished()
 // TODO
 	}
 
-	clear();
+	QMutexLocker locker(&m_mutex);
+
 	loadHeader(getPath());
 
-	if (m_wasLoaded)
+	if (m_needsLoading || std::atomic_load(&m_index))
 	{
-		loadRules();
+		scheduleLoading();
 	}
 
+	locker.unlock();
+
 	emit profileModified(m_name);
 }
 
@@ -706,79 +450,50 @@ QString ContentBlockingProfile::getPath() const
 	return SessionsManager::getWritableDataPath(QLatin1String("contentBlocking/%1.txt")).arg(m_name);
 }
 
-QDateTime ContentBlockingProfile::getLastUpdate() const
+QString ContentBlockingProfile::getIndexPath() const
 {
-	return m_lastUpdate;
+	return SessionsManager::getWritableDataPath(QLatin1String("contentBlocking/%1.dat")).arg(m_name);
 }
 
-QUrl ContentBlockingProfile::getUpdateUrl() const
+ContentBlockingIndex::SourceInformation ContentBlockingProfile::getSourceInformation() const
 {
-	return m_updateUrl;
+	const QFileInfo fileInformation(getPath());
+	ContentBlockingIndex::SourceInformation information;
+	information.lastModified = fileInformation.lastModified();
+	information.size = fileInformation.size();
+	information.cosmeticFiltersMode = ContentBlockingManager::getCosmeticFiltersMode();
+	information.areWildcardsEnabled = ContentBlockingManager::areWildcardsEnabled();
+
+	return information;
 }
 
-ContentBlockingManager::CheckResult ContentBlockingProfile::checkUrl(const QUrl &baseUrl, const QUrl &requestUrl, NetworkManager::ResourceType resourceType)
+QDateTime ContentBlockingProfile::getLastUpdate() const
 {
-	ContentBlockingManager::CheckResult result;
-
-	if (!m_wasLoaded && !loadRules())
-	{
-		return result;
-	}
-
-	m_baseUrlHost = baseUrl.host();
-	m_requestUrl = requestUrl.url();
-	m_requestHost = requestUrl.host();
-
-	if (m_requestUrl.startsWith(QLatin1String("//")))
-	{
-		m_requestUrl = m_requestUrl.mid(2);
-	}
-
-	for (int i = 0; i < m_requestUrl.length(); ++i)
-	{
-		ContentBlockingManager::CheckResult currentResult(checkUrlSubstring(m_root, m_requestUrl.right(m_requestUrl.length() - i), QString(), resourceType));
-
-		if (currentResult.isBlocked)
-		{
-			result = currentResult;
-		}
-		else if (currentResult.isException)
-		{
-			return currentResult;
-		}
-	}
-
-	return result;
+	return m_lastUpdate;
 }
 
-QStringList ContentBlockingProfile::getStyleSheet()
+QUrl ContentBlockingProfile::getUpdateUrl() const
 {
-	if (!m_wasLoaded)
-	{
-		loadRules();
-	}
-
-	return m_styleSheet;
+	return m_updateUrl;
 }
 
-QStringList ContentBlockingProfile::getStyleSheetBlackList(const QString &domain)
+ContentBlockingManager::CheckResult ContentBlockingProfile::checkUrl(const ContentBlockingIndex::RequestInformation &request)
 {
-	if (!m_wasLoaded)
+	const std::shared_ptr<const ContentBlockingIndex> index(getIndex());
+
+	if (!index)
 	{
-		loadRules();
+		return ContentBlockingManager::CheckResult();
 	}
 
-	return m_styleSheetBlackList.values(domain);
-}
+	ContentBlockingManager::CheckResult result(index->checkUrl(request));
 
-QStringList ContentBlockingProfile::getStyleSheetWhiteList(const QString &domain)
-{
-	if (!m_wasLoaded)
+	if (result.isBlocked || result.isException)
 	{
-		loadRules();
+		result.profile = m_name;
 	}
 
-	return m_styleSheetWhiteList.values(domain);
+	return result;
 }
 
 QVector<QLocale::Language> ContentBlockingProfile::getLanguages() const
@@ -801,6 +516,11 @@ int ContentBlockingProfile::getUpdateInterval() const
 	return m_updateInterval;
 }
 
+int ContentBlockingProfile::getGeneration() const
+{
+	return m_generation.load();
+}
+
 bool ContentBlockingProfile::downloadRules()
 {
 	if (m_isUpdating)
@@ -821,6 +541,8 @@ bool ContentBlockingProfile::downloadRules()
 			Console::addMessage(QCoreApplication::translate("main", "Failed to update content blocking profile, update URL (%1) is invalid").arg(m_updateUrl.toString()), Console::OtherCategory, Console::ErrorLevel, path);
 		}
 
+		cancelLoading();
+
 		return false;
 	}
 
@@ -836,63 +558,139 @@ bool ContentBlockingProfile::downloadRules()
 	return true;
 }
 
-ContentBlockingManager::CheckResult ContentBlockingProfile::evaluateRulesInNode(Node *node, const QString &currentRule, NetworkManager::ResourceType resourceType) const
+ContentBlockingIndex* ContentBlockingProfile::compileRules() const
 {
-	ContentBlockingManager::CheckResult result;
+	ContentBlockingIndex::IndexDefinition definition;
+	definition.source = getSourceInformation();
 
-	for (int i = 0; i < node->rules.count(); ++i)
+	QFile file(getPath());
+
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
 	{
-		if (node->rules.at(i))
-		{
-			ContentBlockingManager::CheckResult currentResult(checkRuleMatch(node->rules.at(i), currentRule, resourceType));
+		return ContentBlockingIndex::load(ContentBlockingIndex::compile(definition));
+	}
 
-			if (currentResult.isBlocked)
-			{
-				result = currentResult;
-			}
-			else if (currentResult.isException)
-			{
-				return currentResult;
-			}
+	QTextStream stream(&file);
+	stream.readLine(); // header
+
+	while (!stream.atEnd())
+	{
+		parseRuleLine(stream.readLine(), definition);
+	}
+
+	file.close();
+
+	const QByteArray data(ContentBlockingIndex::compile(definition));
+
+	if (ContentBlockingIndex::save(getIndexPath(), data))
+	{
+		ContentBlockingIndex *index(ContentBlockingIndex::load(getIndexPath(), definition.source));
+
+		if (index)
+		{
+			return index;
 		}
 	}
 
-	return result;
+	Console::addMessage(QCoreApplication::translate("main", "Failed to save compiled content blocking profile"), Console::OtherCategory, Console::WarningLevel, getIndexPath());
+
+	return ContentBlockingIndex::load(data);
 }
 
-bool ContentBlockingProfile::loadRules()
+std::shared_ptr<const ContentBlockingIndex> ContentBlockingProfile::getIndex()
 {
+	const std::shared_ptr<const ContentBlockingIndex> index(std::atomic_load(&m_index));
+
+	return (index ? index : loadRules());
+}
+
+std::shared_ptr<const ContentBlockingIndex> ContentBlockingProfile::loadRules()
+{
+	QMutexLocker locker(&m_mutex);
+	const std::shared_ptr<const ContentBlockingIndex> index(std::atomic_load(&m_index));
+
+	if (index || m_needsLoading)
+	{
+		return index;
+	}
+
 	if (m_isEmpty && !m_updateUrl.isEmpty())
 	{
-		downloadRules();
+		m_needsLoading = true;
 
-		return false;
+		QMetaObject::invokeMethod(this, "downloadRules", Qt::QueuedConnection);
+
+		return index;
 	}
 
-	m_wasLoaded = true;
+	scheduleLoading();
+
+	return index;
+}
+
+void ContentBlockingProfile::cancelLoading()
+{
+	QMutexLocker locker(&m_mutex);
 
-	if (m_domainExpression.pattern().isEmpty())
+	if (!m_isLoading)
 	{
-		m_domainExpression = QRegularExpression(QLatin1String("[:\?&/=]"));
-		m_domainExpression.optimize();
+		m_needsLoading = false;
 	}
+}
 
-	QFile file(getPath());
-	file.open(QIODevice::ReadOnly | QIODevice::Text);
-
-	QTextStream stream(&file);
-	stream.readLine(); // header
+void ContentBlockingProfile::scheduleLoading()
+{
+	m_needsLoading = true;
 
-	m_root = new Node();
+	++m_loadingIdentifier;
 
-	while (!stream.atEnd())
+	if (!m_isLoading)
 	{
-		parseRuleLine(stream.readLine());
+		m_isLoading = true;
+		m_loadingFuture = QtConcurrent::run(this, &ContentBlockingProfile::createIndex);
 	}
+}
 
-	file.close();
+void ContentBlockingProfile::createIndex()
+{
+	while (true)
+	{
+		m_mutex.lock();
 
-	return true;
+		if (!m_needsLoading)
+		{
+			m_isLoading = false;
+
+			m_mutex.unlock();
+
+			return;
+		}
+
+		const int identifier(m_loadingIdentifier);
+
+		m_mutex.unlock();
+
+		std::shared_ptr<const ContentBlockingIndex> index(ContentBlockingIndex::load(getIndexPath(), getSourceInformation()));
+
+		if (!index)
+		{
+			index.reset(compileRules());
+		}
+
+		QMutexLocker locker(&m_mutex);
+
+		if (identifier == m_loadingIdentifier)
+		{
+			std::atomic_store(&m_index, index);
+
+			m_generation.ref();
+
+			m_needsLoading = false;
+			m_isLoading = false;
+
+			return;
+		}
+	}
 }
 
 bool ContentBlockingProfile::remove()
@@ -906,25 +704,27 @@ bool ContentBlockingProfile::remove()
 		m_networkReply = nullptr;
 	}
 
-	if (QFile::exists(path))
+	clear();
+
+	m_mutex.lock();
+
+	QFuture<void> loadingFuture(m_loadingFuture);
+
+	m_mutex.unlock();
+
+	loadingFuture.waitForFinished();
+
+	if (QFile::exists(getIndexPath()))
 	{
-		return QFile::remove(path);
+		QFile::remove(getIndexPath());
 	}
 
-	return true;
-}
-
-bool ContentBlockingProfile::resolveDomainExceptions(const QString &url, const QStringList &ruleList) const
-{
-	for (int i = 0; i < ruleList.count(); ++i)
+	if (QFile::exists(path))
 	{
-		if (url.contains(ruleList.at(i)))
-		{
-			return true;
-		}
+		return QFile::remove(path);
 	}
 
-	return false;
+	return true;
 }
 
 }
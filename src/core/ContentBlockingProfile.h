@@ -22,9 +22,14 @@
 #ifndef OTTER_CONTENTBLOCKINGPROFILE_H
 #define OTTER_CONTENTBLOCKINGPROFILE_H
 
+#include "ContentBlockingIndex.h"
 #include "ContentBlockingManager.h"
 
-#include <QtCore/QRegularExpression>
+#include <QtCore/QAtomicInt>
+#include <QtCore/QFuture>
+#include <QtCore/QMutex>
+
+#include <memory>
 
 namespace Otter
 {
@@ -54,6 +59,7 @@ public:
 	};
 
 	explicit ContentBlockingProfile(const QString &name, const QString &title, const QUrl &updateUrl, const QDateTime &lastUpdate, const QStringList &languages, int updateInterval, const ProfileCategory &category, const ProfileFlags &flags, QObject *parent = nullptr);
+	~ContentBlockingProfile();
 
 	void clear();
 	void setCategory(const ProfileCategory &category);
@@ -64,115 +70,55 @@ public:
 	QString getTitle() const;
 	QUrl getUpdateUrl() const;
 	QDateTime getLastUpdate() const;
-	ContentBlockingManager::CheckResult checkUrl(const QUrl &baseUrl, const QUrl &requestUrl, NetworkManager::ResourceType resourceType);
-	QStringList getStyleSheet();
-	QStringList getStyleSheetBlackList(const QString &domain);
-	QStringList getStyleSheetWhiteList(const QString &domain);
+	ContentBlockingManager::CheckResult checkUrl(const ContentBlockingIndex::RequestInformation &request);
 	QVector<QLocale::Language> getLanguages() const;
 	ProfileCategory getCategory() const;
 	ProfileFlags getFlags() const;
 	int getUpdateInterval() const;
-	bool downloadRules();
+	int getGeneration() const;
+	std::shared_ptr<const ContentBlockingIndex> getIndex();
+	std::shared_ptr<const ContentBlockingIndex> loadRules();
 	bool remove();
 
-protected:
-	enum RuleOption : quint32
-	{
-		NoOption = 0,
-		ThirdPartyOption = 1,
-		ThirdPartyExceptionOption = 2,
-		StyleSheetOption = 4,
-		StyleSheetExceptionOption = 8,
-		ScriptOption = 16,
-		ScriptExceptionOption = 32,
-		ImageOption = 64,
-		ImageExceptionOption = 128,
-		ObjectOption = 256,
-		ObjectExceptionOption = 512,
-		ObjectSubRequestOption = 1024,
-		ObjectSubRequestExceptionOption = 2048,
-		SubDocumentOption = 4096,
-		SubDocumentExceptionOption = 8192,
-		XmlHttpRequestOption = 16384,
-		XmlHttpRequestExceptionOption = 32768,
-		WebSocketOption = 65536,
-		PopupOption = 131072,
-		ElementHideOption = 262144,
-		GenericHideOption = 524288
-	};
-
-	Q_DECLARE_FLAGS(RuleOptions, RuleOption)
-
-	enum RuleMatch
-	{
-		ContainsMatch = 0,
-		StartMatch,
-		EndMatch,
-		ExactMatch
-	};
-
-	struct ContentBlockingRule
-	{
-		QString rule;
-		QStringList blockedDomains;
-		QStringList allowedDomains;
-		RuleOptions ruleOptions = NoOption;
-		RuleMatch ruleMatch = ContainsMatch;
-		bool isException = false;
-		bool needsDomainCheck = false;
-
-		explicit ContentBlockingRule(QString ruleValue, QStringList blockedDomainsValue, QStringList allowedDomainsValue, RuleOptions ruleOptionsValue, RuleMatch ruleMatchValue, bool isExceptionValue, bool needsDomainCheckValue) : rule(ruleValue), blockedDomains(blockedDomainsValue), allowedDomains(allowedDomainsValue), ruleOptions(ruleOptionsValue), ruleMatch(ruleMatchValue), isException(isExceptionValue), needsDomainCheck(needsDomainCheckValue)
-		{
-		}
-	};
-
-	struct Node
-	{
-		QChar value = 0;
-		QVarLengthArray<Node*, 1> children;
-		QVarLengthArray<ContentBlockingRule*, 1> rules;
-	};
+public slots:
+	bool downloadRules();
 
+protected:
 	QString getPath() const;
+	QString getIndexPath() const;
 	void loadHeader(const QString &path);
-	void parseRuleLine(QString line);
+	void parseRuleLine(QString line, ContentBlockingIndex::IndexDefinition &definition) const;
 	void parseStyleSheetRule(const QStringList &line, QMultiHash<QString, QString> &list) const;
-	void addRule(ContentBlockingRule *rule, const QString &ruleString) const;
-	void deleteNode(Node *node) const;
-	ContentBlockingManager::CheckResult checkUrlSubstring(Node *node, const QString &subString, QString currentRule, NetworkManager::ResourceType resourceType);
-	ContentBlockingManager::CheckResult checkRuleMatch(ContentBlockingRule *rule, const QString &currentRule, NetworkManager::ResourceType resourceType) const;
-	ContentBlockingManager::CheckResult evaluateRulesInNode(Node *node, const QString &currentRule, NetworkManager::ResourceType resourceType) const;
-	bool loadRules();
-	bool resolveDomainExceptions(const QString &url, const QStringList &ruleList) const;
+	ContentBlockingIndex* compileRules() const;
+	ContentBlockingIndex::SourceInformation getSourceInformation() const;
+	void cancelLoading();
+	void scheduleLoading();
+	void createIndex();
 
 protected slots:
 	void replyFinished();
 
 private:
-	Node *m_root;
+	std::shared_ptr<const ContentBlockingIndex> m_index;
+	QMutex m_mutex;
+	QAtomicInt m_generation;
+	QFuture<void> m_loadingFuture;
 	QNetworkReply *m_networkReply;
-	QString m_requestUrl;
-	QString m_requestHost;
-	QString m_baseUrlHost;
 	QString m_name;
 	QString m_title;
 	QUrl m_updateUrl;
 	QDateTime m_lastUpdate;
-	QRegularExpression m_domainExpression;
-	QStringList m_styleSheet;
 	QVector<QLocale::Language> m_languages;
-	QMultiHash<QString, QString> m_styleSheetBlackList;
-	QMultiHash<QString, QString> m_styleSheetWhiteList;
 	ProfileCategory m_category;
 	ProfileFlags m_flags;
 	int m_updateInterval;
+	int m_loadingIdentifier;
 	bool m_isUpdating;
 	bool m_isEmpty;
-	bool m_wasLoaded;
+	bool m_isLoading;
+	bool m_needsLoading;
 
-	static QVector<QChar> m_separators;
-	static QHash<QString, RuleOption> m_options;
-	static QHash<NetworkManager::ResourceType, RuleOption> m_resourceTypes;
+	static QHash<QString, ContentBlockingIndex::RuleOption> m_options;
 
 signals:
 	void profileModified(const QString &profile);
@@ -19,22 +19,32 @@
 
 #include "CookieJar.h"
 #include "Application.h"
+#include "Console.h"
 #include "SessionsManager.h"
 #include "SettingsManager.h"
 
-#include <QtCore/QDataStream>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QtCore/QDateTime>
 #include <QtCore/QFile>
 #include <QtCore/QSaveFile>
+#include <QtCore/QTimer>
 #include <QtCore/QTimerEvent>
 
 namespace Otter
 {
 
+const quint32 CookieJar::m_magic(0x434b4f4f);
+const quint32 CookieJar::m_version(1);
+
 CookieJar::CookieJar(bool isPrivate, QObject *parent) : QNetworkCookieJar(parent),
+	m_domainsWatcher(nullptr),
 	m_generalCookiesPolicy(AcceptAllCookies),
 	m_thirdPartyCookiesPolicy(AcceptAllCookies),
 	m_keepMode(KeepUntilExpiresMode),
+	m_cookiesAmount(0),
+	m_recordsAmount(0),
 	m_saveTimer(0),
+	m_needsCompaction(false),
 	m_isPrivate(isPrivate)
 {
 	if (isPrivate)
@@ -42,42 +52,27 @@ CookieJar::CookieJar(bool isPrivate, QObject *parent) : QNetworkCookieJar(parent
 		return;
 	}
 
-	QFile file(SessionsManager::getWritableDataPath(QLatin1String("cookies.dat")));
+	loadCookies();
+	handleOptionChanged(SettingsManager::Network_CookiesPolicyOption, SettingsManager::getOption(SettingsManager::Network_CookiesPolicyOption));
 
-	if (!file.open(QIODevice::ReadOnly))
+	if (!m_pendingDomains.isEmpty())
 	{
-		return;
+		QTimer::singleShot(1000, this, SLOT(preloadDomains()));
 	}
 
-	QList<QNetworkCookie> allCookies;
-	QDataStream stream(&file);
-	quint32 amount;
-
-	stream >> amount;
+	connect(SettingsManager::getInstance(), SIGNAL(optionChanged(int,QVariant)), this, SLOT(handleOptionChanged(int,QVariant)));
+}
 
-	for (quint32 i = 0; i < amount; ++i)
+CookieJar::~CookieJar()
+{
+	if (m_saveTimer != 0)
 	{
-		QByteArray value;
+		killTimer(m_saveTimer);
 
-		stream >> value;
+		m_saveTimer = 0;
 
-		const QList<QNetworkCookie> cookies(QNetworkCookie::parseCookies(value));
-
-		for (int j = 0; j < cookies.count(); ++j)
-		{
-			allCookies.append(cookies.at(j));
-		}
-
-		if (stream.atEnd())
-		{
-			break;
-		}
+		save();
 	}
-
-	handleOptionChanged(SettingsManager::Network_CookiesPolicyOption, SettingsManager::getOption(SettingsManager::Network_CookiesPolicyOption));
-	setAllCookies(allCookies);
-
-	connect(SettingsManager::getInstance(), SIGNAL(optionChanged(int,QVariant)), this, SLOT(handleOptionChanged(int,QVariant)));
 }
 
 void CookieJar::timerEvent(QTimerEvent *event)
@@ -98,12 +93,17 @@ void CookieJar::clearCookies(int period)
 {
 	Q_UNUSED(period)
 
-	const QList<QNetworkCookie> cookies(allCookies());
+	const QVector<QNetworkCookie> cookies(getCookies());
+
+	m_cookies.clear();
+	m_pendingRecords.clear();
+
+	m_cookiesAmount = 0;
+
+	m_needsCompaction = true;
 
 	for (int i = 0; i < cookies.count(); ++i)
 	{
-		QNetworkCookieJar::deleteCookie(cookies.at(i));
-
 		emit cookieRemoved(cookies.at(i));
 	}
 
@@ -128,6 +128,277 @@ void CookieJar::scheduleSave()
 	}
 }
 
+void CookieJar::appendRecord(CookieOperation operation, const QNetworkCookie &cookie)
+{
+	if (m_isPrivate)
+	{
+		return;
+	}
+
+	QDataStream stream(&m_pendingRecords, QIODevice::Append);
+	stream.setVersion(QDataStream::Qt_5_0);
+	stream << static_cast<quint8>(operation);
+
+	writeCookie(stream, cookie);
+
+	++m_recordsAmount;
+
+	scheduleSave();
+}
+
+void CookieJar::loadCookies()
+{
+	QFile file(SessionsManager::getWritableDataPath(QLatin1String("cookies.dat")));
+
+	if (file.open(QIODevice::ReadOnly))
+	{
+		QDataStream stream(&file);
+		stream.setVersion(QDataStream::Qt_5_0);
+
+		quint32 magic(0);
+		quint32 version(0);
+
+		stream >> magic >> version;
+
+		if (magic != m_magic || version != m_version)
+		{
+			file.seek(0);
+
+			stream.resetStatus();
+
+			importCookies(stream);
+		}
+		else if (file.size() > 8)
+		{
+			qint64 tableOffset(0);
+			quint32 amount(0);
+
+			file.seek(file.size() - 8);
+
+			stream >> tableOffset;
+
+			bool isValid(stream.status() == QDataStream::Ok && tableOffset >= 8 && tableOffset <= (file.size() - 16) && file.seek(tableOffset));
+
+			if (isValid)
+			{
+				stream >> m_cookiesAmount >> amount;
+
+				isValid = (stream.status() == QDataStream::Ok && static_cast<qint64>(amount) <= ((file.size() - 8 - file.pos()) / 12));
+			}
+
+			for (quint32 i = 0; (isValid && i < amount); ++i)
+			{
+				QString domain;
+				qint64 offset(0);
+
+				stream >> domain >> offset;
+
+				isValid = (stream.status() == QDataStream::Ok && offset >= 8 && offset < tableOffset);
+
+				if (isValid)
+				{
+					m_pendingDomains[domain] = offset;
+				}
+			}
+
+			if (!isValid)
+			{
+				m_pendingDomains.clear();
+
+				recoverCookies(&file, ((tableOffset >= 8 && tableOffset < (file.size() - 8)) ? tableOffset : (file.size() - 8)));
+			}
+		}
+
+		file.close();
+	}
+
+	QFile journalFile(SessionsManager::getWritableDataPath(QLatin1String("cookies.journal")));
+
+	if (!journalFile.open(QIODevice::ReadOnly))
+	{
+		return;
+	}
+
+	QDataStream stream(&journalFile);
+	stream.setVersion(QDataStream::Qt_5_0);
+
+	quint32 magic(0);
+	quint32 version(0);
+
+	stream >> magic >> version;
+
+	if (magic != m_magic || version != m_version)
+	{
+		m_needsCompaction = true;
+
+		scheduleSave();
+
+		return;
+	}
+
+	while (!stream.atEnd())
+	{
+		quint8 operation(0);
+
+		stream >> operation;
+
+		const QNetworkCookie cookie(readCookie(stream));
+
+		if (stream.status() != QDataStream::Ok || operation > RemoveCookie)
+		{
+			m_needsCompaction = true;
+
+			break;
+		}
+
+		takeCookie(cookie);
+
+		if (operation != RemoveCookie)
+		{
+			m_cookies[getRegistrableDomain(cookie.domain())].append(cookie);
+		}
+
+		++m_recordsAmount;
+	}
+}
+
+void CookieJar::importCookies(QDataStream &stream)
+{
+	quint32 amount(0);
+
+	stream >> amount;
+
+	for (quint32 i = 0; i < amount; ++i)
+	{
+		QByteArray value;
+
+		stream >> value;
+
+		const QList<QNetworkCookie> cookies(QNetworkCookie::parseCookies(value));
+
+		for (int j = 0; j < cookies.count(); ++j)
+		{
+			takeCookie(cookies.at(j));
+
+			m_cookies[getRegistrableDomain(cookies.at(j).domain())].append(cookies.at(j));
+		}
+
+		if (stream.atEnd())
+		{
+			break;
+		}
+	}
+
+	m_needsCompaction = true;
+
+	scheduleSave();
+}
+
+void CookieJar::recoverCookies(QFile *file, qint64 end)
+{
+	QDataStream stream(file);
+	stream.setVersion(QDataStream::Qt_5_0);
+
+	int cookiesAmount(0);
+
+	file->seek(8);
+
+	while (file->pos() < end)
+	{
+		const QVector<QNetworkCookie> cookies(readCookies(stream));
+
+		if (stream.status() != QDataStream::Ok || file->pos() > end)
+		{
+			break;
+		}
+
+		for (int i = 0; i < cookies.count(); ++i)
+		{
+			if (!cookies.at(i).name().isEmpty() && !cookies.at(i).domain().isEmpty())
+			{
+				m_cookies[getRegistrableDomain(cookies.at(i).domain())].append(cookies.at(i));
+
+				++cookiesAmount;
+			}
+		}
+	}
+
+	file->close();
+
+	m_cookiesAmount = cookiesAmount;
+
+	const QString backupPath(file->fileName() + QLatin1String(".bak"));
+
+	QFile::remove(backupPath);
+
+	if (QFile::copy(file->fileName(), backupPath))
+	{
+		m_needsCompaction = true;
+	}
+	else
+	{
+		Console::addMessage(tr("Failed to back up damaged cookies file"), Console::OtherCategory, Console::ErrorLevel, file->fileName());
+	}
+}
+
+void CookieJar::loadDomain(const QString &domain) const
+{
+	const QHash<QString, qint64>::iterator iterator(m_pendingDomains.find(domain));
+
+	if (iterator == m_pendingDomains.end())
+	{
+		return;
+	}
+
+	const qint64 offset(iterator.value());
+
+	m_pendingDomains.erase(iterator);
+
+	QFile file(SessionsManager::getWritableDataPath(QLatin1String("cookies.dat")));
+
+	if (!file.open(QIODevice::ReadOnly) || !file.seek(offset))
+	{
+		return;
+	}
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_5_0);
+
+	m_cookies[domain] += readCookies(stream);
+}
+
+void CookieJar::loadDomains() const
+{
+	if (m_pendingDomains.isEmpty())
+	{
+		return;
+	}
+
+	const QHash<QString, QVector<QNetworkCookie> > cookies(readDomains(SessionsManager::getWritableDataPath(QLatin1String("cookies.dat")), m_pendingDomains));
+	QHash<QString, QVector<QNetworkCookie> >::const_iterator iterator;
+
+	for (iterator = cookies.constBegin(); iterator != cookies.constEnd(); ++iterator)
+	{
+		m_cookies[iterator.key()] += iterator.value();
+	}
+
+	m_pendingDomains.clear();
+}
+
+void CookieJar::preloadDomains()
+{
+	if (m_domainsWatcher || m_pendingDomains.isEmpty())
+	{
+		return;
+	}
+
+	m_domainsWatcher = new QFutureWatcher<QHash<QString, QVector<QNetworkCookie> > >(this);
+
+	connect(m_domainsWatcher, SIGNAL(finished()), this, SLOT(handleDomainsLoaded()));
+
+	m_domainsWatcher->setFuture(QtConcurrent::run(&CookieJar::readDomains, SessionsManager::getWritableDataPath(QLatin1String("cookies.dat")), m_pendingDomains));
+}
+
 void CookieJar::handleOptionChanged(int identifier, const QVariant &value)
 {
 	switch (identifier)
@@ -163,6 +434,30 @@ void CookieJar::handleOptionChanged(int identifier, const QVariant &value)
 	}
 }
 
+void CookieJar::handleDomainsLoaded()
+{
+	if (!m_domainsWatcher)
+	{
+		return;
+	}
+
+	const QHash<QString, QVector<QNetworkCookie> > cookies(m_domainsWatcher->result());
+	QHash<QString, QVector<QNetworkCookie> >::const_iterator iterator;
+
+	m_domainsWatcher->deleteLater();
+	m_domainsWatcher = nullptr;
+
+	for (iterator = cookies.constBegin(); iterator != cookies.constEnd(); ++iterator)
+	{
+		if (m_pendingDomains.contains(iterator.key()))
+		{
+			m_pendingDomains.remove(iterator.key());
+
+			m_cookies[iterator.key()] += iterator.value();
+		}
+	}
+}
+
 void CookieJar::save()
 {
 	if (SessionsManager::isReadOnly())
@@ -170,36 +465,79 @@ void CookieJar::save()
 		return;
 	}
 
-	QSaveFile file(SessionsManager::getWritableDataPath(QLatin1String("cookies.dat")));
+	if (m_needsCompaction || m_recordsAmount > (m_cookiesAmount + 1000))
+	{
+		compact();
 
-	if (!file.open(QIODevice::WriteOnly))
+		return;
+	}
+
+	if (m_pendingRecords.isEmpty())
 	{
 		return;
 	}
 
-	const QList<QNetworkCookie> cookies(allCookies());
-	QDataStream stream(&file);
-	stream << quint32(cookies.count());
+	QFile file(SessionsManager::getWritableDataPath(QLatin1String("cookies.journal")));
 
-	for (int i = 0; i < cookies.count(); ++i)
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Append))
 	{
-		if (!cookies.at(i).isSessionCookie())
-		{
-			stream << cookies.at(i).toRawForm();
-		}
+		m_needsCompaction = true;
+
+		return;
 	}
 
-	file.commit();
+	if (file.size() == 0)
+	{
+		QDataStream stream(&file);
+		stream.setVersion(QDataStream::Qt_5_0);
+		stream << m_magic << m_version;
+	}
+
+	if (file.write(m_pendingRecords) != m_pendingRecords.size())
+	{
+		m_needsCompaction = true;
+
+		return;
+	}
+
+	m_pendingRecords.clear();
 }
 
 CookieJar* CookieJar::clone(QObject *parent) const
 {
+	loadDomains();
+
 	CookieJar *cookieJar(new CookieJar(m_isPrivate, parent));
-	cookieJar->setAllCookies(allCookies());
+	cookieJar->m_cookies = m_cookies;
+	cookieJar->m_pendingDomains.clear();
 
 	return cookieJar;
 }
 
+void CookieJar::writeCookie(QDataStream &stream, const QNetworkCookie &cookie)
+{
+	stream << cookie.name() << cookie.value() << cookie.domain() << cookie.path() << cookie.expirationDate().toMSecsSinceEpoch() << static_cast<quint8>((cookie.isSecure() ? 1 : 0) | (cookie.isHttpOnly() ? 2 : 0));
+}
+
+QString CookieJar::getRegistrableDomain(const QString &domain)
+{
+	const QString host((domain.startsWith(QLatin1Char('.')) ? domain.mid(1) : domain).toLower());
+	QUrl url;
+	url.setScheme(QLatin1String("http"));
+	url.setHost(host);
+
+	const QString topLevelDomain(url.topLevelDomain());
+
+	if (topLevelDomain.isEmpty() || host.length() <= topLevelDomain.length())
+	{
+		return host;
+	}
+
+	const int index(host.lastIndexOf(QLatin1Char('.'), -(topLevelDomain.length() + 1)));
+
+	return ((index < 0) ? host : host.mid(index + 1));
+}
+
 QList<QNetworkCookie> CookieJar::cookiesForUrl(const QUrl &url) const
 {
 	if (m_generalCookiesPolicy == IgnoreCookies)
@@ -207,19 +545,129 @@ QList<QNetworkCookie> CookieJar::cookiesForUrl(const QUrl &url) const
 		return QList<QNetworkCookie>();
 	}
 
-	return QNetworkCookieJar::cookiesForUrl(url);
+	return getCookiesForUrl(url);
+}
+
+QNetworkCookie CookieJar::readCookie(QDataStream &stream)
+{
+	QByteArray name;
+	QByteArray value;
+	QString domain;
+	QString path;
+	qint64 expirationDate(0);
+	quint8 flags(0);
+
+	stream >> name >> value >> domain >> path >> expirationDate >> flags;
+
+	QNetworkCookie cookie(name, value);
+	cookie.setDomain(domain);
+	cookie.setPath(path);
+	cookie.setExpirationDate(QDateTime::fromMSecsSinceEpoch(expirationDate));
+	cookie.setSecure(flags & 1);
+	cookie.setHttpOnly(flags & 2);
+
+	return cookie;
+}
+
+QVector<QNetworkCookie> CookieJar::readCookies(QDataStream &stream)
+{
+	QVector<QNetworkCookie> cookies;
+	quint32 amount(0);
+
+	stream >> amount;
+
+	if (stream.status() != QDataStream::Ok || !stream.device() || static_cast<qint64>(amount) > (stream.device()->bytesAvailable() / 25))
+	{
+		stream.setStatus(QDataStream::ReadCorruptData);
+
+		return cookies;
+	}
+
+	cookies.reserve(static_cast<int>(amount));
+
+	for (quint32 i = 0; i < amount; ++i)
+	{
+		const QNetworkCookie cookie(readCookie(stream));
+
+		if (stream.status() != QDataStream::Ok)
+		{
+			break;
+		}
+
+		cookies.append(cookie);
+	}
+
+	return cookies;
+}
+
+QHash<QString, QVector<QNetworkCookie> > CookieJar::readDomains(const QString &path, const QHash<QString, qint64> &domains)
+{
+	QHash<QString, QVector<QNetworkCookie> > cookies;
+	QFile file(path);
+
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		return cookies;
+	}
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_5_0);
+
+	QHash<QString, qint64>::const_iterator iterator;
+
+	for (iterator = domains.constBegin(); iterator != domains.constEnd(); ++iterator)
+	{
+		if (file.seek(iterator.value()))
+		{
+			cookies[iterator.key()] = readCookies(stream);
+		}
+	}
+
+	return cookies;
 }
 
 QList<QNetworkCookie> CookieJar::getCookiesForUrl(const QUrl &url) const
 {
-	return QNetworkCookieJar::cookiesForUrl(url);
+	const QString domain(getRegistrableDomain(url.host()));
+
+	loadDomain(domain);
+
+	const QVector<QNetworkCookie> cookies(m_cookies.value(domain));
+	const QDateTime currentDateTime(QDateTime::currentDateTimeUtc());
+	const bool isSecure(url.scheme() == QLatin1String("https"));
+	QList<QNetworkCookie> urlCookies;
+
+	for (int i = 0; i < cookies.count(); ++i)
+	{
+		const QNetworkCookie cookie(cookies.at(i));
+
+		if (!isParentDomain(url.host(), cookie.domain()) || !isParentPath(url.path(), cookie.path()) || (!cookie.isSessionCookie() && cookie.expirationDate() < currentDateTime) || (cookie.isSecure() && !isSecure))
+		{
+			continue;
+		}
+
+		int index(0);
+
+		while (index < urlCookies.count() && urlCookies.at(index).path().length() >= cookie.path().length())
+		{
+			++index;
+		}
+
+		urlCookies.insert(index, cookie);
+	}
+
+	return urlCookies;
 }
 
 QVector<QNetworkCookie> CookieJar::getCookies(const QString &domain) const
 {
 	if (!domain.isEmpty())
 	{
-		const QVector<QNetworkCookie> cookies(allCookies().toVector());
+		const QString registrableDomain(getRegistrableDomain(domain));
+
+		loadDomain(registrableDomain);
+
+		const QVector<QNetworkCookie> cookies(m_cookies.value(registrableDomain));
 		QVector<QNetworkCookie> domainCookies;
 
 		for (int i = 0; i < cookies.count(); ++i)
@@ -233,7 +681,17 @@ QVector<QNetworkCookie> CookieJar::getCookies(const QString &domain) const
 		return domainCookies;
 	}
 
-	return allCookies().toVector();
+	loadDomains();
+
+	QVector<QNetworkCookie> cookies;
+	QHash<QString, QVector<QNetworkCookie> >::const_iterator iterator;
+
+	for (iterator = m_cookies.constBegin(); iterator != m_cookies.constEnd(); ++iterator)
+	{
+		cookies += iterator.value();
+	}
+
+	return cookies;
 }
 
 bool CookieJar::insertCookie(const QNetworkCookie &cookie)
@@ -243,106 +701,221 @@ bool CookieJar::insertCookie(const QNetworkCookie &cookie)
 		return false;
 	}
 
-	const bool result(QNetworkCookieJar::insertCookie(cookie));
+	return forceInsertCookie(cookie);
+}
 
-	if (result)
+bool CookieJar::updateCookie(const QNetworkCookie &cookie)
+{
+	if (m_generalCookiesPolicy == IgnoreCookies || m_generalCookiesPolicy == ReadOnlyCookies)
 	{
-		scheduleSave();
-
-		emit cookieAdded(cookie);
+		return false;
 	}
 
-	return result;
+	return forceUpdateCookie(cookie);
 }
 
-bool CookieJar::updateCookie(const QNetworkCookie &cookie)
+bool CookieJar::deleteCookie(const QNetworkCookie &cookie)
 {
 	if (m_generalCookiesPolicy == IgnoreCookies || m_generalCookiesPolicy == ReadOnlyCookies)
 	{
 		return false;
 	}
 
-	const bool result(QNetworkCookieJar::updateCookie(cookie));
+	return forceDeleteCookie(cookie);
+}
 
-	if (result)
+bool CookieJar::forceInsertCookie(const QNetworkCookie &cookie)
+{
+	QNetworkCookie removedCookie;
+	const bool hasRemovedCookie(takeCookie(cookie, &removedCookie));
+	const bool isPersistent(hasRemovedCookie && !removedCookie.isSessionCookie());
+
+	if (!cookie.isSessionCookie() && cookie.expirationDate() < QDateTime::currentDateTimeUtc())
 	{
-		scheduleSave();
+		if (hasRemovedCookie)
+		{
+			if (isPersistent)
+			{
+				appendRecord(RemoveCookie, removedCookie);
+			}
+
+			emit cookieRemoved(removedCookie);
+		}
+
+		return false;
 	}
 
-	return result;
+	m_cookies[getRegistrableDomain(cookie.domain())].append(cookie);
+
+	if (!cookie.isSessionCookie())
+	{
+		appendRecord((isPersistent ? UpdateCookie : InsertCookie), cookie);
+	}
+	else if (isPersistent)
+	{
+		appendRecord(RemoveCookie, removedCookie);
+	}
+
+	emit cookieAdded(cookie);
+
+	return true;
 }
 
-bool CookieJar::deleteCookie(const QNetworkCookie &cookie)
+bool CookieJar::forceUpdateCookie(const QNetworkCookie &cookie)
 {
-	if (m_generalCookiesPolicy == IgnoreCookies || m_generalCookiesPolicy == ReadOnlyCookies)
+	if (!hasCookie(cookie))
 	{
 		return false;
 	}
 
-	const bool result(QNetworkCookieJar::deleteCookie(cookie));
+	return forceInsertCookie(cookie);
+}
+
+bool CookieJar::forceDeleteCookie(const QNetworkCookie &cookie)
+{
+	QNetworkCookie removedCookie;
 
-	if (result)
+	if (!takeCookie(cookie, &removedCookie))
 	{
-		scheduleSave();
+		return false;
+	}
 
-		emit cookieRemoved(cookie);
+	if (!removedCookie.isSessionCookie())
+	{
+		appendRecord(RemoveCookie, removedCookie);
 	}
 
-	return result;
+	emit cookieRemoved(removedCookie);
+
+	return true;
 }
 
-bool CookieJar::forceInsertCookie(const QNetworkCookie &cookie)
+bool CookieJar::takeCookie(const QNetworkCookie &cookie, QNetworkCookie *removedCookie)
 {
-	const bool result(QNetworkCookieJar::insertCookie(cookie));
+	const QString domain(getRegistrableDomain(cookie.domain()));
+
+	loadDomain(domain);
 
-	if (result)
+	const QHash<QString, QVector<QNetworkCookie> >::iterator iterator(m_cookies.find(domain));
+
+	if (iterator == m_cookies.end())
 	{
-		scheduleSave();
+		return false;
+	}
+
+	QVector<QNetworkCookie> &cookies(iterator.value());
+
+	for (int i = 0; i < cookies.count(); ++i)
+	{
+		if (cookies.at(i).hasSameIdentifier(cookie))
+		{
+			if (removedCookie)
+			{
+				*removedCookie = cookies.at(i);
+			}
+
+			cookies.remove(i);
 
-		emit cookieAdded(cookie);
+			if (cookies.isEmpty())
+			{
+				m_cookies.erase(iterator);
+			}
+
+			return true;
+		}
 	}
 
-	return result;
+	return false;
 }
 
-bool CookieJar::forceUpdateCookie(const QNetworkCookie &cookie)
+bool CookieJar::compact()
 {
-	const bool result(QNetworkCookieJar::updateCookie(cookie));
+	loadDomains();
 
-	if (result)
+	QSaveFile file(SessionsManager::getWritableDataPath(QLatin1String("cookies.dat")));
+
+	if (!file.open(QIODevice::WriteOnly))
 	{
-		scheduleSave();
+		return false;
 	}
 
-	return result;
-}
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_5_0);
+	stream << m_magic << m_version;
 
-bool CookieJar::forceDeleteCookie(const QNetworkCookie &cookie)
-{
-	const bool result(QNetworkCookieJar::deleteCookie(cookie));
+	QHash<QString, qint64> domains;
+	QHash<QString, QVector<QNetworkCookie> >::const_iterator iterator;
+	int cookiesAmount(0);
 
-	if (result)
+	for (iterator = m_cookies.constBegin(); iterator != m_cookies.constEnd(); ++iterator)
 	{
-		scheduleSave();
+		QVector<QNetworkCookie> cookies;
+		cookies.reserve(iterator.value().count());
+
+		for (int i = 0; i < iterator.value().count(); ++i)
+		{
+			if (!iterator.value().at(i).isSessionCookie())
+			{
+				cookies.append(iterator.value().at(i));
+			}
+		}
+
+		if (cookies.isEmpty())
+		{
+			continue;
+		}
+
+		domains[iterator.key()] = file.pos();
+
+		stream << static_cast<quint32>(cookies.count());
+
+		for (int i = 0; i < cookies.count(); ++i)
+		{
+			writeCookie(stream, cookies.at(i));
+		}
+
+		cookiesAmount += cookies.count();
+	}
 
-		emit cookieRemoved(cookie);
+	const qint64 tableOffset(file.pos());
+	QHash<QString, qint64>::const_iterator domainsIterator;
+
+	stream << cookiesAmount << static_cast<quint32>(domains.count());
+
+	for (domainsIterator = domains.constBegin(); domainsIterator != domains.constEnd(); ++domainsIterator)
+	{
+		stream << domainsIterator.key() << domainsIterator.value();
 	}
 
-	return result;
+	stream << tableOffset;
+
+	if (!file.commit())
+	{
+		return false;
+	}
+
+	QFile::remove(SessionsManager::getWritableDataPath(QLatin1String("cookies.journal")));
+
+	m_pendingRecords.clear();
+
+	m_cookiesAmount = cookiesAmount;
+	m_recordsAmount = 0;
+	m_needsCompaction = false;
+
+	return true;
 }
 
 bool CookieJar::hasCookie(const QNetworkCookie &cookie) const
 {
-	QUrl url;
-	url.setScheme(cookie.isSecure() ? QLatin1String("https") : QLatin1String("http"));
-	url.setHost(cookie.domain().startsWith(QLatin1Char('.')) ? cookie.domain().mid(1) : cookie.domain());
-	url.setPath(cookie.path());
+	const QString domain(getRegistrableDomain(cookie.domain()));
+
+	loadDomain(domain);
 
-	const QList<QNetworkCookie> cookies(getCookiesForUrl(url));
+	const QVector<QNetworkCookie> cookies(m_cookies.value(domain));
 
 	for (int i = 0; i < cookies.count(); ++i)
 	{
-		if (cookies.at(i).domain() == cookie.domain() && cookies.at(i).name() == cookie.name())
+		if (cookies.at(i).hasSameIdentifier(cookie))
 		{
 			return true;
 		}
@@ -375,4 +948,24 @@ bool CookieJar::isDomainTheSame(const QUrl &first, const QUrl &second)
 	return false;
 }
 
+bool CookieJar::isParentDomain(const QString &domain, const QString &reference)
+{
+	if (!reference.startsWith(QLatin1Char('.')))
+	{
+		return (domain == reference);
+	}
+
+	return (domain.endsWith(reference) || domain == reference.mid(1));
+}
+
+bool CookieJar::isParentPath(const QString &path, const QString &reference)
+{
+	if (!path.startsWith(reference) && !(path.isEmpty() && reference == QLatin1String("/")))
+	{
+		return false;
+	}
+
+	return (path.length() == reference.length() || reference.endsWith(QLatin1Char('/')) || path.at(reference.length()) == QLatin1Char('/'));
+}
+
 }
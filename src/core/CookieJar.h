@@ -20,6 +20,10 @@
 #ifndef OTTER_COOKIEJAR_H
 #define OTTER_COOKIEJAR_H
 
+#include <QtCore/QDataStream>
+#include <QtCore/QFile>
+#include <QtCore/QFutureWatcher>
+#include <QtCore/QHash>
 #include <QtNetwork/QNetworkCookie>
 #include <QtNetwork/QNetworkCookieJar>
 
@@ -54,6 +58,7 @@ public:
 	};
 
 	explicit CookieJar(bool isPrivate, QObject *parent = nullptr);
+	~CookieJar();
 
 	void clearCookies(int period = 0);
 	CookieJar* clone(QObject *parent = nullptr) const;
@@ -72,18 +77,45 @@ public:
 protected:
 	void timerEvent(QTimerEvent *event) override;
 	void scheduleSave();
+	void appendRecord(CookieOperation operation, const QNetworkCookie &cookie);
+	void loadCookies();
+	void importCookies(QDataStream &stream);
+	void recoverCookies(QFile *file, qint64 end);
+	void loadDomain(const QString &domain) const;
+	void loadDomains() const;
 	void save();
+	static void writeCookie(QDataStream &stream, const QNetworkCookie &cookie);
+	static QString getRegistrableDomain(const QString &domain);
+	static QNetworkCookie readCookie(QDataStream &stream);
+	static QVector<QNetworkCookie> readCookies(QDataStream &stream);
+	static QHash<QString, QVector<QNetworkCookie> > readDomains(const QString &path, const QHash<QString, qint64> &domains);
+	bool takeCookie(const QNetworkCookie &cookie, QNetworkCookie *removedCookie = nullptr);
+	bool compact();
+	static bool isParentDomain(const QString &domain, const QString &reference);
+	static bool isParentPath(const QString &path, const QString &reference);
 
 protected slots:
 	void handleOptionChanged(int identifier, const QVariant &value);
+	void handleDomainsLoaded();
+	void preloadDomains();
 
 private:
+	QFutureWatcher<QHash<QString, QVector<QNetworkCookie> > > *m_domainsWatcher;
+	mutable QHash<QString, QVector<QNetworkCookie> > m_cookies;
+	mutable QHash<QString, qint64> m_pendingDomains;
+	QByteArray m_pendingRecords;
 	CookiesPolicy m_generalCookiesPolicy;
 	CookiesPolicy m_thirdPartyCookiesPolicy;
 	KeepMode m_keepMode;
+	int m_cookiesAmount;
+	int m_recordsAmount;
 	int m_saveTimer;
+	bool m_needsCompaction;
 	bool m_isPrivate;
 
+	static const quint32 m_magic;
+	static const quint32 m_version;
+
 signals:
 	void cookieAdded(QNetworkCookie cookie);
 	void cookieRemoved(QNetworkCookie cookie);
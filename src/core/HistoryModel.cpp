@@ -20,13 +20,7 @@
 
 #include "HistoryModel.h"
 #include "Console.h"
-#include "JsonSettings.h"
 #include "SessionsManager.h"
-#include "Utils.h"
-
-#include <QtCore/QFile>
-#include <QtCore/QJsonArray>
-#include <QtCore/QJsonObject>
 
 namespace Otter
 {
@@ -47,46 +41,58 @@ void HistoryEntryItem::setData(const QVariant &value, int role)
 	}
 }
 
+QVariant HistoryEntryItem::data(int role) const
+{
+	if (role == HistoryModel::TitleRole || role == HistoryModel::UrlRole || role == HistoryModel::TimeVisitedRole)
+	{
+		const HistoryModel *model(qobject_cast<HistoryModel*>(this->model()));
+
+		if (model)
+		{
+			return model->getEntryData(QStandardItem::data(HistoryModel::IdentifierRole).toULongLong(), role);
+		}
+	}
+
+	return QStandardItem::data(role);
+}
+
 void HistoryEntryItem::setItemData(const QVariant &value, int role)
 {
 	QStandardItem::setData(value, role);
 }
 
 HistoryModel::HistoryModel(const QString &path, HistoryType type, QObject *parent) : QStandardItemModel(parent),
+	m_store(path),
 	m_type(type)
 {
-	QFile file(path);
-
-	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+	if (!m_store.load())
 	{
-		Console::addMessage(tr("Failed to open history file: %1").arg(file.errorString()), Console::OtherCategory, Console::ErrorLevel, path);
-
-		return;
+		Console::addMessage(tr("Failed to load history file"), Console::OtherCategory, Console::ErrorLevel, path);
 	}
 
-	const QJsonArray historyArray(QJsonDocument::fromJson(file.readAll()).array());
-
-	file.close();
+	const QVector<HistoryStore::Entry> entries(m_store.getEntries());
 
-	for (int i = 0; i < historyArray.count(); ++i)
+	for (int i = (entries.count() - 1); i >= 0; --i)
 	{
-		const QJsonObject entryObject(historyArray.at(i).toObject());
-
-		addEntry(QUrl(entryObject.value(QLatin1String("url")).toString()), entryObject.value(QLatin1String("title")).toString(), QIcon(), QDateTime::fromString(entryObject.value(QLatin1String("time")).toString(), QLatin1String("yyyy-MM-dd hh:mm:ss")));
+		appendRow(createEntry(entries.at(i)));
 	}
 
 	setSortRole(TimeVisitedRole);
-	sort(0, Qt::DescendingOrder);
 }
 
 void HistoryModel::clearExcessEntries(int limit)
 {
 	if (limit > 0 && rowCount() > limit)
 	{
+		QVector<quint64> identifiers;
+		identifiers.reserve(rowCount() - limit);
+
 		for (int i = (rowCount() - 1); i >= limit; --i)
 		{
-			removeEntry(index(i, 0).data(HistoryModel::IdentifierRole).toULongLong());
+			identifiers.append(index(i, 0).data(IdentifierRole).toULongLong());
 		}
+
+		removeEntries(identifiers);
 	}
 }
 
@@ -96,18 +102,26 @@ void HistoryModel::clearRecentEntries(uint period)
 	{
 		clear();
 
+		m_identifiers.clear();
+		m_store.clear();
+
 		emit cleared();
 
 		return;
 	}
 
+	const QDateTime currentDateTime(QDateTime::currentDateTime());
+	QVector<quint64> identifiers;
+
 	for (int i = (rowCount() - 1); i >= 0; --i)
 	{
-		if (index(i, 0).data(TimeVisitedRole).toDateTime().secsTo(QDateTime::currentDateTime()) < (period * 3600))
+		if (index(i, 0).data(TimeVisitedRole).toDateTime().secsTo(currentDateTime) < (period * 3600))
 		{
-			removeEntry(index(i, 0).data(IdentifierRole).toULongLong());
+			identifiers.append(index(i, 0).data(IdentifierRole).toULongLong());
 		}
 	}
+
+	removeEntries(identifiers);
 }
 
 void HistoryModel::clearOldestEntries(int period)
@@ -118,14 +132,17 @@ void HistoryModel::clearOldestEntries(int period)
 	}
 
 	const QDateTime currentDateTime(QDateTime::currentDateTime());
+	QVector<quint64> identifiers;
 
 	for (int i = (rowCount() - 1); i >= 0; --i)
 	{
 		if (index(i, 0).data(TimeVisitedRole).toDateTime().daysTo(currentDateTime) > period)
 		{
-			removeEntry(index(i, 0).data(IdentifierRole).toULongLong());
+			identifiers.append(index(i, 0).data(IdentifierRole).toULongLong());
 		}
 	}
+
+	removeEntries(identifiers);
 }
 
 void HistoryModel::removeEntry(quint64 identifier)
@@ -137,26 +154,70 @@ void HistoryModel::removeEntry(quint64 identifier)
 		return;
 	}
 
-	const QUrl url(Utils::normalizeUrl(entry->data(UrlRole).toUrl()));
+	m_identifiers.remove(identifier);
+
+	emit entryRemoved(entry);
+
+	m_store.removeEntry(identifier);
+
+	removeRow(entry->row());
 
-	if (m_urls.contains(url))
+	emit modelModified();
+}
+
+void HistoryModel::removeEntries(const QVector<quint64> &identifiers)
+{
+	const bool isBulkRemoval(identifiers.count() >= 64);
+	QVector<QUrl> urls;
+	QVector<int> rows;
+	rows.reserve(identifiers.count());
+
+	for (int i = 0; i < identifiers.count(); ++i)
 	{
-		m_urls[url].removeAll(entry);
+		HistoryEntryItem *entry(m_identifiers.take(identifiers.at(i)));
+
+		if (!entry)
+		{
+			continue;
+		}
+
+		rows.append(entry->row());
 
-		if (m_urls[url].isEmpty())
+		if (isBulkRemoval)
 		{
-			m_urls.remove(url);
+			urls.append(m_store.getEntry(identifiers.at(i)).url);
 		}
+		else
+		{
+			emit entryRemoved(entry);
+		}
+
+		m_store.removeEntry(identifiers.at(i));
 	}
 
-	if (identifier > 0 && m_identifiers.contains(identifier))
+	if (rows.isEmpty())
 	{
-		m_identifiers.remove(identifier);
+		return;
 	}
 
-	emit entryRemoved(entry);
+	std::sort(rows.begin(), rows.end());
 
-	removeRow(entry->row());
+	int end(rows.count() - 1);
+
+	for (int i = (rows.count() - 1); i >= 0; --i)
+	{
+		if (i == 0 || rows.at(i - 1) != (rows.at(i) - 1))
+		{
+			removeRows(rows.at(i), (rows.at(end) - rows.at(i) + 1));
+
+			end = (i - 1);
+		}
+	}
+
+	if (isBulkRemoval)
+	{
+		emit entriesRemoved(urls);
+	}
 
 	emit modelModified();
 }
@@ -167,33 +228,31 @@ HistoryEntryItem* HistoryModel::addEntry(const QUrl &url, const QString &title,
 
 	if (m_type == TypedHistory)
 	{
-		const QUrl normalizedUrl(Utils::normalizeUrl(url));
+		const QVector<quint64> identifiers(m_store.getIdentifiers(url));
 
-		if (hasEntry(normalizedUrl))
+		for (int i = 0; i < identifiers.count(); ++i)
 		{
-			for (int i = 0; i < m_urls[normalizedUrl].count(); ++i)
-			{
-				removeEntry(m_urls[normalizedUrl][i]->data(IdentifierRole).toULongLong());
-			}
+			removeEntry(identifiers.at(i));
 		}
 	}
 
-	HistoryEntryItem *entry(new HistoryEntryItem());
-	entry->setIcon(icon);
-
-	insertRow(0, entry);
-	setData(entry->index(), url, UrlRole);
-	setData(entry->index(), title, TitleRole);
-	setData(entry->index(), date, TimeVisitedRole);
-
 	if (identifier == 0 || m_identifiers.contains(identifier))
 	{
-		identifier = (m_identifiers.isEmpty() ? 1 : (m_identifiers.keys().last() + 1));
+		identifier = m_store.createIdentifier();
 	}
 
-	setData(entry->index(), identifier, IdentifierRole);
+	HistoryStore::Entry storeEntry;
+	storeEntry.url = url;
+	storeEntry.title = title;
+	storeEntry.time = date;
+	storeEntry.identifier = identifier;
 
-	m_identifiers[identifier] = entry;
+	m_store.addEntry(storeEntry);
+
+	HistoryEntryItem *entry(createEntry(storeEntry));
+	entry->setIcon(icon);
+
+	insertRow(0, entry);
 
 	blockSignals(false);
 
@@ -202,6 +261,16 @@ HistoryEntryItem* HistoryModel::addEntry(const QUrl &url, const QString &title,
 	return entry;
 }
 
+HistoryEntryItem* HistoryModel::createEntry(const HistoryStore::Entry &entry)
+{
+	HistoryEntryItem *item(new HistoryEntryItem());
+	item->setItemData(entry.identifier, IdentifierRole);
+
+	m_identifiers[entry.identifier] = item;
+
+	return item;
+}
+
 HistoryEntryItem* HistoryModel::getEntry(quint64 identifier) const
 {
 	if (m_identifiers.contains(identifier))
@@ -212,85 +281,99 @@ HistoryEntryItem* HistoryModel::getEntry(quint64 identifier) const
 	return nullptr;
 }
 
-QVector<HistoryModel::HistoryEntryMatch> HistoryModel::findEntries(const QString &prefix, bool markAsTypedIn) const
+QIcon HistoryModel::getIcon(const QUrl &url) const
 {
-	QVector<HistoryEntryItem*> matchedEntries;
-	QVector<HistoryModel::HistoryEntryMatch> allMatches;
-	QVector<HistoryModel::HistoryEntryMatch> currentMatches;
-	QMultiMap<QDateTime, HistoryModel::HistoryEntryMatch> matchesMap;
-	QHash<QUrl, QVector<HistoryEntryItem*> >::const_iterator urlsIterator;
+	const QVector<quint64> identifiers(m_store.getIdentifiers(url));
 
-	for (urlsIterator = m_urls.constBegin(); urlsIterator != m_urls.constEnd(); ++urlsIterator)
+	for (int i = (identifiers.count() - 1); i >= 0; --i)
 	{
-		if (urlsIterator.value().isEmpty() || matchedEntries.contains(urlsIterator.value().first()))
+		const HistoryEntryItem *entry(m_identifiers.value(identifiers.at(i)));
+
+		if (entry && !entry->icon().isNull())
 		{
-			continue;
+			return entry->icon();
 		}
+	}
 
-		const QString result(Utils::matchUrl(urlsIterator.key(), prefix));
+	return {};
+}
 
-		if (!result.isEmpty())
-		{
-			HistoryEntryMatch match;
-			match.entry = urlsIterator.value().first();
-			match.match = result;
+QVariant HistoryModel::getEntryData(quint64 identifier, int role) const
+{
+	const HistoryStore::Entry entry(m_store.getEntry(identifier));
 
-			if (markAsTypedIn)
-			{
-				match.isTypedIn = true;
-			}
+	switch (role)
+	{
+		case TitleRole:
+			return entry.title;
+		case UrlRole:
+			return entry.url;
+		case TimeVisitedRole:
+			return entry.time;
+		default:
+			break;
+	}
 
-			matchesMap.insert(match.entry->data(TimeVisitedRole).toDateTime(), match);
+	return {};
+}
 
-			matchedEntries.append(match.entry);
+QVector<HistoryModel::HistoryEntryMatch> HistoryModel::findEntries(const QString &prefix, bool markAsTypedIn) const
+{
+	const QVector<CompletionIndex::Match> urls(m_store.findUrls(prefix));
+	QVector<QPair<qint64, HistoryEntryMatch> > matches;
+	matches.reserve(urls.count());
+
+	for (int i = 0; i < urls.count(); ++i)
+	{
+		const QVector<quint64> identifiers(m_store.getIdentifiers(urls.at(i).url));
+		HistoryEntryItem *entry(identifiers.isEmpty() ? nullptr : m_identifiers.value(identifiers.first()));
+
+		if (entry)
+		{
+			HistoryEntryMatch match;
+			match.entry = entry;
+			match.match = urls.at(i).match;
+			match.visits = identifiers.count();
+			match.isTypedIn = markAsTypedIn;
+
+			matches.append(qMakePair(entry->data(TimeVisitedRole).toDateTime().toMSecsSinceEpoch(), match));
 		}
 	}
 
-	currentMatches = matchesMap.values().toVector();
+	std::stable_sort(matches.begin(), matches.end(), [&](const QPair<qint64, HistoryEntryMatch> &first, const QPair<qint64, HistoryEntryMatch> &second)
+	{
+		return (first.first > second.first);
+	});
 
-	matchesMap.clear();
+	QVector<HistoryModel::HistoryEntryMatch> allMatches;
+	allMatches.reserve(matches.count());
 
-	for (int i = (currentMatches.count() - 1); i >= 0; --i)
+	for (int i = 0; i < matches.count(); ++i)
 	{
-		allMatches.append(currentMatches.at(i));
+		allMatches.append(matches.at(i).second);
 	}
 
 	return allMatches;
 }
 
+std::shared_ptr<const HistoryStore::Index> HistoryModel::getIndex() const
+{
+	return m_store.getIndex();
+}
+
 HistoryModel::HistoryType HistoryModel::getType() const
 {
 	return m_type;
 }
 
-bool HistoryModel::save(const QString &path) const
+bool HistoryModel::save()
 {
 	if (SessionsManager::isReadOnly())
 	{
 		return false;
 	}
 
-	QJsonArray historyArray;
-
-	for (int i = 0; i < rowCount(); ++i)
-	{
-		QStandardItem *entry(item(i));
-
-		if (entry)
-		{
-			QJsonObject entryObject;
-			entryObject.insert(QLatin1String("url"), entry->data(UrlRole).toUrl().toString());
-			entryObject.insert(QLatin1String("title"), entry->data(TitleRole).toString());
-			entryObject.insert(QLatin1String("time"), entry->data(TimeVisitedRole).toDateTime().toString(QLatin1String("yyyy-MM-dd hh:mm:ss")));
-
-			historyArray.prepend(entryObject);
-		}
-	}
-
-	JsonSettings settings;
-	settings.setArray(historyArray);
-
-	return settings.save(path);
+	return m_store.save();
 }
 
 bool HistoryModel::setData(const QModelIndex &index, const QVariant &value, int role)
@@ -302,52 +385,59 @@ bool HistoryModel::setData(const QModelIndex &index, const QVariant &value, int
 		return QStandardItemModel::setData(index, value, role);
 	}
 
-	if (role == UrlRole && value.toUrl() != index.data(UrlRole).toUrl())
+	switch (role)
 	{
-		const QUrl oldUrl(Utils::normalizeUrl(index.data(UrlRole).toUrl()));
-		const QUrl newUrl(Utils::normalizeUrl(value.toUrl()));
-
-		if (!oldUrl.isEmpty() && m_urls.contains(oldUrl))
-		{
-			m_urls[oldUrl].removeAll(entry);
-
-			if (m_urls[oldUrl].isEmpty())
-			{
-				m_urls.remove(oldUrl);
-			}
-		}
-
-		if (!newUrl.isEmpty())
-		{
-			if (!m_urls.contains(newUrl))
+		case TitleRole:
+		case UrlRole:
+		case TimeVisitedRole:
 			{
-				m_urls[newUrl] = QVector<HistoryEntryItem*>();
+				HistoryStore::Entry storeEntry(m_store.getEntry(entry->data(IdentifierRole).toULongLong()));
+
+				if (role == TitleRole)
+				{
+					storeEntry.title = value.toString();
+				}
+				else if (role == UrlRole)
+				{
+					storeEntry.url = value.toUrl();
+				}
+				else
+				{
+					storeEntry.time = value.toDateTime();
+				}
+
+				m_store.updateEntry(storeEntry);
 			}
 
-			m_urls[newUrl].append(entry);
-		}
-	}
-
-	entry->setItemData(value, role);
+			emit dataChanged(index, index, {role});
+			emit entryModified(entry);
+			emit modelModified();
 
-	switch (role)
-	{
-		case TitleRole:
-		case UrlRole:
+			break;
 		case IdentifierRole:
-		case TimeVisitedRole:
+			entry->setItemData(value, role);
+
 			emit entryModified(entry);
 			emit modelModified();
 
+			break;
+		default:
+			entry->setItemData(value, role);
+
 			break;
 	}
 
 	return true;
 }
 
+int HistoryModel::getVisitsAmount(const QUrl &url) const
+{
+	return m_store.getIdentifiers(url).count();
+}
+
 bool HistoryModel::hasEntry(const QUrl &url) const
 {
-	return m_urls.contains(url);
+	return m_store.hasUrl(url);
 }
 
 }
@@ -21,6 +21,8 @@
 #ifndef OTTER_HISTORYMODEL_H
 #define OTTER_HISTORYMODEL_H
 
+#include "HistoryStore.h"
+
 #include <QtCore/QDateTime>
 #include <QtCore/QUrl>
 #include <QtGui/QStandardItemModel>
@@ -32,6 +34,7 @@ class HistoryEntryItem : public QStandardItem
 {
 public:
 	void setData(const QVariant &value, int role) override;
+	QVariant data(int role) const override;
 	void setItemData(const QVariant &value, int role);
 
 protected:
@@ -63,6 +66,7 @@ public:
 	{
 		HistoryEntryItem *entry = nullptr;
 		QString match;
+		int visits = 1;
 		bool isTypedIn = false;
 	};
 
@@ -72,16 +76,24 @@ public:
 	void clearRecentEntries(uint period);
 	void clearOldestEntries(int period);
 	void removeEntry(quint64 identifier);
+	void removeEntries(const QVector<quint64> &identifiers);
 	HistoryEntryItem* addEntry(const QUrl &url, const QString &title, const QIcon &icon, const QDateTime &date = QDateTime::currentDateTime(), quint64 identifier = 0);
 	HistoryEntryItem* getEntry(quint64 identifier) const;
+	QIcon getIcon(const QUrl &url) const;
 	QVector<HistoryEntryMatch> findEntries(const QString &prefix, bool markAsTypedIn = false) const;
+	std::shared_ptr<const HistoryStore::Index> getIndex() const;
 	HistoryType getType() const;
+	int getVisitsAmount(const QUrl &url) const;
 	bool hasEntry(const QUrl &url) const;
-	bool save(const QString &path) const;
+	bool save();
 	bool setData(const QModelIndex &index, const QVariant &value, int role) override;
 
+protected:
+	HistoryEntryItem* createEntry(const HistoryStore::Entry &entry);
+	QVariant getEntryData(quint64 identifier, int role) const;
+
 private:
-	QHash<QUrl, QVector<HistoryEntryItem*> > m_urls;
+	HistoryStore m_store;
 	QMap<quint64, HistoryEntryItem*> m_identifiers;
 	HistoryType m_type;
 
@@ -90,7 +102,10 @@ signals:
 	void entryAdded(HistoryEntryItem *entry);
 	void entryModified(HistoryEntryItem *entry);
 	void entryRemoved(HistoryEntryItem *entry);
+	void entriesRemoved(const QVector<QUrl> &urls);
 	void modelModified();
+
+friend class HistoryEntryItem;
 };
 
 }
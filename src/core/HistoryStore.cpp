@@ -0,0 +1,401 @@
+/**************************************************************************
+* Otter Browser: Web browser controlled by the user, not vice-versa.
+* Copyright (C) 2017 Michal Dutkiewicz aka Emdek <michal@emdek.pl>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+**************************************************************************/
+
+#include "HistoryStore.h"
+#include "Utils.h"
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QSaveFile>
+
+namespace Otter
+{
+
+const quint32 HistoryStore::m_magic(0x5348544f);
+const quint32 HistoryStore::m_version(2);
+
+HistoryStore::HistoryStore(const QString &path) :
+	m_path(path),
+	m_index(std::make_shared<Index>()),
+	m_nextIdentifier(1),
+	m_recordsAmount(0),
+	m_needsCompaction(false),
+	m_isReadOnly(false)
+{
+}
+
+void HistoryStore::addEntry(const Entry &entry)
+{
+	insertEntry(entry);
+	appendRecord(AddRecord, entry);
+}
+
+void HistoryStore::updateEntry(const Entry &entry)
+{
+	if (m_index->entries.contains(entry.identifier))
+	{
+		insertEntry(entry);
+		appendRecord(UpdateRecord, entry);
+	}
+}
+
+void HistoryStore::removeEntry(quint64 identifier)
+{
+	if (m_index->entries.contains(identifier))
+	{
+		appendRecord(RemoveRecord, takeEntry(identifier));
+	}
+}
+
+void HistoryStore::clear()
+{
+	m_pendingRecords.clear();
+	m_index = std::make_shared<Index>();
+
+	m_needsCompaction = true;
+}
+
+quint64 HistoryStore::createIdentifier()
+{
+	const quint64 identifier(m_nextIdentifier);
+
+	++m_nextIdentifier;
+
+	return identifier;
+}
+
+void HistoryStore::appendRecord(RecordType type, const Entry &entry)
+{
+	QDataStream stream(&m_pendingRecords, QIODevice::Append);
+	stream.setVersion(QDataStream::Qt_5_0);
+
+	writeRecord(stream, type, entry);
+
+	++m_recordsAmount;
+}
+
+void HistoryStore::detachIndex()
+{
+	if (m_index.use_count() > 1)
+	{
+		m_index = std::make_shared<Index>(*m_index);
+	}
+}
+
+void HistoryStore::insertEntry(const Entry &entry)
+{
+	takeEntry(entry.identifier);
+
+	m_nextIdentifier = qMax(m_nextIdentifier, (entry.identifier + 1));
+
+	m_index->entries[entry.identifier] = entry;
+	m_index->times.insert(entry.time.toMSecsSinceEpoch(), entry.identifier);
+
+	const QUrl url(Utils::normalizeUrl(entry.url));
+	QVector<quint64> &identifiers(m_index->urls[url]);
+
+	if (identifiers.isEmpty())
+	{
+		m_index->completionIndex.addUrl(url);
+	}
+
+	identifiers.append(entry.identifier);
+}
+
+void HistoryStore::importEntries(const QString &path)
+{
+	QFile file(path);
+
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+	{
+		return;
+	}
+
+	const QJsonArray historyArray(QJsonDocument::fromJson(file.readAll()).array());
+
+	file.close();
+
+	for (int i = 0; i < historyArray.count(); ++i)
+	{
+		const QJsonObject entryObject(historyArray.at(i).toObject());
+		Entry entry;
+		entry.url = QUrl(entryObject.value(QLatin1String("url")).toString());
+		entry.title = entryObject.value(QLatin1String("title")).toString();
+		entry.time = QDateTime::fromString(entryObject.value(QLatin1String("time")).toString(), QLatin1String("yyyy-MM-dd hh:mm:ss"));
+		entry.identifier = static_cast<quint64>(i + 1);
+
+		insertEntry(entry);
+	}
+}
+
+void HistoryStore::writeRecord(QDataStream &stream, RecordType type, const Entry &entry)
+{
+	stream << static_cast<quint8>(type) << entry.identifier;
+
+	if (type != RemoveRecord)
+	{
+		stream << entry.url.toString() << entry.title << entry.time.toMSecsSinceEpoch();
+	}
+}
+
+HistoryStore::Entry HistoryStore::takeEntry(quint64 identifier)
+{
+	detachIndex();
+
+	const QHash<quint64, Entry>::iterator iterator(m_index->entries.find(identifier));
+
+	if (iterator == m_index->entries.end())
+	{
+		return {};
+	}
+
+	const Entry entry(iterator.value());
+	const QUrl url(Utils::normalizeUrl(entry.url));
+
+	m_index->entries.erase(iterator);
+	m_index->times.remove(entry.time.toMSecsSinceEpoch(), identifier);
+
+	if (m_index->urls.contains(url))
+	{
+		m_index->urls[url].removeAll(identifier);
+
+		if (m_index->urls[url].isEmpty())
+		{
+			m_index->urls.remove(url);
+			m_index->completionIndex.removeUrl(url);
+		}
+	}
+
+	return entry;
+}
+
+HistoryStore::Entry HistoryStore::getEntry(quint64 identifier) const
+{
+	return m_index->entries.value(identifier);
+}
+
+QVector<HistoryStore::Entry> HistoryStore::getEntries() const
+{
+	QVector<Entry> entries;
+	entries.reserve(m_index->times.count());
+
+	QMultiMap<qint64, quint64>::const_iterator iterator;
+
+	for (iterator = m_index->times.constBegin(); iterator != m_index->times.constEnd(); ++iterator)
+	{
+		entries.append(m_index->entries.value(iterator.value()));
+	}
+
+	return entries;
+}
+
+QVector<quint64> HistoryStore::getIdentifiers(const QUrl &url) const
+{
+	return m_index->urls.value(Utils::normalizeUrl(url));
+}
+
+QVector<CompletionIndex::Match> HistoryStore::findUrls(const QString &prefix) const
+{
+	return m_index->completionIndex.findUrls(prefix);
+}
+
+std::shared_ptr<const HistoryStore::Index> HistoryStore::getIndex() const
+{
+	return m_index;
+}
+
+bool HistoryStore::hasUrl(const QUrl &url) const
+{
+	return m_index->urls.contains(Utils::normalizeUrl(url));
+}
+
+bool HistoryStore::load()
+{
+	m_pendingRecords.clear();
+	m_index = std::make_shared<Index>();
+
+	m_nextIdentifier = 1;
+	m_recordsAmount = 0;
+	m_needsCompaction = false;
+	m_isReadOnly = false;
+
+	QFile file(m_path);
+
+	if (!file.exists())
+	{
+		const QFileInfo information(m_path);
+
+		importEntries(information.path() + QDir::separator() + information.completeBaseName() + QLatin1String(".json"));
+
+		m_needsCompaction = true;
+
+		return true;
+	}
+
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		return false;
+	}
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_5_0);
+
+	quint32 magic(0);
+	quint32 version(0);
+
+	stream >> magic >> version;
+
+	if (magic != m_magic || version < 1 || version > m_version)
+	{
+		file.close();
+
+		const QString backupPath(m_path + QLatin1String(".bak"));
+
+		if ((magic != m_magic || version < 1) && (!QFile::exists(backupPath) || QFile::remove(backupPath)) && QFile::copy(m_path, backupPath))
+		{
+			m_needsCompaction = true;
+		}
+		else
+		{
+			m_isReadOnly = true;
+		}
+
+		return false;
+	}
+
+	if (version > 1)
+	{
+		stream >> m_nextIdentifier;
+	}
+	else
+	{
+		m_needsCompaction = true;
+	}
+
+	while (!stream.atEnd())
+	{
+		quint8 type(0);
+		Entry entry;
+
+		stream >> type >> entry.identifier;
+
+		if (type != RemoveRecord)
+		{
+			QString url;
+			qint64 time(0);
+
+			stream >> url >> entry.title >> time;
+
+			entry.url = QUrl(url);
+			entry.time = QDateTime::fromMSecsSinceEpoch(time);
+		}
+
+		if (stream.status() != QDataStream::Ok || type > RemoveRecord)
+		{
+			m_needsCompaction = true;
+
+			break;
+		}
+
+		if (type == RemoveRecord)
+		{
+			takeEntry(entry.identifier);
+
+			m_nextIdentifier = qMax(m_nextIdentifier, (entry.identifier + 1));
+		}
+		else
+		{
+			insertEntry(entry);
+		}
+
+		++m_recordsAmount;
+	}
+
+	return true;
+}
+
+bool HistoryStore::save()
+{
+	if (m_isReadOnly)
+	{
+		return false;
+	}
+
+	if (m_needsCompaction || m_recordsAmount > ((m_index->entries.count() * 2) + 1000))
+	{
+		return compact();
+	}
+
+	if (m_pendingRecords.isEmpty())
+	{
+		return true;
+	}
+
+	QFile file(m_path);
+
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Append) || file.write(m_pendingRecords) != m_pendingRecords.size())
+	{
+		m_needsCompaction = true;
+
+		return false;
+	}
+
+	m_pendingRecords.clear();
+
+	return true;
+}
+
+bool HistoryStore::compact()
+{
+	QSaveFile file(m_path);
+
+	if (!file.open(QIODevice::WriteOnly))
+	{
+		return false;
+	}
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_5_0);
+	stream << m_magic << m_version << m_nextIdentifier;
+
+	QMultiMap<qint64, quint64>::const_iterator iterator;
+
+	for (iterator = m_index->times.constBegin(); iterator != m_index->times.constEnd(); ++iterator)
+	{
+		writeRecord(stream, AddRecord, m_index->entries.value(iterator.value()));
+	}
+
+	if (!file.commit())
+	{
+		return false;
+	}
+
+	m_pendingRecords.clear();
+
+	m_recordsAmount = m_index->entries.count();
+	m_needsCompaction = false;
+
+	return true;
+}
+
+}
@@ -0,0 +1,103 @@
+/**************************************************************************
+* Otter Browser: Web browser controlled by the user, not vice-versa.
+* Copyright (C) 2017 Michal Dutkiewicz aka Emdek <michal@emdek.pl>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+**************************************************************************/
+
+#ifndef OTTER_HISTORYSTORE_H
+#define OTTER_HISTORYSTORE_H
+
+#include "CompletionIndex.h"
+
+#include <QtCore/QDataStream>
+#include <QtCore/QDateTime>
+#include <QtCore/QHash>
+#include <QtCore/QMultiMap>
+#include <QtCore/QUrl>
+#include <QtCore/QVector>
+
+#include <memory>
+
+namespace Otter
+{
+
+class HistoryStore final
+{
+public:
+	struct Entry
+	{
+		QUrl url;
+		QString title;
+		QDateTime time;
+		quint64 identifier = 0;
+	};
+
+	struct Index
+	{
+		QHash<quint64, Entry> entries;
+		QMultiMap<qint64, quint64> times;
+		QHash<QUrl, QVector<quint64> > urls;
+		CompletionIndex completionIndex;
+	};
+
+	explicit HistoryStore(const QString &path);
+
+	void addEntry(const Entry &entry);
+	void updateEntry(const Entry &entry);
+	void removeEntry(quint64 identifier);
+	void clear();
+	quint64 createIdentifier();
+	Entry getEntry(quint64 identifier) const;
+	QVector<Entry> getEntries() const;
+	QVector<quint64> getIdentifiers(const QUrl &url) const;
+	QVector<CompletionIndex::Match> findUrls(const QString &prefix) const;
+	std::shared_ptr<const Index> getIndex() const;
+	bool hasUrl(const QUrl &url) const;
+	bool load();
+	bool save();
+
+protected:
+	enum RecordType : quint8
+	{
+		AddRecord = 0,
+		UpdateRecord,
+		RemoveRecord
+	};
+
+	void appendRecord(RecordType type, const Entry &entry);
+	void detachIndex();
+	void insertEntry(const Entry &entry);
+	void importEntries(const QString &path);
+	Entry takeEntry(quint64 identifier);
+	static void writeRecord(QDataStream &stream, RecordType type, const Entry &entry);
+	bool compact();
+
+private:
+	QString m_path;
+	QByteArray m_pendingRecords;
+	std::shared_ptr<Index> m_index;
+	quint64 m_nextIdentifier;
+	int m_recordsAmount;
+	bool m_needsCompaction;
+	bool m_isReadOnly;
+
+	static const quint32 m_magic;
+	static const quint32 m_version;
+};
+
+}
+
+#endif
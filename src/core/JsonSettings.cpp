@@ -123,7 +123,7 @@ bool JsonSettings::save(const QString &path, bool isAtomic)
 	{
 		m_hasError = true;
 
-		file->deleteLater();
+		delete file;
 
 		return false;
 	}
@@ -202,7 +202,7 @@ bool JsonSettings::save(const QString &path, bool isAtomic)
 		file->close();
 	}
 
-	file->deleteLater();
+	delete file;
 
 	return result;
 }
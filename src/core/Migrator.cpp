@@ -444,6 +444,11 @@ bool Migrator::run()
 				possibleMigrations[i]->migrate();
 			}
 		}
+
+		if (canProceed)
+		{
+			SettingsManager::loadOptions();
+		}
 	}
 
 	qDeleteAll(availableMigrations);
@@ -21,13 +21,23 @@
 #include "SessionsManager.h"
 #include "SettingsManager.h"
 
-#include <QtCore/QDateTime>
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDataStream>
 #include <QtCore/QDir>
+#include <QtCore/QSaveFile>
+#include <QtCore/QTimerEvent>
 
 namespace Otter
 {
 
-NetworkCache::NetworkCache(QObject *parent) : QNetworkDiskCache(parent)
+const quint32 NetworkCache::m_indexMagic(0x4e43494f);
+const quint32 NetworkCache::m_indexVersion(2);
+
+NetworkCache::NetworkCache(QObject *parent) : QNetworkDiskCache(parent),
+	m_indexIterator(nullptr),
+	m_size(0),
+	m_indexTimer(0),
+	m_isIndexReady(true)
 {
 	const QString cachePath(SessionsManager::getCachePath());
 
@@ -37,11 +47,22 @@ NetworkCache::NetworkCache(QObject *parent) : QNetworkDiskCache(parent)
 
 		setCacheDirectory(cachePath);
 		setMaximumCacheSize(SettingsManager::getOption(SettingsManager::Cache_DiskCacheLimitOption).toInt() * 1024);
+		loadIndex();
 
 		connect(SettingsManager::getInstance(), SIGNAL(optionChanged(int,QVariant)), this, SLOT(handleOptionChanged(int,QVariant)));
 	}
 }
 
+NetworkCache::~NetworkCache()
+{
+	stopIndexing();
+
+	if (m_isIndexReady && !cacheDirectory().isEmpty())
+	{
+		saveIndex();
+	}
+}
+
 void NetworkCache::handleOptionChanged(int identifier, const QVariant &value)
 {
 	if (identifier == SettingsManager::Cache_DiskCacheLimitOption)
@@ -50,6 +71,66 @@ void NetworkCache::handleOptionChanged(int identifier, const QVariant &value)
 	}
 }
 
+void NetworkCache::timerEvent(QTimerEvent *event)
+{
+	if (event->timerId() != m_indexTimer || !m_indexIterator)
+	{
+		QNetworkDiskCache::timerEvent(event);
+
+		return;
+	}
+
+	for (int i = 0; i < 50 && m_indexIterator->hasNext(); ++i)
+	{
+		const QString path(m_indexIterator->next());
+
+		if (!isCacheFile(path))
+		{
+			continue;
+		}
+
+		const QNetworkCacheMetaData metaData(fileMetaData(path));
+		const QUrl url(metaData.url());
+
+		if (!metaData.isValid() || !url.isValid())
+		{
+			continue;
+		}
+
+		if (m_entries.contains(url))
+		{
+			m_entries[url].path = path;
+		}
+		else if (!m_removedUrls.contains(url))
+		{
+			const QFileInfo fileInformation(m_indexIterator->fileInfo());
+			EntryInformation entry(createEntry(metaData));
+			entry.path = path;
+			entry.size = fileInformation.size();
+			entry.timeStored = fileInformation.lastModified();
+
+			insertEntry(entry);
+
+			emit entryAdded(url);
+		}
+	}
+
+	if (m_indexIterator->hasNext())
+	{
+		return;
+	}
+
+	stopIndexing();
+
+	m_removedUrls.clear();
+
+	m_isIndexReady = true;
+
+	emit indexReady();
+
+	expire();
+}
+
 void NetworkCache::clearCache(int period)
 {
 	if (period <= 0)
@@ -61,43 +142,164 @@ void NetworkCache::clearCache(int period)
 		return;
 	}
 
-	const QDir cacheMainDirectory(cacheDirectory());
-	const QStringList directories(cacheMainDirectory.entryList(QDir::AllDirs | QDir::NoDotAndDotDot));
+	QVector<QUrl> urls;
+	QMultiMap<qint64, QUrl>::const_iterator iterator;
 
-	for (int i = 0; i < directories.count(); ++i)
+	for (iterator = m_times.lowerBound(QDateTime::currentDateTime().addSecs(-period * 3600).toMSecsSinceEpoch()); iterator != m_times.constEnd(); ++iterator)
 	{
-		const QDir cacheSubDirectory(cacheMainDirectory.absoluteFilePath(directories.at(i)));
-		const QStringList subDirectories(cacheSubDirectory.entryList(QDir::AllDirs | QDir::NoDotAndDotDot));
+		urls.append(iterator.value());
+	}
 
-		for (int j = 0; j < subDirectories.count(); ++j)
-		{
-			const QFileInfoList files(QDir(cacheSubDirectory.absoluteFilePath(subDirectories.at(j))).entryInfoList(QDir::Files));
+	for (int i = 0; i < urls.count(); ++i)
+	{
+		remove(urls.at(i));
+	}
+}
+
+void NetworkCache::clear()
+{
+	stopIndexing();
+
+	m_isIndexReady = false;
+
+	QNetworkDiskCache::clear();
 
-			for (int k = 0; k < files.count(); ++k)
+	m_entries.clear();
+	m_times.clear();
+	m_removedUrls.clear();
+
+	m_size = 0;
+	m_isIndexReady = true;
+}
+
+void NetworkCache::loadIndex()
+{
+	QFile file(getIndexPath());
+
+	if (file.open(QIODevice::ReadOnly))
+	{
+		QDataStream stream(&file);
+		stream.setVersion(QDataStream::Qt_5_0);
+
+		quint32 magic(0);
+		quint32 version(0);
+
+		stream >> magic >> version;
+
+		if (magic == m_indexMagic && version == m_indexVersion)
+		{
+			while (!stream.atEnd())
 			{
-				if (files.at(k).lastModified().secsTo(QDateTime::currentDateTime()) < (period * 3600))
-				{
-					const QNetworkCacheMetaData metaData(fileMetaData(files.at(k).absoluteFilePath()));
+				EntryInformation entry;
+
+				stream >> entry.url >> entry.path >> entry.contentType >> entry.lastModified >> entry.expirationDate >> entry.timeStored >> entry.size;
 
-					if (metaData.isValid())
-					{
-						remove(metaData.url());
-					}
+				if (stream.status() != QDataStream::Ok)
+				{
+					break;
 				}
+
+				insertEntry(entry);
 			}
+
+			m_isIndexReady = (stream.status() == QDataStream::Ok);
+		}
+		else
+		{
+			m_isIndexReady = false;
+		}
+
+		file.close();
+
+		file.remove();
+
+		if (m_isIndexReady)
+		{
+			return;
 		}
+
+		m_entries.clear();
+		m_times.clear();
+
+		m_size = 0;
 	}
+
+	m_isIndexReady = false;
+	m_indexIterator = new QDirIterator(cacheDirectory(), QDir::Files, QDirIterator::Subdirectories);
+	m_indexTimer = startTimer(0);
+}
+
+void NetworkCache::stopIndexing()
+{
+	if (m_indexTimer != 0)
+	{
+		killTimer(m_indexTimer);
+
+		m_indexTimer = 0;
+	}
+
+	if (m_indexIterator)
+	{
+		delete m_indexIterator;
+
+		m_indexIterator = nullptr;
+	}
+}
+
+void NetworkCache::insertEntry(const EntryInformation &entry)
+{
+	takeEntry(entry.url);
+
+	m_entries[entry.url] = entry;
+	m_times.insert(entry.timeStored.toMSecsSinceEpoch(), entry.url);
+
+	m_size += entry.size;
 }
 
 void NetworkCache::insert(QIODevice *device)
 {
+	EntryInformation entry;
+	const bool isTracked(m_devices.contains(device));
+
+	if (isTracked)
+	{
+		entry = m_devices.take(device);
+		entry.size = device->size();
+		entry.timeStored = QDateTime::currentDateTime();
+	}
+
 	QNetworkDiskCache::insert(device);
 
-	if (m_devices.contains(device))
+	if (isTracked)
 	{
-		emit entryAdded(m_devices[device]);
+		const QString path(getDataPath(entry.url));
+
+		if (QFile::exists(path))
+		{
+			entry.path = path;
+		}
+
+		insertEntry(entry);
 
-		m_devices.remove(device);
+		emit entryAdded(entry.url);
+	}
+}
+
+void NetworkCache::updateMetaData(const QNetworkCacheMetaData &metaData)
+{
+	QNetworkDiskCache::updateMetaData(metaData);
+
+	if (m_entries.contains(metaData.url()))
+	{
+		const EntryInformation entry(createEntry(metaData));
+		EntryInformation &existingEntry(m_entries[metaData.url()]);
+		existingEntry.lastModified = entry.lastModified;
+		existingEntry.expirationDate = entry.expirationDate;
+
+		if (!entry.contentType.isEmpty())
+		{
+			existingEntry.contentType = entry.contentType;
+		}
 	}
 }
 
@@ -107,7 +309,7 @@ QIODevice* NetworkCache::prepare(const QNetworkCacheMetaData &metaData)
 
 	if (device)
 	{
-		m_devices[device] = metaData.url();
+		m_devices[device] = createEntry(metaData);
 	}
 
 	return device;
@@ -115,75 +317,161 @@ QIODevice* NetworkCache::prepare(const QNetworkCacheMetaData &metaData)
 
 QString NetworkCache::getPathForUrl(const QUrl &url)
 {
-	if (!url.isValid() || !metaData(url).isValid())
+	if (!url.isValid() || !m_entries.contains(url))
 	{
 		return QString();
 	}
 
-	const QDir cacheMainDirectory(cacheDirectory());
-	const QStringList directories(cacheMainDirectory.entryList(QDir::AllDirs | QDir::NoDotAndDotDot));
+	const QString path(m_entries.value(url).path);
+
+	if (!path.isEmpty())
+	{
+		return ((fileMetaData(path).url() == url) ? path : QString());
+	}
+
+	QDirIterator iterator(cacheDirectory(), QDir::Files, QDirIterator::Subdirectories);
 
-	for (int i = 0; i < directories.count(); ++i)
+	while (iterator.hasNext())
 	{
-		const QDir cacheSubDirectory(cacheMainDirectory.absoluteFilePath(directories.at(i)));
-		const QStringList subDirectories(cacheSubDirectory.entryList(QDir::AllDirs | QDir::NoDotAndDotDot));
+		const QString filePath(iterator.next());
 
-		for (int j = 0; j < subDirectories.count(); ++j)
+		if (!isCacheFile(filePath))
 		{
-			const QDir cacheFilesDirectory(cacheSubDirectory.absoluteFilePath(subDirectories.at(j)));
-			const QStringList files(cacheFilesDirectory.entryList(QDir::Files));
+			continue;
+		}
 
-			for (int k = 0; k < files.count(); ++k)
-			{
-				const QString cacheFilePath(cacheFilesDirectory.absoluteFilePath(files.at(k)));
-				const QNetworkCacheMetaData metaData(fileMetaData(cacheFilePath));
+		const QUrl fileUrl(fileMetaData(filePath).url());
 
-				if (metaData.isValid() && url == metaData.url())
-				{
-					return cacheFilePath;
-				}
-			}
+		if (m_entries.contains(fileUrl))
+		{
+			m_entries[fileUrl].path = filePath;
+		}
+
+		if (fileUrl == url)
+		{
+			return filePath;
 		}
 	}
 
 	return QString();
 }
 
-QVector<QUrl> NetworkCache::getEntries() const
+QString NetworkCache::getDataPath(const QUrl &url) const
 {
-	QVector<QUrl> entries;
-	const QDir cacheMainDirectory(cacheDirectory());
-	const QStringList directories(cacheMainDirectory.entryList(QDir::AllDirs | QDir::NoDotAndDotDot));
+	QUrl cleanUrl(url);
+	cleanUrl.setPassword(QString());
+	cleanUrl.setFragment(QString());
 
-	for (int i = 0; i < directories.count(); ++i)
+	const QByteArray hash(QCryptographicHash::hash(cleanUrl.toEncoded(), QCryptographicHash::Sha1));
+	const QByteArray identifier(QByteArray::number(*reinterpret_cast<const qlonglong*>(hash.constData()), 36).left(8));
+
+	return QDir(cacheDirectory()).absoluteFilePath(QLatin1String("data8/") + QString::number((static_cast<uint>(identifier.at(identifier.length() - 1)) % 16), 16) + QLatin1Char('/') + QString::fromLatin1(identifier) + QLatin1String(".d"));
+}
+
+QString NetworkCache::getIndexPath() const
+{
+	return QDir(cacheDirectory()).absoluteFilePath(QLatin1String("index.dat"));
+}
+
+NetworkCache::EntryInformation NetworkCache::getEntry(const QUrl &url) const
+{
+	return m_entries.value(url);
+}
+
+NetworkCache::EntryInformation NetworkCache::takeEntry(const QUrl &url)
+{
+	const QHash<QUrl, EntryInformation>::iterator iterator(m_entries.find(url));
+
+	if (iterator == m_entries.end())
 	{
-		const QDir cacheSubDirectory(cacheMainDirectory.absoluteFilePath(directories.at(i)));
-		const QStringList subDirectories(cacheSubDirectory.entryList(QDir::AllDirs | QDir::NoDotAndDotDot));
+		return {};
+	}
 
-		for (int j = 0; j < subDirectories.count(); ++j)
-		{
-			const QDir cacheFilesDirectory(cacheSubDirectory.absoluteFilePath(subDirectories.at(j)));
-			const QStringList files(cacheFilesDirectory.entryList(QDir::Files));
+	const EntryInformation entry(iterator.value());
 
-			for (int k = 0; k < files.count(); ++k)
-			{
-				const QNetworkCacheMetaData metaData(fileMetaData(cacheFilesDirectory.absoluteFilePath(files.at(k))));
+	m_entries.erase(iterator);
+	m_times.remove(entry.timeStored.toMSecsSinceEpoch(), url);
 
-				if (metaData.url().isValid())
-				{
-					entries.append(metaData.url());
-				}
-			}
+	m_size -= entry.size;
+
+	return entry;
+}
+
+NetworkCache::EntryInformation NetworkCache::createEntry(const QNetworkCacheMetaData &metaData)
+{
+	EntryInformation entry;
+	entry.url = metaData.url();
+	entry.lastModified = metaData.lastModified();
+	entry.expirationDate = metaData.expirationDate();
+
+	const QList<QNetworkCacheMetaData::RawHeader> headers(metaData.rawHeaders());
+
+	for (int i = 0; i < headers.count(); ++i)
+	{
+		if (headers.at(i).first.toLower() == QByteArray("content-type"))
+		{
+			entry.contentType = QString::fromLatin1(headers.at(i).second).section(QLatin1Char(';'), 0, 0).trimmed().toLower();
+
+			break;
 		}
 	}
 
+	return entry;
+}
+
+QVector<QUrl> NetworkCache::getEntries() const
+{
+	QVector<QUrl> entries;
+	entries.reserve(m_entries.count());
+
+	QHash<QUrl, EntryInformation>::const_iterator iterator;
+
+	for (iterator = m_entries.constBegin(); iterator != m_entries.constEnd(); ++iterator)
+	{
+		entries.append(iterator.key());
+	}
+
 	return entries;
 }
 
+qint64 NetworkCache::expire()
+{
+	if (!m_isIndexReady || m_size < maximumCacheSize())
+	{
+		return m_size;
+	}
+
+	const qint64 goal((maximumCacheSize() * 9) / 10);
+	qint64 size(m_size);
+	QVector<QUrl> urls;
+	QMultiMap<qint64, QUrl>::const_iterator iterator;
+
+	for (iterator = m_times.constBegin(); iterator != m_times.constEnd() && size > goal; ++iterator)
+	{
+		urls.append(iterator.value());
+
+		size -= m_entries.value(iterator.value()).size;
+	}
+
+	for (int i = 0; i < urls.count(); ++i)
+	{
+		remove(urls.at(i));
+	}
+
+	return m_size;
+}
+
 bool NetworkCache::remove(const QUrl &url)
 {
 	const bool result(QNetworkDiskCache::remove(url));
 
+	takeEntry(url);
+
+	if (!m_isIndexReady)
+	{
+		m_removedUrls.insert(url);
+	}
+
 	if (result)
 	{
 		emit entryRemoved(url);
@@ -192,4 +480,37 @@ bool NetworkCache::remove(const QUrl &url)
 	return result;
 }
 
+bool NetworkCache::saveIndex() const
+{
+	QSaveFile file(getIndexPath());
+
+	if (!file.open(QIODevice::WriteOnly))
+	{
+		return false;
+	}
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_5_0);
+	stream << m_indexMagic << m_indexVersion;
+
+	QHash<QUrl, EntryInformation>::const_iterator iterator;
+
+	for (iterator = m_entries.constBegin(); iterator != m_entries.constEnd(); ++iterator)
+	{
+		stream << iterator.value().url << iterator.value().path << iterator.value().contentType << iterator.value().lastModified << iterator.value().expirationDate << iterator.value().timeStored << iterator.value().size;
+	}
+
+	return file.commit();
+}
+
+bool NetworkCache::isCacheFile(const QString &path) const
+{
+	return (QDir(cacheDirectory()).relativeFilePath(path).count(QLatin1Char('/')) == 2);
+}
+
+bool NetworkCache::isIndexReady() const
+{
+	return m_isIndexReady;
+}
+
 }
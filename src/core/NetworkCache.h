@@ -20,6 +20,10 @@
 #ifndef OTTER_NETWORKCACHE_H
 #define OTTER_NETWORKCACHE_H
 
+#include <QtCore/QDateTime>
+#include <QtCore/QDirIterator>
+#include <QtCore/QMultiMap>
+#include <QtCore/QSet>
 #include <QtNetwork/QNetworkDiskCache>
 
 namespace Otter
@@ -30,25 +34,67 @@ class NetworkCache final : public QNetworkDiskCache
 	Q_OBJECT
 
 public:
+	struct EntryInformation
+	{
+		QUrl url;
+		QString path;
+		QString contentType;
+		QDateTime lastModified;
+		QDateTime expirationDate;
+		QDateTime timeStored;
+		qint64 size = 0;
+	};
+
 	explicit NetworkCache(QObject *parent = nullptr);
+	~NetworkCache();
 
 	void clearCache(int period = 0);
 	void insert(QIODevice *device) override;
+	void updateMetaData(const QNetworkCacheMetaData &metaData) override;
 	QIODevice* prepare(const QNetworkCacheMetaData &metaData) override;
 	QString getPathForUrl(const QUrl &url);
+	EntryInformation getEntry(const QUrl &url) const;
 	QVector<QUrl> getEntries() const;
 	bool remove(const QUrl &url) override;
+	bool isIndexReady() const;
+
+public slots:
+	void clear() override;
+
+protected:
+	void timerEvent(QTimerEvent *event) override;
+	void loadIndex();
+	void stopIndexing();
+	void insertEntry(const EntryInformation &entry);
+	EntryInformation takeEntry(const QUrl &url);
+	QString getDataPath(const QUrl &url) const;
+	QString getIndexPath() const;
+	static EntryInformation createEntry(const QNetworkCacheMetaData &metaData);
+	qint64 expire() override;
+	bool saveIndex() const;
+	bool isCacheFile(const QString &path) const;
 
 protected slots:
 	void handleOptionChanged(int identifier, const QVariant &value);
 
 private:
-	QHash<QIODevice*, QUrl> m_devices;
+	QDirIterator *m_indexIterator;
+	QHash<QIODevice*, EntryInformation> m_devices;
+	QHash<QUrl, EntryInformation> m_entries;
+	QMultiMap<qint64, QUrl> m_times;
+	QSet<QUrl> m_removedUrls;
+	qint64 m_size;
+	int m_indexTimer;
+	bool m_isIndexReady;
+
+	static const quint32 m_indexMagic;
+	static const quint32 m_indexVersion;
 
 signals:
 	void cleared();
 	void entryAdded(QUrl url);
 	void entryRemoved(QUrl url);
+	void indexReady();
 };
 
 }
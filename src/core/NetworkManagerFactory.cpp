@@ -265,7 +265,7 @@ void NetworkManagerFactory::clearCookies(int period)
 {
 	if (!m_cookieJar)
 	{
-		m_cookieJar = new CookieJar(QCoreApplication::instance());
+		m_cookieJar = new CookieJar(false, QCoreApplication::instance());
 	}
 
 	m_cookieJar->clearCookies(period);
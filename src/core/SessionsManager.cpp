@@ -25,44 +25,164 @@
 #include "SessionModel.h"
 #include "../ui/MainWindow.h"
 
+#include <QtConcurrent/QtConcurrentRun>
 #include <QtCore/QDir>
 #include <QtCore/QJsonArray>
 #include <QtCore/QJsonObject>
+#include <QtCore/QTimerEvent>
 
 namespace Otter
 {
 
+QString SessionWindow::getTitle() const
+{
+	if (historyIndex >= 0 && historyIndex < history.count())
+	{
+		if (!history.at(historyIndex).title.isEmpty())
+		{
+			return history.at(historyIndex).title;
+		}
+
+		if (history.at(historyIndex).url == QLatin1String("about:start") || (Utils::isUrlEmpty(history.at(historyIndex).url) && SessionsManager::getDefaults().isStartPageEnabled))
+		{
+			return QCoreApplication::translate("main", "Start Page");
+		}
+	}
+
+	return QCoreApplication::translate("main", "(Untitled)");
+}
+
+int SessionWindow::getZoom() const
+{
+	if (historyIndex >= 0 && historyIndex < history.count())
+	{
+		return history.at(historyIndex).zoom;
+	}
+
+	return SessionsManager::getDefaults().zoom;
+}
+
 SessionsManager* SessionsManager::m_instance(nullptr);
 SessionModel* SessionsManager::m_model(nullptr);
 QString SessionsManager::m_sessionPath;
 QString SessionsManager::m_sessionTitle;
 QString SessionsManager::m_cachePath;
 QString SessionsManager::m_profilePath;
+QHash<QString, SessionsManager::CachedSession> SessionsManager::m_sessions;
 QVector<SessionMainWindow> SessionsManager::m_closedWindows;
+SessionDefaults SessionsManager::m_defaults;
 bool SessionsManager::m_isDirty(false);
 bool SessionsManager::m_isPrivate(false);
 bool SessionsManager::m_isReadOnly(false);
+const quint32 SessionsManager::m_journalMagic(0x534a4f54);
+const quint32 SessionsManager::m_journalVersion(1);
 
 SessionsManager::SessionsManager(QObject *parent) : QObject(parent),
+	m_loadWatcher(nullptr),
+	m_saveWatcher(nullptr),
+	m_journalSavesAmount(0),
 	m_saveTimer(0)
 {
+	updateDefaults();
+
+	connect(SettingsManager::getInstance(), SIGNAL(optionChanged(int,QVariant)), this, SLOT(handleOptionChanged(int)));
 }
 
 void SessionsManager::timerEvent(QTimerEvent *event)
 {
-	if (event->timerId() == m_saveTimer)
+	if (event->timerId() != m_saveTimer)
+	{
+		return;
+	}
+
+	killTimer(m_saveTimer);
+
+	m_saveTimer = 0;
+
+	if (m_isPrivate)
 	{
 		m_isDirty = false;
 
-		killTimer(m_saveTimer);
+		return;
+	}
 
-		m_saveTimer = 0;
+	if (m_saveWatcher)
+	{
+		scheduleSave();
 
-		if (!m_isPrivate)
-		{
-			saveSession(QString(), QString(), nullptr, false);
-		}
+		return;
+	}
+
+	m_isDirty = false;
+
+	SessionInformation session(createSession(QString(), QString(), nullptr, false));
+
+	if (session.windows.isEmpty())
+	{
+		return;
+	}
+
+	const bool isSnapshot(m_savedSession.windows.isEmpty() || m_journalSavesAmount >= 100);
+
+	QDir().mkpath(m_profilePath + QLatin1String("/sessions/"));
+
+	m_saveWatcher = new QFutureWatcher<bool>(this);
+
+	connect(m_saveWatcher, SIGNAL(finished()), this, SLOT(handleSaveFinished()));
+
+	m_saveWatcher->setFuture(QtConcurrent::run(&SessionsManager::saveSessionState, session, m_savedSession, SettingsManager::getOption(SettingsManager::Sessions_OptionsExludedFromSavingOption).toStringList(), isSnapshot));
+
+	m_savedSession = session;
+	m_journalSavesAmount = (isSnapshot ? 0 : (m_journalSavesAmount + 1));
+}
+
+void SessionsManager::handleOptionChanged(int identifier)
+{
+	switch (identifier)
+	{
+		case SettingsManager::Content_DefaultZoomOption:
+		case SettingsManager::Interface_NewTabOpeningActionOption:
+		case SettingsManager::StartPage_EnableStartPageOption:
+			updateDefaults();
+
+			break;
+		default:
+			break;
+	}
+}
+
+void SessionsManager::handleSessionLoaded()
+{
+	if (!m_loadWatcher)
+	{
+		return;
 	}
+
+	CachedSession cachedSession(m_loadWatcher->result());
+
+	resolveSession(cachedSession.session);
+
+	m_sessions[m_loadPath] = cachedSession;
+
+	m_loadWatcher->deleteLater();
+	m_loadWatcher = nullptr;
+	m_loadPath.clear();
+}
+
+void SessionsManager::handleSaveFinished()
+{
+	if (!m_saveWatcher)
+	{
+		return;
+	}
+
+	if (!m_saveWatcher->result())
+	{
+		m_savedSession = SessionInformation();
+	}
+
+	m_saveWatcher->deleteLater();
+	m_saveWatcher = nullptr;
 }
 
 void SessionsManager::createInstance(const QString &profilePath, const QString &cachePath, bool isPrivate, bool isReadOnly)
@@ -77,6 +197,30 @@ void SessionsManager::createInstance(const QString &profilePath, const QString &
 	}
 }
 
+void SessionsManager::preloadSession(const QString &path)
+{
+	if (!m_instance || m_instance->m_loadWatcher || m_sessions.contains(path))
+	{
+		return;
+	}
+
+	m_instance->m_loadPath = path;
+	m_instance->m_loadWatcher = new QFutureWatcher<CachedSession>(m_instance);
+
+	connect(m_instance->m_loadWatcher, SIGNAL(finished()), m_instance, SLOT(handleSessionLoaded()));
+
+	m_instance->m_loadWatcher->setFuture(QtConcurrent::run(&SessionsManager::readSession, path, m_defaults));
+}
+
+void SessionsManager::updateDefaults()
+{
+	m_defaults.windowState.state = ((SettingsManager::getOption(SettingsManager::Interface_NewTabOpeningActionOption).toString() == QLatin1String("maximizeTab")) ? Qt::WindowMaximized : Qt::WindowNoState);
+	m_defaults.zoom = SettingsManager::getOption(SettingsManager::Content_DefaultZoomOption).toInt();
+	m_defaults.isStartPageEnabled = SettingsManager::getOption(SettingsManager::StartPage_EnableStartPageOption).toBool();
+
+	m_sessions.clear();
+}
+
 void SessionsManager::scheduleSave()
 {
 	if (m_saveTimer == 0 && !m_isPrivate)
@@ -195,23 +339,57 @@ QString SessionsManager::getSessionPath(const QString &path, bool isBound)
 	return QDir::toNativeSeparators(m_profilePath + QLatin1String("/sessions/") + cleanPath);
 }
 
-SessionInformation SessionsManager::getSession(const QString &path)
+void SessionsManager::resolveSession(SessionInformation &session)
 {
-	SessionInformation session;
+	if (session.title.isEmpty())
+	{
+		session.title = ((session.path == QLatin1String("default")) ? tr("Default") : tr("(Untitled)"));
+	}
+
+	for (int i = 0; i < session.windows.count(); ++i)
+	{
+		SessionMainWindow &mainWindow(session.windows[i]);
+
+		for (int j = 0; j < mainWindow.windows.count(); ++j)
+		{
+			SessionWindow &window(mainWindow.windows[j]);
+			QVariantMap::const_iterator iterator;
+
+			for (iterator = window.optionNames.constBegin(); iterator != window.optionNames.constEnd(); ++iterator)
+			{
+				const int optionIdentifier(SettingsManager::getOptionIdentifier(iterator.key()));
+
+				if (optionIdentifier >= 0)
+				{
+					window.options[optionIdentifier] = iterator.value();
+				}
+			}
+
+			window.optionNames.clear();
+		}
+	}
+}
+
+SessionsManager::CachedSession SessionsManager::readSession(const QString &path, const SessionDefaults &defaults)
+{
+	CachedSession cachedSession(createCachedSession(path));
+	SessionInformation &session(cachedSession.session);
 	const JsonSettings settings(getSessionPath(path));
 
 	if (settings.isNull())
 	{
 		session.path = path;
 
-		return session;
+		loadJournal(session, getJournalPath(getSessionPath(path)));
+
+		return cachedSession;
 	}
 
-	const int defaultZoom(SettingsManager::getOption(SettingsManager::Content_DefaultZoomOption).toInt());
+	const int defaultZoom(defaults.zoom);
 	const QJsonArray mainWindowsArray(settings.object().value(QLatin1String("windows")).toArray());
 
 	session.path = path;
-	session.title = settings.object().value(QLatin1String("title")).toString((path == QLatin1String("default")) ? tr("Default") : tr("(Untitled)"));
+	session.title = settings.object().value(QLatin1String("title")).toString();
 	session.index = (settings.object().value(QLatin1String("currentIndex")).toInt(1) - 1);
 	session.isClean = settings.object().value(QLatin1String("isClean")).toBool(true);
 
@@ -241,18 +419,7 @@ SessionInformation SessionsManager::getSession(const QString &path)
 
 			if (windowObject.contains(QLatin1String("options")))
 			{
-				const QJsonObject optionsObject(windowObject.value(QLatin1String("options")).toObject());
-				QJsonObject::const_iterator iterator;
-
-				for (iterator = optionsObject.constBegin(); iterator != optionsObject.constEnd(); ++iterator)
-				{
-					const int optionIdentifier(SettingsManager::getOptionIdentifier(iterator.key()));
-
-					if (optionIdentifier >= 0)
-					{
-						sessionWindow.options[optionIdentifier] = iterator.value().toVariant();
-					}
-				}
+				sessionWindow.optionNames = windowObject.value(QLatin1String("options")).toObject().toVariantMap();
 			}
 
 			for (int k = 0; k < windowHistoryArray.count(); ++k)
@@ -284,14 +451,251 @@ SessionInformation SessionsManager::getSession(const QString &path)
 		session.windows.append(sessionMainWindow);
 	}
 
+	loadJournal(session, getJournalPath(getSessionPath(path)));
+
 	if (session.index < 0 || session.index >= session.windows.count())
 	{
 		session.index = (session.windows.count() - 1);
 	}
 
+	return cachedSession;
+}
+
+SessionsManager::CachedSession SessionsManager::createCachedSession(const QString &path)
+{
+	const QFileInfo sessionInformation(getSessionPath(path));
+	const QFileInfo journalInformation(getJournalPath(sessionInformation.filePath()));
+	CachedSession cachedSession;
+	cachedSession.sessionModified = sessionInformation.lastModified();
+	cachedSession.journalModified = journalInformation.lastModified();
+	cachedSession.sessionSize = (sessionInformation.exists() ? sessionInformation.size() : -1);
+	cachedSession.journalSize = (journalInformation.exists() ? journalInformation.size() : -1);
+
+	return cachedSession;
+}
+
+void SessionsManager::loadJournal(SessionInformation &session, const QString &path)
+{
+	QFile file(path);
+
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		return;
+	}
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_5_0);
+
+	quint32 magic(0);
+	quint32 version(0);
+
+	stream >> magic >> version;
+
+	if (magic != m_journalMagic || version != m_journalVersion)
+	{
+		return;
+	}
+
+	while (!stream.atEnd())
+	{
+		quint8 type(0);
+
+		stream >> type;
+
+		if (type == StructureRecord)
+		{
+			QString title;
+			int index(-1);
+			bool isClean(true);
+			quint32 mainWindowsAmount(0);
+
+			stream >> title >> index >> isClean >> mainWindowsAmount;
+
+			if (stream.status() != QDataStream::Ok || mainWindowsAmount > static_cast<quint64>(file.bytesAvailable() / 12))
+			{
+				break;
+			}
+
+			QVector<SessionMainWindow> windows(session.windows);
+			windows.resize(static_cast<int>(mainWindowsAmount));
+
+			bool isValid(true);
+
+			for (int i = 0; i < windows.count(); ++i)
+			{
+				quint32 windowsAmount(0);
+
+				stream >> windows[i].geometry >> windows[i].index >> windowsAmount;
+
+				if (stream.status() != QDataStream::Ok || windowsAmount > static_cast<quint64>(windows.at(i).windows.count() + (file.size() / 9)))
+				{
+					isValid = false;
+
+					break;
+				}
+
+				windows[i].windows.resize(static_cast<int>(windowsAmount));
+			}
+
+			if (!isValid)
+			{
+				break;
+			}
+
+			session.title = title;
+			session.index = index;
+			session.isClean = isClean;
+			session.windows = windows;
+		}
+		else if (type == WindowRecord)
+		{
+			quint32 mainWindowIndex(0);
+			quint32 windowIndex(0);
+
+			stream >> mainWindowIndex >> windowIndex;
+
+			const SessionWindow window(readWindow(stream));
+
+			if (stream.status() != QDataStream::Ok)
+			{
+				break;
+			}
+
+			if (mainWindowIndex >= static_cast<quint32>(session.windows.count()) || windowIndex >= static_cast<quint32>(session.windows.at(mainWindowIndex).windows.count()))
+			{
+				break;
+			}
+
+			session.windows[mainWindowIndex].windows[windowIndex] = window;
+		}
+		else
+		{
+			break;
+		}
+
+		if (stream.status() != QDataStream::Ok)
+		{
+			break;
+		}
+	}
+}
+
+void SessionsManager::writeWindow(QDataStream &stream, const SessionWindow &window, const QStringList &excludedOptions)
+{
+	QVariantMap options;
+	QHash<int, QVariant>::const_iterator iterator;
+
+	for (iterator = window.options.constBegin(); iterator != window.options.constEnd(); ++iterator)
+	{
+		const QString optionName(SettingsManager::getOptionName(iterator.key()));
+
+		if (!optionName.isEmpty() && !excludedOptions.contains(optionName))
+		{
+			options[optionName] = iterator.value();
+		}
+	}
+
+	stream << window.state.geometry << static_cast<int>(window.state.state) << options << window.historyIndex << window.parentGroup << window.isAlwaysOnTop << window.isPinned << static_cast<quint32>(window.history.count());
+
+	for (int i = 0; i < window.history.count(); ++i)
+	{
+		stream << window.history.at(i).url << window.history.at(i).title << window.history.at(i).position << window.history.at(i).zoom;
+	}
+}
+
+QString SessionsManager::getJournalPath(const QString &path)
+{
+	const QFileInfo information(path);
+
+	return information.path() + QDir::separator() + information.completeBaseName() + QLatin1String(".journal");
+}
+
+SessionInformation SessionsManager::createSession(const QString &path, const QString &title, MainWindow *window, bool isClean)
+{
+	SessionInformation session;
+	session.path = getSessionPath(path);
+	session.title = (title.isEmpty() ? m_sessionTitle : title);
+	session.isClean = isClean;
+
+	QVector<MainWindow*> windows;
+
+	if (window)
+	{
+		windows.append(window);
+	}
+	else
+	{
+		windows = Application::getWindows();
+	}
+
+	for (int i = 0; i < windows.count(); ++i)
+	{
+		if (!windows.at(i)->isPrivate())
+		{
+			session.windows.append(windows.at(i)->getSession());
+		}
+	}
+
 	return session;
 }
 
+SessionWindow SessionsManager::readWindow(QDataStream &stream)
+{
+	SessionWindow window;
+	int state(Qt::WindowNoState);
+	quint32 amount(0);
+
+	stream >> window.state.geometry >> state >> window.optionNames >> window.historyIndex >> window.parentGroup >> window.isAlwaysOnTop >> window.isPinned >> amount;
+
+	window.state.state = static_cast<Qt::WindowState>(state);
+
+	for (quint32 i = 0; i < amount; ++i)
+	{
+		WindowHistoryEntry entry;
+
+		stream >> entry.url >> entry.title >> entry.position >> entry.zoom;
+
+		if (stream.status() != QDataStream::Ok)
+		{
+			break;
+		}
+
+		window.history.append(entry);
+	}
+
+	return window;
+}
+
+SessionInformation SessionsManager::getSession(const QString &path)
+{
+	if (m_instance && m_instance->m_loadWatcher && m_instance->m_loadPath == path)
+	{
+		m_instance->m_loadWatcher->waitForFinished();
+		m_instance->handleSessionLoaded();
+	}
+
+	const CachedSession currentSession(createCachedSession(path));
+	const QHash<QString, CachedSession>::const_iterator iterator(m_sessions.constFind(path));
+
+	if (iterator != m_sessions.constEnd() && iterator->sessionModified == currentSession.sessionModified && iterator->journalModified == currentSession.journalModified && iterator->sessionSize == currentSession.sessionSize && iterator->journalSize == currentSession.journalSize)
+	{
+		return iterator->session;
+	}
+
+	CachedSession cachedSession(readSession(path, getDefaults()));
+
+	resolveSession(cachedSession.session);
+
+	m_sessions[path] = cachedSession;
+
+	return cachedSession.session;
+}
+
+SessionDefaults SessionsManager::getDefaults()
+{
+	return m_defaults;
+}
+
 QStringList SessionsManager::getClosedWindows()
 {
 	QStringList closedWindows;
@@ -478,31 +882,7 @@ bool SessionsManager::saveSession(const QString &path, const QString &title, Mai
 		return false;
 	}
 
-	SessionInformation session;
-	session.path = getSessionPath(path);
-	session.title = (title.isEmpty() ? m_sessionTitle : title);
-	session.isClean = isClean;
-
-	QVector<MainWindow*> windows;
-
-	if (window)
-	{
-		windows.append(window);
-	}
-	else
-	{
-		windows = Application::getWindows();
-	}
-
-	for (int i = 0; i < windows.count(); ++i)
-	{
-		if (!windows.at(i)->isPrivate())
-		{
-			session.windows.append(windows.at(i)->getSession());
-		}
-	}
-
-	return saveSession(session);
+	return saveSession(createSession(path, title, window, isClean));
 }
 
 bool SessionsManager::saveSession(const SessionInformation &session)
@@ -533,7 +913,33 @@ bool SessionsManager::saveSession(const SessionInformation &session)
 		}
 	}
 
-	const QStringList excludedOptions(SettingsManager::getOption(SettingsManager::Sessions_OptionsExludedFromSavingOption).toStringList());
+	if (m_instance && m_instance->m_saveWatcher)
+	{
+		m_instance->m_saveWatcher->waitForFinished();
+	}
+
+	const bool result(writeSession(session, path, SettingsManager::getOption(SettingsManager::Sessions_OptionsExludedFromSavingOption).toStringList()));
+
+	m_sessions.clear();
+
+	if (!result)
+	{
+		return false;
+	}
+
+	QFile::remove(getJournalPath(path));
+
+	if (m_instance && path == getSessionPath(QString()))
+	{
+		m_instance->m_savedSession = session;
+		m_instance->m_journalSavesAmount = 0;
+	}
+
+	return true;
+}
+
+bool SessionsManager::writeSession(const SessionInformation &session, const QString &path, const QStringList &excludedOptions)
+{
 	QJsonArray mainWindowsArray;
 	QJsonObject sessionObject;
 	sessionObject.insert(QLatin1String("title"), session.title);
@@ -644,10 +1050,78 @@ bool SessionsManager::saveSession(const SessionInformation &session)
 	return settings.save(path);
 }
 
+bool SessionsManager::writeJournal(const SessionInformation &session, const SessionInformation &previousSession, const QStringList &excludedOptions)
+{
+	QByteArray data;
+	QDataStream stream(&data, QIODevice::WriteOnly);
+	stream.setVersion(QDataStream::Qt_5_0);
+	stream << static_cast<quint8>(StructureRecord) << session.title << session.index << session.isClean << static_cast<quint32>(session.windows.count());
+
+	for (int i = 0; i < session.windows.count(); ++i)
+	{
+		stream << session.windows.at(i).geometry << session.windows.at(i).index << static_cast<quint32>(session.windows.at(i).windows.count());
+	}
+
+	for (int i = 0; i < session.windows.count(); ++i)
+	{
+		const QVector<SessionWindow> windows(session.windows.at(i).windows);
+		const QVector<SessionWindow> previousWindows((i < previousSession.windows.count()) ? previousSession.windows.at(i).windows : QVector<SessionWindow>());
+
+		for (int j = 0; j < windows.count(); ++j)
+		{
+			if (j < previousWindows.count() && isSameWindow(windows.at(j), previousWindows.at(j)))
+			{
+				continue;
+			}
+
+			stream << static_cast<quint8>(WindowRecord) << static_cast<quint32>(i) << static_cast<quint32>(j);
+
+			writeWindow(stream, windows.at(j), excludedOptions);
+		}
+	}
+
+	QFile file(getJournalPath(session.path));
+
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Append))
+	{
+		return false;
+	}
+
+	if (file.size() == 0)
+	{
+		QDataStream headerStream(&file);
+		headerStream.setVersion(QDataStream::Qt_5_0);
+		headerStream << m_journalMagic << m_journalVersion;
+	}
+
+	return (file.write(data) == data.size() && file.flush());
+}
+
+bool SessionsManager::saveSessionState(const SessionInformation &session, const SessionInformation &previousSession, const QStringList &excludedOptions, bool isSnapshot)
+{
+	if (!isSnapshot)
+	{
+		return writeJournal(session, previousSession, excludedOptions);
+	}
+
+	if (!writeSession(session, session.path, excludedOptions))
+	{
+		return false;
+	}
+
+	QFile::remove(getJournalPath(session.path));
+
+	return true;
+}
+
 bool SessionsManager::deleteSession(const QString &path)
 {
 	const QString cleanPath(getSessionPath(path, true));
 
+	m_sessions.clear();
+
+	QFile::remove(getJournalPath(cleanPath));
+
 	if (QFile::exists(cleanPath))
 	{
 		return QFile::remove(cleanPath);
@@ -656,6 +1130,27 @@ bool SessionsManager::deleteSession(const QString &path)
 	return false;
 }
 
+bool SessionsManager::isSameWindow(const SessionWindow &first, const SessionWindow &second)
+{
+	if (first.historyIndex != second.historyIndex || first.parentGroup != second.parentGroup || first.isAlwaysOnTop != second.isAlwaysOnTop || first.isPinned != second.isPinned || first.state.state != second.state.state || first.state.geometry != second.state.geometry || first.history.count() != second.history.count() || first.options != second.options)
+	{
+		return false;
+	}
+
+	for (int i = 0; i < first.history.count(); ++i)
+	{
+		const WindowHistoryEntry &firstEntry(first.history.at(i));
+		const WindowHistoryEntry &secondEntry(second.history.at(i));
+
+		if (firstEntry.zoom != secondEntry.zoom || firstEntry.position != secondEntry.position || firstEntry.url != secondEntry.url || firstEntry.title != secondEntry.title)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
 bool SessionsManager::isPrivate()
 {
 	return m_isPrivate;
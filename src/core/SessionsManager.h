@@ -25,6 +25,9 @@
 #include "Utils.h"
 
 #include <QtCore/QCoreApplication>
+#include <QtCore/QDataStream>
+#include <QtCore/QDateTime>
+#include <QtCore/QFutureWatcher>
 #include <QtCore/QRect>
 
 namespace Otter
@@ -33,7 +36,7 @@ namespace Otter
 struct WindowState
 {
 	QRect geometry;
-	Qt::WindowState state = ((SettingsManager::getOption(SettingsManager::Interface_NewTabOpeningActionOption).toString() == QLatin1String("maximizeTab")) ? Qt::WindowMaximized : Qt::WindowNoState);
+	Qt::WindowState state = Qt::WindowNoState;
 };
 
 struct WindowHistoryEntry
@@ -41,7 +44,14 @@ struct WindowHistoryEntry
 	QString url;
 	QString title;
 	QPoint position;
-	int zoom = SettingsManager::getOption(SettingsManager::Content_DefaultZoomOption).toInt();
+	int zoom = 100;
+};
+
+struct SessionDefaults
+{
+	WindowState windowState;
+	int zoom = 100;
+	bool isStartPageEnabled = false;
 };
 
 struct WindowHistoryInformation
@@ -54,6 +64,7 @@ struct SessionWindow
 {
 	WindowState state;
 	QHash<int, QVariant> options;
+	QVariantMap optionNames;
 	QVector<WindowHistoryEntry> history;
 	int parentGroup = 0;
 	int historyIndex = -1;
@@ -70,33 +81,8 @@ struct SessionWindow
 		return QString();
 	}
 
-	QString getTitle() const
-	{
-		if (historyIndex >= 0 && historyIndex < history.count())
-		{
-			if (!history.at(historyIndex).title.isEmpty())
-			{
-				return history.at(historyIndex).title;
-			}
-
-			if (history.at(historyIndex).url == QLatin1String("about:start") || (SettingsManager::getOption(SettingsManager::StartPage_EnableStartPageOption).toBool() && Utils::isUrlEmpty(history.at(historyIndex).url)))
-			{
-				return QCoreApplication::translate("main", "Start Page");
-			}
-		}
-
-		return QCoreApplication::translate("main", "(Untitled)");
-	}
-
-	int getZoom() const
-	{
-		if (historyIndex >= 0 && historyIndex < history.count())
-		{
-			return history.at(historyIndex).zoom;
-		}
-
-		return SettingsManager::getOption(SettingsManager::Content_DefaultZoomOption).toInt();
-	}
+	QString getTitle() const;
+	int getZoom() const;
 };
 
 struct SessionMainWindow
@@ -146,6 +132,7 @@ public:
 	Q_DECLARE_FLAGS(OpenHints, OpenHint)
 
 	static void createInstance(const QString &profilePath, const QString &cachePath, bool isPrivate = false, bool isReadOnly = false);
+	static void preloadSession(const QString &path);
 	static void clearClosedWindows();
 	static void storeClosedWindow(MainWindow *window);
 	static void markSessionModified();
@@ -159,6 +146,7 @@ public:
 	static QString getWritableDataPath(const QString &path);
 	static QString getSessionPath(const QString &path, bool isBound = false);
 	static SessionInformation getSession(const QString &path);
+	static SessionDefaults getDefaults();
 	static QStringList getClosedWindows();
 	static QStringList getSessions();
 	static SessionsManager::OpenHints calculateOpenHints(OpenHints hints = DefaultOpen, Qt::MouseButton button = Qt::LeftButton, int modifiers = -1);
@@ -173,12 +161,50 @@ public:
 	static bool hasUrl(const QUrl &url, bool activate = false);
 
 protected:
+	enum JournalRecordType : quint8
+	{
+		StructureRecord = 0,
+		WindowRecord
+	};
+
+	struct CachedSession
+	{
+		SessionInformation session;
+		QDateTime sessionModified;
+		QDateTime journalModified;
+		qint64 sessionSize = -1;
+		qint64 journalSize = -1;
+	};
+
 	explicit SessionsManager(QObject *parent);
 
 	void timerEvent(QTimerEvent *event) override;
 	void scheduleSave();
+	static void updateDefaults();
+	static void loadJournal(SessionInformation &session, const QString &path);
+	static void resolveSession(SessionInformation &session);
+	static void writeWindow(QDataStream &stream, const SessionWindow &window, const QStringList &excludedOptions);
+	static QString getJournalPath(const QString &path);
+	static SessionInformation createSession(const QString &path, const QString &title, MainWindow *window, bool isClean);
+	static CachedSession createCachedSession(const QString &path);
+	static CachedSession readSession(const QString &path, const SessionDefaults &defaults);
+	static SessionWindow readWindow(QDataStream &stream);
+	static bool writeSession(const SessionInformation &session, const QString &path, const QStringList &excludedOptions);
+	static bool writeJournal(const SessionInformation &session, const SessionInformation &previousSession, const QStringList &excludedOptions);
+	static bool saveSessionState(const SessionInformation &session, const SessionInformation &previousSession, const QStringList &excludedOptions, bool isSnapshot);
+	static bool isSameWindow(const SessionWindow &first, const SessionWindow &second);
+
+protected slots:
+	void handleOptionChanged(int identifier);
+	void handleSessionLoaded();
+	void handleSaveFinished();
 
 private:
+	QFutureWatcher<CachedSession> *m_loadWatcher;
+	QFutureWatcher<bool> *m_saveWatcher;
+	QString m_loadPath;
+	SessionInformation m_savedSession;
+	int m_journalSavesAmount;
 	int m_saveTimer;
 
 	static SessionsManager *m_instance;
@@ -187,10 +213,14 @@ private:
 	static QString m_sessionTitle;
 	static QString m_cachePath;
 	static QString m_profilePath;
+	static QHash<QString, CachedSession> m_sessions;
 	static QVector<SessionMainWindow> m_closedWindows;
+	static SessionDefaults m_defaults;
 	static bool m_isDirty;
 	static bool m_isPrivate;
 	static bool m_isReadOnly;
+	static const quint32 m_journalMagic;
+	static const quint32 m_journalVersion;
 
 signals:
 	void closedWindowsChanged();
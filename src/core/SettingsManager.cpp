@@ -26,6 +26,7 @@
 #include <QtCore/QSettings>
 #include <QtCore/QStandardPaths>
 #include <QtCore/QTextStream>
+#include <QtCore/QTimerEvent>
 #include <QtCore/QVector>
 
 namespace Otter
@@ -35,15 +36,37 @@ SettingsManager* SettingsManager::m_instance(nullptr);
 QString SettingsManager::m_globalPath;
 QString SettingsManager::m_overridePath;
 QVector<SettingsManager::OptionDefinition> SettingsManager::m_definitions;
+QVector<QString> SettingsManager::m_names;
+QVector<QVariant> SettingsManager::m_values;
+SettingsManager::OverrideNode SettingsManager::m_overrides;
 QHash<QString, int> SettingsManager::m_customOptions;
+QMap<QString, QVariant> SettingsManager::m_pendingValues;
+QMap<QString, QVariant> SettingsManager::m_pendingOverrides;
+QReadWriteLock SettingsManager::m_lock;
 int SettingsManager::m_identifierCounter(-1);
 int SettingsManager::m_optionIdentifierEnumerator(0);
-bool SettingsManager::m_hasWildcardedOverrides(false);
 
-SettingsManager::SettingsManager(QObject *parent) : QObject(parent)
+SettingsManager::SettingsManager(QObject *parent) : QObject(parent),
+	m_saveTimer(0)
 {
 }
 
+SettingsManager::~SettingsManager()
+{
+	if (m_saveTimer != 0)
+	{
+		killTimer(m_saveTimer);
+
+		m_saveTimer = 0;
+	}
+
+	saveOptions();
+
+	QWriteLocker locker(&m_lock);
+
+	clearOverrideNode(&m_overrides);
+}
+
 void SettingsManager::createInstance(const QString &path)
 {
 	if (m_instance)
@@ -157,14 +180,18 @@ void SettingsManager::createInstance(const QString &path)
 	registerOption(Interface_UseSystemIconThemeOption, BooleanType, false);
 	registerOption(Interface_WidgetStyleOption, StringType, QString());
 	registerOption(Network_AcceptLanguageOption, StringType, QLatin1String("system,*;q=0.9"));
+	registerOption(Network_ActiveTransfersLimitOption, IntegerType, 0);
 	registerOption(Network_CookiesKeepModeOption, EnumerationType, QLatin1String("keepUntilExpires"), QStringList({QLatin1String("keepUntilExpires"), QLatin1String("keepUntilExit"), QLatin1String("ask")}));
 	registerOption(Network_CookiesPolicyOption, EnumerationType, QLatin1String("acceptAll"), QStringList({QLatin1String("acceptAll"), QLatin1String("acceptExisting"), QLatin1String("readOnly"), QLatin1String("ignore")}));
 	registerOption(Network_DoNotTrackPolicyOption, EnumerationType, QLatin1String("skip"), QStringList({QLatin1String("skip"), QLatin1String("allow"), QLatin1String("doNotAllow")}));
 	registerOption(Network_EnableReferrerOption, BooleanType, true);
+	registerOption(Network_PrioritizePageLoadsOption, BooleanType, false);
 	registerOption(Network_ProxyOption, EnumerationType, QLatin1String("system"), QStringList(QLatin1String("system")));
 	registerOption(Network_ThirdPartyCookiesAcceptedHostsOption, ListType, QStringList());
 	registerOption(Network_ThirdPartyCookiesPolicyOption, EnumerationType, QLatin1String("acceptAll"), QStringList({QLatin1String("acceptAll"), QLatin1String("acceptExisting"), QLatin1String("ignore")}));
 	registerOption(Network_ThirdPartyCookiesRejectedHostsOption, ListType, QStringList());
+	registerOption(Network_TransferSegmentsAmountOption, IntegerType, 1);
+	registerOption(Network_TransferSpeedLimitOption, IntegerType, 0);
 	registerOption(Network_UserAgentOption, EnumerationType, QLatin1String("default"), QStringList(QLatin1String("default")));
 	registerOption(Network_WorkOfflineOption, BooleanType, false);
 	registerOption(Paths_DownloadsOption, PathType, QStandardPaths::writableLocation(QStandardPaths::DownloadLocation));
@@ -235,29 +262,154 @@ void SettingsManager::createInstance(const QString &path)
 	registerOption(Updates_LastCheckOption, StringType, QString());
 	registerOption(Updates_ServerUrlOption, StringType, QLatin1String("https://www.otter-browser.org/updates/update.json"));
 
-	const QStringList hosts(QSettings(m_overridePath, QSettings::IniFormat).childGroups());
+	loadOptions();
+}
+
+void SettingsManager::timerEvent(QTimerEvent *event)
+{
+	if (event->timerId() == m_saveTimer)
+	{
+		killTimer(m_saveTimer);
+
+		m_saveTimer = 0;
+
+		saveOptions();
+	}
+}
+
+void SettingsManager::scheduleSave()
+{
+	if (m_saveTimer == 0)
+	{
+		m_saveTimer = startTimer(1000);
+	}
+}
+
+void SettingsManager::loadOptions()
+{
+	saveOptions();
+
+	QWriteLocker locker(&m_lock);
+
+	m_values = QVector<QVariant>(m_definitions.count());
+	clearOverrideNode(&m_overrides);
+
+	const QSettings settings(m_globalPath, QSettings::IniFormat);
+	const QStringList keys(settings.allKeys());
+
+	for (int i = 0; i < keys.count(); ++i)
+	{
+		const int identifier(getOptionIdentifier(keys.at(i)));
+
+		if (identifier >= 0 && identifier < m_values.count())
+		{
+			m_values[identifier] = normalizeValue(identifier, settings.value(keys.at(i)));
+		}
+	}
+
+	QSettings overrides(m_overridePath, QSettings::IniFormat);
+	const QStringList hosts(overrides.childGroups());
 
 	for (int i = 0; i < hosts.count(); ++i)
 	{
-		if (hosts.at(i).startsWith(QLatin1Char('*')))
+		overrides.beginGroup(hosts.at(i));
+
+		const QStringList hostKeys(overrides.allKeys());
+		QHash<int, QVariant> &values(getOverrideValues(hosts.at(i)));
+
+		for (int j = 0; j < hostKeys.count(); ++j)
 		{
-			m_hasWildcardedOverrides = true;
+			const int identifier(getOptionIdentifier(hostKeys.at(j)));
 
-			break;
+			if (identifier >= 0 && identifier < m_definitions.count())
+			{
+				values[identifier] = normalizeValue(identifier, overrides.value(hostKeys.at(j)));
+			}
+		}
+
+		overrides.endGroup();
+	}
+}
+
+void SettingsManager::saveOptions()
+{
+	m_lock.lockForWrite();
+
+	const QMap<QString, QVariant> pendingValues(m_pendingValues);
+	const QMap<QString, QVariant> pendingOverrides(m_pendingOverrides);
+
+	m_pendingValues.clear();
+	m_pendingOverrides.clear();
+
+	m_lock.unlock();
+
+	if (!pendingValues.isEmpty())
+	{
+		QSettings settings(m_globalPath, QSettings::IniFormat);
+		QMap<QString, QVariant>::const_iterator iterator;
+
+		for (iterator = pendingValues.constBegin(); iterator != pendingValues.constEnd(); ++iterator)
+		{
+			settings.setValue(iterator.key(), iterator.value());
+		}
+	}
+
+	if (!pendingOverrides.isEmpty())
+	{
+		QSettings overrides(m_overridePath, QSettings::IniFormat);
+		QMap<QString, QVariant>::const_iterator iterator;
+
+		for (iterator = pendingOverrides.constBegin(); iterator != pendingOverrides.constEnd(); ++iterator)
+		{
+			if (iterator.value().isValid())
+			{
+				overrides.setValue(iterator.key(), iterator.value());
+			}
+			else
+			{
+				overrides.remove(iterator.key());
+			}
 		}
 	}
 }
 
 void SettingsManager::removeOverride(const QUrl &url, const QString &key)
 {
+	const QString host(getHost(url));
+	const bool isWildcarded(host.startsWith(QLatin1String("*.")));
+	const QStringList labels((isWildcarded ? host.mid(2) : host).split(QLatin1Char('.')));
+
+	m_lock.lockForWrite();
+
 	if (key.isEmpty())
 	{
-		QSettings(m_overridePath, QSettings::IniFormat).remove(getHost(url));
+		const QString prefix(host + QLatin1Char('/'));
+		QMap<QString, QVariant>::iterator iterator(m_pendingOverrides.lowerBound(prefix));
+
+		while (iterator != m_pendingOverrides.end() && iterator.key().startsWith(prefix))
+		{
+			iterator = m_pendingOverrides.erase(iterator);
+		}
+
+		removeOverrideValues(&m_overrides, labels, (labels.count() - 1), -1, isWildcarded);
+
+		m_pendingOverrides[host] = QVariant();
 	}
 	else
 	{
-		QSettings(m_overridePath, QSettings::IniFormat).remove(getHost(url) + QLatin1Char('/') + key);
+		const int identifier(getOptionIdentifier(key));
+
+		if (identifier >= 0)
+		{
+			removeOverrideValues(&m_overrides, labels, (labels.count() - 1), identifier, isWildcarded);
+		}
+
+		m_pendingOverrides[host + QLatin1Char('/') + key] = QVariant();
 	}
+
+	m_lock.unlock();
+
+	m_instance->scheduleSave();
 }
 
 void SettingsManager::registerOption(int identifier, SettingsManager::OptionType type, const QVariant &defaultValue, const QStringList &choices)
@@ -269,11 +421,21 @@ void SettingsManager::registerOption(int identifier, SettingsManager::OptionType
 	definition.flags = (IsEnabledFlag | IsVisibleFlag | IsBuiltInFlag);
 	definition.identifier = identifier;
 
+	QString name(m_instance->metaObject()->enumerator(m_optionIdentifierEnumerator).valueToKey(identifier));
+	name.chop(6);
+	name.replace(QLatin1Char('_'), QLatin1Char('/'));
+
+	QWriteLocker locker(&m_lock);
+
 	m_definitions.append(definition);
+	m_names.append(name);
+	m_values.append(QVariant());
 }
 
 void SettingsManager::updateOptionDefinition(int identifier, const SettingsManager::OptionDefinition &definition)
 {
+	QWriteLocker locker(&m_lock);
+
 	if (identifier >= 0 && identifier < m_definitions.count())
 	{
 		m_definitions[identifier].defaultValue = definition.defaultValue;
@@ -283,26 +445,39 @@ void SettingsManager::updateOptionDefinition(int identifier, const SettingsManag
 
 void SettingsManager::setOption(int identifier, const QVariant &value, const QUrl &url)
 {
+	if (identifier < 0 || identifier >= m_definitions.count())
+	{
+		return;
+	}
+
 	const QString name(getOptionName(identifier));
 
 	if (!url.isEmpty())
 	{
-		const QString overrideName(getHost(url) + QLatin1Char('/') + name);
+		const QString host(getHost(url));
+
+		m_lock.lockForWrite();
 
 		if (value.isNull())
 		{
-			QSettings(m_overridePath, QSettings::IniFormat).remove(overrideName);
+			const bool isWildcarded(host.startsWith(QLatin1String("*.")));
+			const QStringList labels((isWildcarded ? host.mid(2) : host).split(QLatin1Char('.')));
+
+			removeOverrideValues(&m_overrides, labels, (labels.count() - 1), identifier, isWildcarded);
+
+			m_pendingOverrides[host + QLatin1Char('/') + name] = QVariant();
 		}
 		else
 		{
-			QSettings(m_overridePath, QSettings::IniFormat).setValue(overrideName, value);
-		}
+			getOverrideValues(host)[identifier] = normalizeValue(identifier, value);
 
-		if (!m_hasWildcardedOverrides && overrideName.startsWith(QLatin1Char('*')))
-		{
-			m_hasWildcardedOverrides = true;
+			m_pendingOverrides[host + QLatin1Char('/') + name] = value;
 		}
 
+		m_lock.unlock();
+
+		m_instance->scheduleSave();
+
 		emit m_instance->optionChanged(identifier, value, url);
 
 		return;
@@ -310,7 +485,14 @@ void SettingsManager::setOption(int identifier, const QVariant &value, const QUr
 
 	if (getOption(identifier) != value)
 	{
-		QSettings(m_globalPath, QSettings::IniFormat).setValue(name, value);
+		m_lock.lockForWrite();
+
+		m_values[identifier] = normalizeValue(identifier, value);
+		m_pendingValues[name] = value;
+
+		m_lock.unlock();
+
+		m_instance->scheduleSave();
 
 		emit m_instance->optionChanged(identifier, value);
 	}
@@ -368,29 +550,20 @@ QString SettingsManager::createReport()
 	stream.setFieldAlignment(QTextStream::AlignLeft);
 	stream << QLatin1String("Settings:\n");
 
-	QHash<QString, int> overridenValues;
-	QSettings overrides(m_overridePath, QSettings::IniFormat);
-	const QStringList overridesGroups(overrides.childGroups());
+	QHash<int, int> overrides;
 
-	for (int i = 0; i < overridesGroups.count(); ++i)
-	{
-		overrides.beginGroup(overridesGroups.at(i));
+	m_lock.lockForRead();
 
-		const QStringList keys(overrides.allKeys());
+	countOverrides(&m_overrides, overrides);
 
-		for (int j = 0; j < keys.count(); ++j)
-		{
-			if (overridenValues.contains(keys.at(j)))
-			{
-				++overridenValues[keys.at(j)];
-			}
-			else
-			{
-				overridenValues[keys.at(j)] = 1;
-			}
-		}
+	m_lock.unlock();
 
-		overrides.endGroup();
+	QHash<QString, int> overridenValues;
+	QHash<int, int>::const_iterator iterator;
+
+	for (iterator = overrides.constBegin(); iterator != overrides.constEnd(); ++iterator)
+	{
+		overridenValues[getOptionName(iterator.key())] = iterator.value();
 	}
 
 	QStringList options;
@@ -443,16 +616,9 @@ QString SettingsManager::getOverridePath()
 
 QString SettingsManager::getOptionName(int identifier)
 {
-	QString name(m_instance->metaObject()->enumerator(m_optionIdentifierEnumerator).valueToKey(identifier));
-
-	if (!name.isEmpty())
-	{
-		name.chop(6);
-
-		return name.replace(QLatin1Char('_'), QLatin1Char('/'));
-	}
+	QReadLocker locker(&m_lock);
 
-	return m_customOptions.key(identifier);
+	return ((identifier >= 0 && identifier < m_names.count()) ? m_names.at(identifier) : QString());
 }
 
 QString SettingsManager::getHost(const QUrl &url)
@@ -460,40 +626,81 @@ QString SettingsManager::getHost(const QUrl &url)
 	return (url.isLocalFile() ? QLatin1String("localhost") : url.host());
 }
 
+QVariant SettingsManager::normalizeValue(int identifier, const QVariant &value)
+{
+	if (!value.isValid())
+	{
+		return value;
+	}
+
+	switch (m_definitions.at(identifier).type)
+	{
+		case BooleanType:
+			return value.toBool();
+		case IntegerType:
+			return value.toInt();
+		case ListType:
+			return value.toStringList();
+		default:
+			break;
+	}
+
+	return value;
+}
+
 QVariant SettingsManager::getOption(int identifier, const QUrl &url)
 {
+	QReadLocker locker(&m_lock);
+
 	if (identifier < 0 || identifier >= m_definitions.count())
 	{
 		return QVariant();
 	}
 
-	const QString name(getOptionName(identifier));
-
-	if (url.isEmpty())
+	if (!url.isEmpty() && !m_overrides.children.isEmpty())
 	{
-		return QSettings(m_globalPath, QSettings::IniFormat).value(name, m_definitions.at(identifier).defaultValue);
-	}
+		const QString host(getHost(url));
+		const OverrideNode *node(&m_overrides);
+		const QVariant *wildcardedValue(nullptr);
+		int end(host.length());
 
-	const QString host(getHost(url));
-	const QString overrideName(host + QLatin1Char('/') + name);
-	const QSettings overrides(m_overridePath, QSettings::IniFormat);
+		while (node && end > 0)
+		{
+			const int start(host.lastIndexOf(QLatin1Char('.'), (end - 1)) + 1);
 
-	if (m_hasWildcardedOverrides && !overrides.contains(overrideName))
-	{
-		const QStringList hostParts(host.split(QLatin1Char('.')));
+			node = node->children.value(host.mid(start, (end - start)));
+			end = (start - 1);
+
+			if (node && end > 0)
+			{
+				const QHash<int, QVariant>::const_iterator iterator(node->wildcardedValues.constFind(identifier));
 
-		for (int i = 1; i < hostParts.count(); ++i)
+				if (iterator != node->wildcardedValues.constEnd())
+				{
+					wildcardedValue = &iterator.value();
+				}
+			}
+		}
+
+		if (node && node != &m_overrides)
 		{
-			const QString wildcardedName(QLatin1String("*.") + QStringList(hostParts.mid(i)).join(QLatin1Char('.')) + QLatin1Char('/') + name);
+			const QHash<int, QVariant>::const_iterator iterator(node->values.constFind(identifier));
 
-			if (overrides.contains(wildcardedName))
+			if (iterator != node->values.constEnd())
 			{
-				return QSettings(m_overridePath, QSettings::IniFormat).value(wildcardedName, getOption(identifier));
+				return iterator.value();
 			}
 		}
+
+		if (wildcardedValue)
+		{
+			return *wildcardedValue;
+		}
 	}
 
-	return QSettings(m_overridePath, QSettings::IniFormat).value(overrideName, getOption(identifier));
+	const QVariant &value(m_values.at(identifier));
+
+	return (value.isValid() ? value : m_definitions.at(identifier).defaultValue);
 }
 
 QStringList SettingsManager::getOptions()
@@ -512,6 +719,8 @@ QStringList SettingsManager::getOptions()
 
 SettingsManager::OptionDefinition SettingsManager::getOptionDefinition(int identifier)
 {
+	QReadLocker locker(&m_lock);
+
 	if (identifier >= 0 && identifier < m_definitions.count())
 	{
 		return m_definitions.at(identifier);
@@ -537,9 +746,15 @@ int SettingsManager::registerOption(const QString &name, OptionType type, const
 	definition.type = type;
 	definition.identifier = identifier;
 
+	const QVariant value(QSettings(m_globalPath, QSettings::IniFormat).value(name));
+
+	QWriteLocker locker(&m_lock);
+
 	m_customOptions[name] = identifier;
 
 	m_definitions.append(definition);
+	m_names.append(name);
+	m_values.append(normalizeValue(identifier, value));
 
 	return identifier;
 }
@@ -562,14 +777,133 @@ int SettingsManager::getOptionIdentifier(const QString &name)
 	return m_instance->metaObject()->enumerator(m_optionIdentifierEnumerator).keyToValue(mutableName.toLatin1());
 }
 
+QHash<int, QVariant>& SettingsManager::getOverrideValues(const QString &host)
+{
+	const bool isWildcarded(host.startsWith(QLatin1String("*.")));
+	const QStringList labels((isWildcarded ? host.mid(2) : host).split(QLatin1Char('.')));
+	OverrideNode *node(&m_overrides);
+
+	for (int i = (labels.count() - 1); i >= 0; --i)
+	{
+		OverrideNode *&child(node->children[labels.at(i)]);
+
+		if (!child)
+		{
+			child = new OverrideNode();
+		}
+
+		node = child;
+	}
+
+	return (isWildcarded ? node->wildcardedValues : node->values);
+}
+
+const SettingsManager::OverrideNode* SettingsManager::getOverrideNode(const QString &host)
+{
+	const QStringList labels(host.split(QLatin1Char('.')));
+	const OverrideNode *node(&m_overrides);
+
+	for (int i = (labels.count() - 1); i >= 0; --i)
+	{
+		node = node->children.value(labels.at(i));
+
+		if (!node)
+		{
+			return nullptr;
+		}
+	}
+
+	return node;
+}
+
+void SettingsManager::removeOverrideValues(OverrideNode *node, const QStringList &labels, int index, int identifier, bool isWildcarded)
+{
+	if (index < 0)
+	{
+		QHash<int, QVariant> &values(isWildcarded ? node->wildcardedValues : node->values);
+
+		if (identifier < 0)
+		{
+			values.clear();
+		}
+		else
+		{
+			values.remove(identifier);
+		}
+
+		return;
+	}
+
+	OverrideNode *child(node->children.value(labels.at(index)));
+
+	if (!child)
+	{
+		return;
+	}
+
+	removeOverrideValues(child, labels, (index - 1), identifier, isWildcarded);
+
+	if (child->children.isEmpty() && child->values.isEmpty() && child->wildcardedValues.isEmpty())
+	{
+		node->children.remove(labels.at(index));
+
+		delete child;
+	}
+}
+
+void SettingsManager::clearOverrideNode(OverrideNode *node)
+{
+	QHash<QString, OverrideNode*>::iterator iterator;
+
+	for (iterator = node->children.begin(); iterator != node->children.end(); ++iterator)
+	{
+		clearOverrideNode(iterator.value());
+
+		delete iterator.value();
+	}
+
+	node->children.clear();
+	node->values.clear();
+	node->wildcardedValues.clear();
+}
+
+void SettingsManager::countOverrides(const OverrideNode *node, QHash<int, int> &overrides)
+{
+	const QVector<QHash<int, QVariant> > valuesLists({node->values, node->wildcardedValues});
+
+	for (int i = 0; i < valuesLists.count(); ++i)
+	{
+		QHash<int, QVariant>::const_iterator iterator;
+
+		for (iterator = valuesLists.at(i).constBegin(); iterator != valuesLists.at(i).constEnd(); ++iterator)
+		{
+			++overrides[iterator.key()];
+		}
+	}
+
+	QHash<QString, OverrideNode*>::const_iterator iterator;
+
+	for (iterator = node->children.constBegin(); iterator != node->children.constEnd(); ++iterator)
+	{
+		countOverrides(iterator.value(), overrides);
+	}
+}
+
 bool SettingsManager::hasOverride(const QUrl &url, int identifier)
 {
-	if (identifier < 0)
+	QReadLocker locker(&m_lock);
+	const QString host(getHost(url));
+	const bool isWildcarded(host.startsWith(QLatin1String("*.")));
+	const OverrideNode *node(host.isEmpty() ? nullptr : getOverrideNode(isWildcarded ? host.mid(2) : host));
+
+	if (!node)
 	{
-		return QSettings(m_overridePath, QSettings::IniFormat).childGroups().contains(getHost(url));
+		return false;
 	}
 
-	return QSettings(m_overridePath, QSettings::IniFormat).contains(getHost(url) + QLatin1Char('/') + getOptionName(identifier));
+	const QHash<int, QVariant> &values(isWildcarded ? node->wildcardedValues : node->values);
+
+	return (!values.isEmpty() && (identifier < 0 || values.contains(identifier)));
 }
 
 }
@@ -22,7 +22,9 @@
 #ifndef OTTER_SETTINGSMANAGER_H
 #define OTTER_SETTINGSMANAGER_H
 
+#include <QtCore/QMap>
 #include <QtCore/QObject>
+#include <QtCore/QReadWriteLock>
 #include <QtCore/QUrl>
 #include <QtCore/QVariant>
 #include <QtGui/QIcon>
@@ -137,14 +139,18 @@ public:
 		Interface_UseSystemIconThemeOption,
 		Interface_WidgetStyleOption,
 		Network_AcceptLanguageOption,
+		Network_ActiveTransfersLimitOption,
 		Network_CookiesKeepModeOption,
 		Network_CookiesPolicyOption,
 		Network_DoNotTrackPolicyOption,
 		Network_EnableReferrerOption,
+		Network_PrioritizePageLoadsOption,
 		Network_ProxyOption,
 		Network_ThirdPartyCookiesAcceptedHostsOption,
 		Network_ThirdPartyCookiesPolicyOption,
 		Network_ThirdPartyCookiesRejectedHostsOption,
+		Network_TransferSegmentsAmountOption,
+		Network_TransferSpeedLimitOption,
 		Network_UserAgentOption,
 		Network_WorkOfflineOption,
 		Paths_DownloadsOption,
@@ -291,6 +297,7 @@ public:
 	};
 
 	static void createInstance(const QString &path);
+	static void loadOptions();
 	static void removeOverride(const QUrl &url, const QString &key = {});
 	static void updateOptionDefinition(int identifier, const OptionDefinition &definition);
 	static void setOption(int identifier, const QVariant &value, const QUrl &url = {});
@@ -308,20 +315,44 @@ public:
 	static bool hasOverride(const QUrl &url, int identifier = -1);
 
 protected:
+	struct OverrideNode
+	{
+		QHash<QString, OverrideNode*> children;
+		QHash<int, QVariant> values;
+		QHash<int, QVariant> wildcardedValues;
+	};
+
 	explicit SettingsManager(QObject *parent);
+	~SettingsManager();
 
+	void timerEvent(QTimerEvent *event) override;
+	void scheduleSave();
 	static QString getHost(const QUrl &url);
+	static QVariant normalizeValue(int identifier, const QVariant &value);
+	static QHash<int, QVariant>& getOverrideValues(const QString &host);
+	static const OverrideNode* getOverrideNode(const QString &host);
 	static void registerOption(int identifier, OptionType type, const QVariant &defaultValue = {}, const QStringList &choices = {});
+	static void removeOverrideValues(OverrideNode *node, const QStringList &labels, int index, int identifier, bool isWildcarded);
+	static void clearOverrideNode(OverrideNode *node);
+	static void countOverrides(const OverrideNode *node, QHash<int, int> &overrides);
+	static void saveOptions();
 
 private:
+	int m_saveTimer;
+
 	static SettingsManager *m_instance;
 	static QString m_globalPath;
 	static QString m_overridePath;
 	static QVector<OptionDefinition> m_definitions;
+	static QVector<QString> m_names;
+	static QVector<QVariant> m_values;
+	static OverrideNode m_overrides;
 	static QHash<QString, int> m_customOptions;
+	static QMap<QString, QVariant> m_pendingValues;
+	static QMap<QString, QVariant> m_pendingOverrides;
+	static QReadWriteLock m_lock;
 	static int m_identifierCounter;
 	static int m_optionIdentifierEnumerator;
-	static bool m_hasWildcardedOverrides;
 
 signals:
 	void optionChanged(int identifier, const QVariant &value);
@@ -0,0 +1,87 @@
+/**************************************************************************
+* Otter Browser: Web browser controlled by the user, not vice-versa.
+* Copyright (C) 2017 Michal Dutkiewicz aka Emdek <michal@emdek.pl>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+**************************************************************************/
+
+#include "TokenBucket.h"
+
+namespace Otter
+{
+
+TokenBucket::TokenBucket(qint64 rate) :
+	m_rate(0),
+	m_tokens(0)
+{
+	setRate(rate);
+}
+
+void TokenBucket::setRate(qint64 rate)
+{
+	if (rate == m_rate)
+	{
+		return;
+	}
+
+	m_rate = qMax(rate, qint64(0));
+	m_tokens = qMin(m_tokens, getCapacity());
+
+	m_timer.start();
+}
+
+void TokenBucket::consume(qint64 amount)
+{
+	if (m_rate > 0 && amount > 0)
+	{
+		m_tokens -= amount;
+	}
+}
+
+void TokenBucket::refill()
+{
+	const qint64 tokens((m_timer.elapsed() * m_rate) / 1000);
+
+	if (tokens > 0)
+	{
+		m_tokens = qMin((m_tokens + tokens), getCapacity());
+
+		m_timer.restart();
+	}
+}
+
+qint64 TokenBucket::getRate() const
+{
+	return m_rate;
+}
+
+qint64 TokenBucket::getCapacity() const
+{
+	return qMax((m_rate / 4), qint64(4096));
+}
+
+qint64 TokenBucket::getAvailable()
+{
+	if (m_rate <= 0)
+	{
+		return -1;
+	}
+
+	refill();
+
+	return qMax(m_tokens, qint64(0));
+}
+
+}
@@ -0,0 +1,50 @@
+/**************************************************************************
+* Otter Browser: Web browser controlled by the user, not vice-versa.
+* Copyright (C) 2017 Michal Dutkiewicz aka Emdek <michal@emdek.pl>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+**************************************************************************/
+
+#ifndef OTTER_TOKENBUCKET_H
+#define OTTER_TOKENBUCKET_H
+
+#include <QtCore/QElapsedTimer>
+
+namespace Otter
+{
+
+class TokenBucket final
+{
+public:
+	explicit TokenBucket(qint64 rate = 0);
+
+	void setRate(qint64 rate);
+	void consume(qint64 amount);
+	qint64 getRate() const;
+	qint64 getAvailable();
+
+protected:
+	void refill();
+	qint64 getCapacity() const;
+
+private:
+	QElapsedTimer m_timer;
+	qint64 m_rate;
+	qint64 m_tokens;
+};
+
+}
+
+#endif
@@ -0,0 +1,366 @@
+/**************************************************************************
+* Otter Browser: Web browser controlled by the user, not vice-versa.
+* Copyright (C) 2017 Michal Dutkiewicz aka Emdek <michal@emdek.pl>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+**************************************************************************/
+
+#include "TransferWriter.h"
+
+#include <QtConcurrent/QtConcurrentRun>
+#include <QtCore/QFile>
+
+#if defined(Q_OS_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace Otter
+{
+
+const int TransferWriter::m_bufferSize(1048576);
+const int TransferWriter::m_maximumBuffersAmount(8);
+
+TransferWriter::TransferWriter(const QString &path, QObject *parent) : QObject(parent),
+	m_writeWatcher(nullptr),
+	m_path(path),
+	m_buffersAmount(0),
+	m_isFinishing(false),
+	m_isClosed(false),
+	m_hasError(false)
+{
+}
+
+void TransferWriter::finish()
+{
+	m_isFinishing = true;
+
+	scheduleWrite();
+}
+
+void TransferWriter::cancel()
+{
+	waitForWrite();
+
+	m_chunks.clear();
+	m_openChunks.clear();
+	m_isFinishing = true;
+	m_isClosed = true;
+}
+
+void TransferWriter::scheduleWrite()
+{
+	if (m_writeWatcher || m_isClosed)
+	{
+		return;
+	}
+
+	if (m_isFinishing)
+	{
+		sealChunks();
+	}
+	else if (m_chunks.isEmpty())
+	{
+		return;
+	}
+
+	m_writingChunks = m_chunks;
+	m_isClosed = m_isFinishing;
+	m_writeWatcher = new QFutureWatcher<bool>(this);
+
+	m_chunks.clear();
+
+	connect(m_writeWatcher, SIGNAL(finished()), this, SLOT(handleWriteFinished()));
+
+	m_writeWatcher->setFuture(QtConcurrent::run(&TransferWriter::writeChunks, m_path, m_writingChunks, m_isFinishing));
+}
+
+void TransferWriter::waitForWrite()
+{
+	if (!m_writeWatcher)
+	{
+		return;
+	}
+
+	m_writeWatcher->disconnect(this);
+	m_writeWatcher->waitForFinished();
+
+	if (!m_writeWatcher->result())
+	{
+		m_hasError = true;
+	}
+
+	m_writeWatcher->deleteLater();
+	m_writeWatcher = nullptr;
+
+	recycleChunks();
+}
+
+void TransferWriter::sealChunks()
+{
+	for (int i = 0; i < m_openChunks.count(); ++i)
+	{
+		if (!m_openChunks.at(i).data.isEmpty())
+		{
+			m_chunks.append(m_openChunks.at(i));
+		}
+		else if (m_openChunks.at(i).data.capacity() > 0)
+		{
+			m_buffers.append(m_openChunks.at(i).data);
+		}
+	}
+
+	m_openChunks.clear();
+}
+
+void TransferWriter::recycleChunks()
+{
+	QVector<Chunk> chunks;
+	chunks.swap(m_writingChunks);
+
+	for (int i = 0; i < chunks.count(); ++i)
+	{
+		if (m_buffersAmount > m_maximumBuffersAmount)
+		{
+			--m_buffersAmount;
+
+			continue;
+		}
+
+		QByteArray buffer(chunks.at(i).data);
+
+		chunks[i].data = QByteArray();
+
+		buffer.resize(0);
+		buffer.reserve(m_bufferSize);
+
+		m_buffers.append(buffer);
+	}
+}
+
+void TransferWriter::handleWriteFinished()
+{
+	if (!m_writeWatcher)
+	{
+		return;
+	}
+
+	if (!m_writeWatcher->result())
+	{
+		m_hasError = true;
+	}
+
+	m_writeWatcher->deleteLater();
+	m_writeWatcher = nullptr;
+
+	recycleChunks();
+
+	if (m_isClosed)
+	{
+		emit finished(!m_hasError);
+
+		return;
+	}
+
+	if (!m_isFinishing)
+	{
+		emit dataWritten();
+	}
+
+	scheduleWrite();
+}
+
+qint64 TransferWriter::write(QIODevice *device, qint64 offset, qint64 limit, bool isForced)
+{
+	if (!device || m_isFinishing || m_hasError)
+	{
+		return 0;
+	}
+
+	qint64 bytesWritten(0);
+
+	while ((limit < 0 || bytesWritten < limit) && device->bytesAvailable() > 0)
+	{
+		const qint64 position(offset + bytesWritten);
+		int index(-1);
+
+		for (int i = 0; i < m_openChunks.count(); ++i)
+		{
+			if ((m_openChunks.at(i).offset + m_openChunks.at(i).data.size()) == position)
+			{
+				index = i;
+
+				break;
+			}
+		}
+
+		if (index < 0)
+		{
+			Chunk openChunk;
+			openChunk.offset = position;
+
+			if (!takeBuffer(&openChunk.data, isForced))
+			{
+				if (m_chunks.isEmpty() && !m_writeWatcher)
+				{
+					sealChunks();
+				}
+
+				break;
+			}
+
+			m_openChunks.append(openChunk);
+
+			index = (m_openChunks.count() - 1);
+		}
+
+		Chunk &chunk(m_openChunks[index]);
+		const int size(chunk.data.size());
+		qint64 length(qMin((m_bufferSize - ((chunk.offset + size) % m_bufferSize)), device->bytesAvailable()));
+
+		if (limit >= 0)
+		{
+			length = qMin(length, (limit - bytesWritten));
+		}
+
+		chunk.data.resize(size + static_cast<int>(length));
+
+		const qint64 bytesRead(device->read((chunk.data.data() + size), length));
+
+		chunk.data.resize(size + static_cast<int>(qMax(bytesRead, qint64(0))));
+
+		if (bytesRead <= 0)
+		{
+			if (chunk.data.isEmpty())
+			{
+				m_buffers.append(m_openChunks.takeAt(index).data);
+			}
+
+			break;
+		}
+
+		bytesWritten += bytesRead;
+
+		if (((chunk.offset + chunk.data.size()) % m_bufferSize) == 0)
+		{
+			m_chunks.append(m_openChunks.takeAt(index));
+		}
+	}
+
+	scheduleWrite();
+
+	return bytesWritten;
+}
+
+bool TransferWriter::writeChunks(const QString &path, const QVector<Chunk> &chunks, bool isSynchronizing)
+{
+	QFile file(path);
+
+	if (!file.open(QIODevice::ReadWrite | QIODevice::Unbuffered))
+	{
+		return false;
+	}
+
+	for (int i = 0; i < chunks.count(); ++i)
+	{
+		if (!file.seek(chunks.at(i).offset) || file.write(chunks.at(i).data) != chunks.at(i).data.size())
+		{
+			return false;
+		}
+	}
+
+	if (!isSynchronizing)
+	{
+		return true;
+	}
+
+#if defined(Q_OS_WIN32)
+	return (_commit(file.handle()) == 0);
+#else
+	return (fsync(file.handle()) == 0);
+#endif
+}
+
+qint64 TransferWriter::getPendingBytes(qint64 start, qint64 end) const
+{
+	const QVector<const QVector<Chunk>*> chunks({&m_openChunks, &m_chunks, &m_writingChunks});
+	qint64 bytes(0);
+
+	for (int i = 0; i < chunks.count(); ++i)
+	{
+		for (int j = 0; j < chunks.at(i)->count(); ++j)
+		{
+			const Chunk &chunk(chunks.at(i)->at(j));
+
+			if (chunk.offset >= start && (end < 0 || chunk.offset < end))
+			{
+				bytes += chunk.data.size();
+			}
+		}
+	}
+
+	return bytes;
+}
+
+bool TransferWriter::flush()
+{
+	waitForWrite();
+	sealChunks();
+
+	if (!m_chunks.isEmpty())
+	{
+		if (!writeChunks(m_path, m_chunks, false))
+		{
+			m_hasError = true;
+		}
+
+		m_writingChunks = m_chunks;
+
+		m_chunks.clear();
+
+		recycleChunks();
+	}
+
+	return !m_hasError;
+}
+
+bool TransferWriter::takeBuffer(QByteArray *buffer, bool isForced)
+{
+	if (!m_buffers.isEmpty())
+	{
+		*buffer = m_buffers.takeLast();
+
+		return true;
+	}
+
+	if (!isForced && m_buffersAmount >= m_maximumBuffersAmount)
+	{
+		return false;
+	}
+
+	buffer->reserve(m_bufferSize);
+
+	++m_buffersAmount;
+
+	return true;
+}
+
+bool TransferWriter::hasError() const
+{
+	return m_hasError;
+}
+
+}
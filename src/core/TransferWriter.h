@@ -0,0 +1,83 @@
+/**************************************************************************
+* Otter Browser: Web browser controlled by the user, not vice-versa.
+* Copyright (C) 2017 Michal Dutkiewicz aka Emdek <michal@emdek.pl>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+**************************************************************************/
+
+#ifndef OTTER_TRANSFERWRITER_H
+#define OTTER_TRANSFERWRITER_H
+
+#include <QtCore/QFutureWatcher>
+#include <QtCore/QIODevice>
+#include <QtCore/QVector>
+
+namespace Otter
+{
+
+class TransferWriter final : public QObject
+{
+	Q_OBJECT
+
+public:
+	explicit TransferWriter(const QString &path, QObject *parent = nullptr);
+
+	void finish();
+	void cancel();
+	qint64 write(QIODevice *device, qint64 offset, qint64 limit = -1, bool isForced = false);
+	qint64 getPendingBytes(qint64 start = 0, qint64 end = -1) const;
+	bool flush();
+	bool hasError() const;
+
+protected:
+	struct Chunk
+	{
+		QByteArray data;
+		qint64 offset = 0;
+	};
+
+	void scheduleWrite();
+	void waitForWrite();
+	void sealChunks();
+	void recycleChunks();
+	static bool writeChunks(const QString &path, const QVector<Chunk> &chunks, bool isSynchronizing);
+	bool takeBuffer(QByteArray *buffer, bool isForced);
+
+protected slots:
+	void handleWriteFinished();
+
+private:
+	QFutureWatcher<bool> *m_writeWatcher;
+	QString m_path;
+	QVector<Chunk> m_chunks;
+	QVector<Chunk> m_openChunks;
+	QVector<Chunk> m_writingChunks;
+	QVector<QByteArray> m_buffers;
+	int m_buffersAmount;
+	bool m_isFinishing;
+	bool m_isClosed;
+	bool m_hasError;
+
+	static const int m_bufferSize;
+	static const int m_maximumBuffersAmount;
+
+signals:
+	void dataWritten();
+	void finished(bool isSuccess);
+};
+
+}
+
+#endif
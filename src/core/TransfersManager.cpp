@@ -23,8 +23,10 @@
 #include "NetworkManagerFactory.h"
 #include "NotificationsManager.h"
 #include "SessionsManager.h"
+#include "TransferWriter.h"
 #include "Utils.h"
 #include "../ui/MainWindow.h"
+#include "../ui/Window.h"
 
 #include <QtCore/QDir>
 #include <QtCore/QMimeDatabase>
@@ -41,20 +43,30 @@ namespace Otter
 TransfersManager* TransfersManager::m_instance(nullptr);
 QVector<Transfer*> TransfersManager::m_transfers;
 QVector<Transfer*> TransfersManager::m_privateTransfers;
+QVector<Transfer*> TransfersManager::m_queuedTransfers;
+TokenBucket TransfersManager::m_bandwidth;
 bool TransfersManager::m_isInitilized(false);
+const qint64 TransfersManager::m_backgroundSpeedLimit(131072);
+const qint64 Transfer::m_minimumSegmentSize(1048576);
+const qint64 Transfer::m_readBufferSize(1048576);
+const int Transfer::m_segmentRetriesLimit(5);
 
 Transfer::Transfer(TransferOptions options, QObject *parent) : QObject(parent ? parent : TransfersManager::getInstance()),
 	m_reply(nullptr),
 	m_device(nullptr),
+	m_writer(nullptr),
 	m_speed(0),
 	m_bytesStart(0),
 	m_bytesReceivedDifference(0),
 	m_bytesReceived(0),
 	m_bytesTotal(0),
+	m_bytesWritten(0),
 	m_options(options),
 	m_state(UnknownState),
 	m_updateTimer(0),
 	m_updateInterval(0),
+	m_throttleTimer(0),
+	m_canSegment(false),
 	m_isSelectingPath(false)
 {
 }
@@ -62,6 +74,7 @@ Transfer::Transfer(TransferOptions options, QObject *parent) : QObject(parent ?
 Transfer::Transfer(const QSettings &settings, QObject *parent) : QObject(parent ? parent : TransfersManager::getInstance()),
 	m_reply(nullptr),
 	m_device(nullptr),
+	m_writer(nullptr),
 	m_source(settings.value(QLatin1String("source")).toUrl()),
 	m_target(settings.value(QLatin1String("target")).toString()),
 	m_timeStarted(settings.value(QLatin1String("timeStarted")).toDateTime()),
@@ -72,17 +85,49 @@ Transfer::Transfer(const QSettings &settings, QObject *parent) : QObject(parent
 	m_bytesReceivedDifference(0),
 	m_bytesReceived(settings.value(QLatin1String("bytesReceived")).toLongLong()),
 	m_bytesTotal(settings.value(QLatin1String("bytesTotal")).toLongLong()),
+	m_bytesWritten(0),
 	m_options(NoOption),
 	m_state((m_bytesReceived > 0 && m_bytesTotal == m_bytesReceived && QFile::exists(settings.value(QLatin1String("target")).toString())) ? FinishedState : ErrorState),
 	m_updateTimer(0),
 	m_updateInterval(0),
+	m_throttleTimer(0),
+	m_canSegment(false),
 	m_isSelectingPath(false)
 {
+	m_bandwidth.setRate(settings.value(QLatin1String("speedLimit")).toLongLong());
+
+	if (m_state == FinishedState)
+	{
+		return;
+	}
+
+	if (settings.value(QLatin1String("isQueued")).toBool())
+	{
+		m_state = QueuedState;
+	}
+
+	const QStringList segments(settings.value(QLatin1String("segments")).toStringList());
+
+	for (int i = 0; i < segments.count(); ++i)
+	{
+		const QStringList values(segments.at(i).split(QLatin1Char(',')));
+
+		if (values.count() == 3)
+		{
+			TransferSegment segment;
+			segment.start = values.at(0).toLongLong();
+			segment.end = values.at(1).toLongLong();
+			segment.bytesReceived = values.at(2).toLongLong();
+
+			m_segments.append(segment);
+		}
+	}
 }
 
 Transfer::Transfer(const QUrl &source, const QString &target, TransferOptions options, QObject *parent) : QObject(parent ? parent : TransfersManager::getInstance()),
 	m_reply(nullptr),
 	m_device(nullptr),
+	m_writer(nullptr),
 	m_source(source),
 	m_target(target),
 	m_speed(0),
@@ -90,10 +135,13 @@ Transfer::Transfer(const QUrl &source, const QString &target, TransferOptions op
 	m_bytesReceivedDifference(0),
 	m_bytesReceived(0),
 	m_bytesTotal(0),
+	m_bytesWritten(0),
 	m_options(options),
 	m_state(UnknownState),
 	m_updateTimer(0),
 	m_updateInterval(0),
+	m_throttleTimer(0),
+	m_canSegment(false),
 	m_isSelectingPath(false)
 {
 	QNetworkRequest request;
@@ -107,6 +155,7 @@ Transfer::Transfer(const QUrl &source, const QString &target, TransferOptions op
 Transfer::Transfer(const QNetworkRequest &request, const QString &target, TransferOptions options, QObject *parent) : QObject(parent ? parent : TransfersManager::getInstance()),
 	m_reply(nullptr),
 	m_device(nullptr),
+	m_writer(nullptr),
 	m_source(request.url()),
 	m_target(target),
 	m_speed(0),
@@ -114,10 +163,13 @@ Transfer::Transfer(const QNetworkRequest &request, const QString &target, Transf
 	m_bytesReceivedDifference(0),
 	m_bytesReceived(0),
 	m_bytesTotal(0),
+	m_bytesWritten(0),
 	m_options(options),
 	m_state(UnknownState),
 	m_updateTimer(0),
 	m_updateInterval(0),
+	m_throttleTimer(0),
+	m_canSegment(false),
 	m_isSelectingPath(false)
 {
 	start(NetworkManagerFactory::getNetworkManager()->get(request), target);
@@ -125,6 +177,7 @@ Transfer::Transfer(const QNetworkRequest &request, const QString &target, Transf
 
 Transfer::Transfer(QNetworkReply *reply, const QString &target, TransferOptions options, QObject *parent) : QObject(parent ? parent : TransfersManager::getInstance()),
 	m_reply(reply),
+	m_writer(nullptr),
 	m_source((m_reply->url().isValid() ? m_reply->url() : m_reply->request().url()).adjusted(QUrl::RemovePassword | QUrl::PreferLocalFile)),
 	m_target(target),
 	m_speed(0),
@@ -132,10 +185,13 @@ Transfer::Transfer(QNetworkReply *reply, const QString &target, TransferOptions
 	m_bytesReceivedDifference(0),
 	m_bytesReceived(0),
 	m_bytesTotal(0),
+	m_bytesWritten(0),
 	m_options(options),
 	m_state(UnknownState),
 	m_updateTimer(0),
 	m_updateInterval(0),
+	m_throttleTimer(0),
+	m_canSegment(false),
 	m_isSelectingPath(false)
 {
 	start(reply, target);
@@ -163,6 +219,14 @@ void Transfer::timerEvent(QTimerEvent *event)
 			emit changed();
 		}
 	}
+	else if (event->timerId() == m_throttleTimer)
+	{
+		killTimer(m_throttleTimer);
+
+		m_throttleTimer = 0;
+
+		readData();
+	}
 }
 
 void Transfer::start(QNetworkReply *reply, const QString &target)
@@ -234,6 +298,7 @@ void Transfer::start(QNetworkReply *reply, const QString &target)
 
 	m_target = m_device->fileName();
 	m_state = (m_reply->isFinished() ? FinishedState : RunningState);
+	m_canSegment = true;
 
 	downloadData();
 
@@ -375,16 +440,44 @@ void Transfer::downloadData()
 		if (m_reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).isValid() && m_reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 206)
 		{
 			m_device->reset();
+
+			m_bytesWritten = 0;
 		}
 	}
 
-	m_device->write(m_reply->readAll());
-	m_device->seek(m_device->size());
+	if (m_bytesStart > 0 && m_segments.isEmpty() && m_reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 200)
+	{
+		m_bytesStart = 0;
+		m_bytesWritten = 0;
+
+		m_device->resize(0);
+	}
+
+	if (m_device->inherits(QStringLiteral("QTemporaryFile").toLatin1()))
+	{
+		m_device->write(m_reply->readAll());
+		m_device->seek(m_device->size());
+	}
+	else
+	{
+		if (!m_writer)
+		{
+			createWriter();
+
+			m_reply->setReadBufferSize(m_readBufferSize);
+		}
 
-	if (m_state == RunningState && m_reply->attribute(QNetworkRequest::SourceIsFromCacheAttribute).toBool() && m_bytesTotal >= 0 && m_device->size() == m_bytesTotal)
+		m_bytesWritten += writeData(m_reply, m_bytesWritten);
+	}
+
+	if (m_state == RunningState && m_reply->attribute(QNetworkRequest::SourceIsFromCacheAttribute).toBool() && m_bytesTotal >= 0 && (m_writer ? m_bytesWritten : m_device->size()) == m_bytesTotal)
 	{
 		downloadFinished();
 	}
+	else if (m_canSegment && m_state == RunningState && !m_device->inherits(QStringLiteral("QTemporaryFile").toLatin1()))
+	{
+		startSegments();
+	}
 }
 
 void Transfer::downloadFinished()
@@ -393,6 +486,8 @@ void Transfer::downloadFinished()
 	{
 		if (m_device && !m_device->inherits(QStringLiteral("QTemporaryFile").toLatin1()))
 		{
+			closeWriter();
+
 			m_device->close();
 			m_device->deleteLater();
 			m_device = nullptr;
@@ -422,7 +517,11 @@ void Transfer::downloadFinished()
 		m_updateTimer = 0;
 	}
 
-	if (m_reply->size() > 0)
+	if (m_writer)
+	{
+		m_bytesWritten += m_writer->write(m_reply, m_bytesWritten, -1, true);
+	}
+	else if (m_reply->size() > 0)
 	{
 		m_device->write(m_reply->readAll());
 	}
@@ -431,7 +530,8 @@ void Transfer::downloadFinished()
 	disconnect(m_reply, SIGNAL(readyRead()), this, SLOT(downloadData()));
 	disconnect(m_reply, SIGNAL(finished()), this, SLOT(downloadFinished()));
 
-	m_bytesReceived = (m_device ? m_device->size() : -1);
+	m_canSegment = false;
+	m_bytesReceived = (m_writer ? m_bytesWritten : (m_device ? m_device->size() : -1));
 
 	if (m_bytesTotal <= 0 && m_bytesReceived > 0)
 	{
@@ -442,6 +542,12 @@ void Transfer::downloadFinished()
 	{
 		m_state = ErrorState;
 	}
+	else if (m_writer)
+	{
+		m_writer->finish();
+
+		return;
+	}
 	else
 	{
 		markFinished();
@@ -455,6 +561,8 @@ void Transfer::downloadFinished()
 
 	if (m_device && (m_options.testFlag(HasToOpenAfterFinishOption) || !m_device->inherits(QStringLiteral("QTemporaryFile").toLatin1())))
 	{
+		closeWriter();
+
 		m_device->close();
 		m_device->deleteLater();
 		m_device = nullptr;
@@ -490,6 +598,402 @@ void Transfer::downloadError(QNetworkReply::NetworkError error)
 	}
 }
 
+void Transfer::downloadSegmentData()
+{
+	writeSegment(qobject_cast<QNetworkReply*>(sender()));
+}
+
+void Transfer::downloadSegmentFinished()
+{
+	QNetworkReply *reply(qobject_cast<QNetworkReply*>(sender()));
+
+	writeSegment(reply, true);
+
+	const int index(getSegmentIndex(reply));
+
+	if (index < 0)
+	{
+		return;
+	}
+
+	const QNetworkReply::NetworkError error(reply->error());
+
+	reply->disconnect(this);
+
+	m_segments[index].reply = nullptr;
+
+	QTimer::singleShot(250, reply, SLOT(deleteLater()));
+
+	if (m_segments.at(index).retriesAmount < m_segmentRetriesLimit)
+	{
+		++m_segments[index].retriesAmount;
+
+		startSegment(index);
+
+		return;
+	}
+
+	downloadError((error == QNetworkReply::NoError) ? QNetworkReply::RemoteHostClosedError : error);
+}
+
+void Transfer::readData()
+{
+	if (m_writer && m_writer->hasError())
+	{
+		downloadError(QNetworkReply::UnknownContentError);
+
+		return;
+	}
+
+	if (m_segments.isEmpty())
+	{
+		downloadData();
+
+		return;
+	}
+
+	for (int i = 0; i < m_segments.count(); ++i)
+	{
+		QNetworkReply *reply(m_segments.at(i).reply);
+
+		if (reply)
+		{
+			writeSegment(reply);
+		}
+	}
+}
+
+void Transfer::handleWriterFinished(bool isSuccess)
+{
+	if (m_writer)
+	{
+		m_writer->deleteLater();
+		m_writer = nullptr;
+	}
+
+	if (isSuccess)
+	{
+		markFinished();
+
+		m_state = FinishedState;
+		m_mimeType = QMimeDatabase().mimeTypeForFile(m_target);
+	}
+	else
+	{
+		m_state = ErrorState;
+	}
+
+	emit finished();
+	emit changed();
+
+	if (m_device)
+	{
+		m_device->close();
+		m_device->deleteLater();
+		m_device = nullptr;
+	}
+
+	if (m_reply)
+	{
+		QTimer::singleShot(250, m_reply, SLOT(deleteLater()));
+	}
+
+	if (m_state == FinishedState && m_options.testFlag(HasToOpenAfterFinishOption))
+	{
+		openTarget();
+	}
+
+	if (m_options.testFlag(CanAutoDeleteOption) && !m_isSelectingPath)
+	{
+		deleteLater();
+	}
+}
+
+void Transfer::createWriter()
+{
+	m_device->flush();
+
+	m_bytesWritten = m_device->pos();
+	m_writer = new TransferWriter(m_target, this);
+
+	connect(m_writer, SIGNAL(dataWritten()), this, SLOT(readData()));
+	connect(m_writer, SIGNAL(finished(bool)), this, SLOT(handleWriterFinished(bool)));
+}
+
+void Transfer::closeWriter()
+{
+	if (!m_writer)
+	{
+		return;
+	}
+
+	m_writer->disconnect(this);
+	m_writer->flush();
+	m_writer->deleteLater();
+	m_writer = nullptr;
+}
+
+qint64 Transfer::writeData(QNetworkReply *reply, qint64 offset, qint64 limit)
+{
+	const qint64 bandwidth(getAvailableBandwidth());
+
+	if (bandwidth >= 0 && (limit < 0 || bandwidth < limit))
+	{
+		limit = bandwidth;
+	}
+
+	const qint64 length((limit == 0) ? 0 : m_writer->write(reply, offset, limit));
+
+	m_bandwidth.consume(length);
+
+	TransfersManager::consumeBandwidth(length);
+
+	if (m_throttleTimer == 0 && bandwidth >= 0 && length >= bandwidth && reply->bytesAvailable() > 0)
+	{
+		m_throttleTimer = startTimer(100);
+	}
+
+	return length;
+}
+
+qint64 Transfer::getAvailableBandwidth()
+{
+	const qint64 globalBandwidth(TransfersManager::getAvailableBandwidth());
+	const qint64 bandwidth(m_bandwidth.getAvailable());
+
+	if (bandwidth < 0)
+	{
+		return globalBandwidth;
+	}
+
+	if (globalBandwidth < 0)
+	{
+		return bandwidth;
+	}
+
+	return qMin(bandwidth, globalBandwidth);
+}
+
+bool Transfer::queue()
+{
+	if (m_state != RunningState || !m_reply || !m_device || m_options.testFlag(CanAutoDeleteOption) || m_options.testFlag(HasToOpenAfterFinishOption) || m_device->inherits(QStringLiteral("QTemporaryFile").toLatin1()))
+	{
+		return false;
+	}
+
+	stop();
+
+	m_state = QueuedState;
+
+	emit changed();
+
+	return true;
+}
+
+void Transfer::startSegments()
+{
+	m_canSegment = false;
+
+	const int amount(SettingsManager::getOption(SettingsManager::Network_TransferSegmentsAmountOption).toInt());
+	const qint64 bytesTotal(m_reply->header(QNetworkRequest::ContentLengthHeader).toLongLong());
+	const qint64 bytesWritten(m_bytesWritten);
+
+	if (amount < 2 || m_bytesStart > 0 || (bytesTotal - bytesWritten) < (amount * m_minimumSegmentSize) || m_reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 200 || m_reply->attribute(QNetworkRequest::SourceIsFromCacheAttribute).toBool() || m_reply->rawHeader(QStringLiteral("Accept-Ranges").toLatin1()).trimmed().toLower() != QByteArray("bytes") || !m_device->resize(bytesTotal))
+	{
+		return;
+	}
+
+	disconnect(m_reply, SIGNAL(downloadProgress(qint64,qint64)), this, SLOT(downloadProgress(qint64,qint64)));
+	disconnect(m_reply, SIGNAL(readyRead()), this, SLOT(downloadData()));
+	disconnect(m_reply, SIGNAL(finished()), this, SLOT(downloadFinished()));
+	disconnect(m_reply, SIGNAL(error(QNetworkReply::NetworkError)), this, SLOT(downloadError(QNetworkReply::NetworkError)));
+
+	const qint64 segmentSize((bytesTotal - bytesWritten) / amount);
+
+	m_bytesReceived = bytesWritten;
+	m_bytesTotal = bytesTotal;
+	m_segments.reserve(amount);
+
+	for (int i = 0; i < amount; ++i)
+	{
+		TransferSegment segment;
+		segment.start = ((i == 0) ? 0 : (bytesWritten + (i * segmentSize)));
+		segment.end = (((i + 1) == amount) ? bytesTotal : (bytesWritten + ((i + 1) * segmentSize)));
+		segment.bytesReceived = ((i == 0) ? bytesWritten : 0);
+
+		m_segments.append(segment);
+	}
+
+	m_segments[0].reply = m_reply;
+
+	connect(m_reply, SIGNAL(readyRead()), this, SLOT(downloadSegmentData()));
+	connect(m_reply, SIGNAL(finished()), this, SLOT(downloadSegmentFinished()));
+
+	for (int i = 1; i < m_segments.count(); ++i)
+	{
+		startSegment(i);
+	}
+
+	emit changed();
+}
+
+void Transfer::startSegment(int index)
+{
+	const TransferSegment segment(m_segments.at(index));
+	QNetworkRequest request;
+	request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::AlwaysNetwork);
+	request.setHeader(QNetworkRequest::UserAgentHeader, NetworkManagerFactory::getUserAgent());
+	request.setRawHeader(QStringLiteral("Range").toLatin1(), QStringLiteral("bytes=%1-%2").arg(segment.start + segment.bytesReceived).arg(segment.end - 1).toLatin1());
+	request.setUrl(m_source);
+
+	QNetworkReply *reply(NetworkManagerFactory::getNetworkManager()->get(request));
+
+	m_segments[index].reply = reply;
+
+	reply->setReadBufferSize(m_readBufferSize);
+
+	connect(reply, SIGNAL(readyRead()), this, SLOT(downloadSegmentData()));
+	connect(reply, SIGNAL(finished()), this, SLOT(downloadSegmentFinished()));
+}
+
+void Transfer::writeSegment(QNetworkReply *reply, bool isForced)
+{
+	const int index(getSegmentIndex(reply));
+
+	if (index < 0 || !m_writer)
+	{
+		return;
+	}
+
+	if (reply != m_reply && reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).isValid() && reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 206)
+	{
+		reply->disconnect(this);
+		reply->abort();
+
+		m_segments[index].reply = nullptr;
+
+		QTimer::singleShot(250, reply, SLOT(deleteLater()));
+
+		downloadError(QNetworkReply::ProtocolInvalidOperationError);
+
+		return;
+	}
+
+	TransferSegment &segment(m_segments[index]);
+	const qint64 offset(segment.start + segment.bytesReceived);
+	const qint64 bytesRemaining(segment.end - offset);
+	const qint64 length(isForced ? m_writer->write(reply, offset, bytesRemaining, true) : writeData(reply, offset, bytesRemaining));
+
+	if (length > 0)
+	{
+		segment.bytesReceived += length;
+		segment.retriesAmount = 0;
+
+		m_bytesReceived += length;
+		m_bytesReceivedDifference += length;
+
+		emit progressChanged(m_bytesReceived, m_bytesTotal);
+	}
+
+	if ((segment.start + segment.bytesReceived) < segment.end)
+	{
+		return;
+	}
+
+	reply->disconnect(this);
+	reply->abort();
+
+	segment.reply = nullptr;
+
+	QTimer::singleShot(250, reply, SLOT(deleteLater()));
+
+	for (int i = 0; i < m_segments.count(); ++i)
+	{
+		if ((m_segments.at(i).start + m_segments.at(i).bytesReceived) < m_segments.at(i).end)
+		{
+			rebalanceSegments();
+
+			return;
+		}
+	}
+
+	finishSegments();
+}
+
+void Transfer::rebalanceSegments()
+{
+	qint64 bytesRemaining(0);
+	int index(-1);
+
+	for (int i = 0; i < m_segments.count(); ++i)
+	{
+		const qint64 segmentBytesRemaining(m_segments.at(i).end - m_segments.at(i).start - m_segments.at(i).bytesReceived);
+
+		if (m_segments.at(i).reply && segmentBytesRemaining > bytesRemaining)
+		{
+			bytesRemaining = segmentBytesRemaining;
+			index = i;
+		}
+	}
+
+	if (index < 0 || bytesRemaining < (m_minimumSegmentSize * 2))
+	{
+		return;
+	}
+
+	TransferSegment segment;
+	segment.start = (m_segments.at(index).end - (bytesRemaining / 2));
+	segment.end = m_segments.at(index).end;
+
+	m_segments[index].end = segment.start;
+	m_segments.append(segment);
+
+	startSegment(m_segments.count() - 1);
+
+	emit changed();
+}
+
+void Transfer::abortSegments()
+{
+	for (int i = 0; i < m_segments.count(); ++i)
+	{
+		QNetworkReply *reply(m_segments.at(i).reply);
+
+		if (reply)
+		{
+			reply->disconnect(this);
+			reply->abort();
+
+			QTimer::singleShot(250, reply, SLOT(deleteLater()));
+
+			m_segments[i].reply = nullptr;
+		}
+	}
+}
+
+void Transfer::finishSegments()
+{
+	if (m_updateTimer != 0)
+	{
+		killTimer(m_updateTimer);
+
+		m_updateTimer = 0;
+	}
+
+	m_segments.clear();
+
+	m_bytesReceived = m_bytesTotal;
+
+	if (m_writer)
+	{
+		m_writer->finish();
+	}
+	else
+	{
+		handleWriterFinished(true);
+	}
+}
+
 void Transfer::markStarted()
 {
 	m_timeStarted = QDateTime::currentDateTime();
@@ -516,6 +1020,14 @@ void Transfer::cancel()
 		QTimer::singleShot(250, m_reply, SLOT(deleteLater()));
 	}
 
+	if (m_writer)
+	{
+		m_writer->disconnect(this);
+		m_writer->cancel();
+		m_writer->deleteLater();
+		m_writer = nullptr;
+	}
+
 	if (m_device)
 	{
 		m_device->remove();
@@ -523,6 +1035,8 @@ void Transfer::cancel()
 
 	stop();
 
+	m_segments.clear();
+
 	if (m_options.testFlag(CanAutoDeleteOption) && !m_isSelectingPath)
 	{
 		deleteLater();
@@ -538,6 +1052,15 @@ void Transfer::stop()
 		m_updateTimer = 0;
 	}
 
+	if (m_throttleTimer != 0)
+	{
+		killTimer(m_throttleTimer);
+
+		m_throttleTimer = 0;
+	}
+
+	abortSegments();
+
 	if (m_reply)
 	{
 		m_reply->abort();
@@ -545,6 +1068,8 @@ void Transfer::stop()
 		QTimer::singleShot(250, m_reply, SLOT(deleteLater()));
 	}
 
+	closeWriter();
+
 	if (m_device && !m_device->inherits(QStringLiteral("QTemporaryFile").toLatin1()))
 	{
 		m_device->close();
@@ -561,6 +1086,10 @@ void Transfer::stop()
 			deleteLater();
 		}
 	}
+	else if (m_state == QueuedState)
+	{
+		m_state = ErrorState;
+	}
 
 	emit stopped();
 	emit changed();
@@ -593,6 +1122,13 @@ void Transfer::setOpenCommand(const QString &command)
 	}
 }
 
+void Transfer::setSpeedLimit(qint64 limit)
+{
+	m_bandwidth.setRate(limit);
+
+	emit changed();
+}
+
 void Transfer::setUpdateInterval(int interval)
 {
 	m_updateInterval = interval;
@@ -697,16 +1233,46 @@ qint64 Transfer::getSpeed() const
 	return m_speed;
 }
 
+qint64 Transfer::getSpeedLimit() const
+{
+	return m_bandwidth.getRate();
+}
+
 qint64 Transfer::getBytesReceived() const
 {
 	return m_bytesReceived;
 }
 
+qint64 Transfer::getBytesStored() const
+{
+	return (m_writer ? (m_bytesReceived - m_writer->getPendingBytes()) : m_bytesReceived);
+}
+
 qint64 Transfer::getBytesTotal() const
 {
 	return m_bytesTotal;
 }
 
+QVector<Transfer::TransferSegment> Transfer::getSegments() const
+{
+	return m_segments;
+}
+
+QVector<Transfer::TransferSegment> Transfer::getStoredSegments() const
+{
+	QVector<TransferSegment> segments(m_segments);
+
+	if (m_writer)
+	{
+		for (int i = 0; i < segments.count(); ++i)
+		{
+			segments[i].bytesReceived -= m_writer->getPendingBytes(segments.at(i).start, segments.at(i).end);
+		}
+	}
+
+	return segments;
+}
+
 Transfer::TransferOptions Transfer::getOptions() const
 {
 	return m_options;
@@ -717,9 +1283,42 @@ Transfer::TransferState Transfer::getState() const
 	return m_state;
 }
 
+int Transfer::getActiveSegmentsAmount() const
+{
+	int amount(0);
+
+	for (int i = 0; i < m_segments.count(); ++i)
+	{
+		if (m_segments.at(i).reply)
+		{
+			++amount;
+		}
+	}
+
+	return amount;
+}
+
+int Transfer::getSegmentIndex(QNetworkReply *reply) const
+{
+	if (!reply)
+	{
+		return -1;
+	}
+
+	for (int i = 0; i < m_segments.count(); ++i)
+	{
+		if (m_segments.at(i).reply == reply)
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
+
 bool Transfer::resume()
 {
-	if (m_state != ErrorState || !QFile::exists(m_target))
+	if ((m_state != ErrorState && m_state != QueuedState) || !QFile::exists(m_target))
 	{
 		return false;
 	}
@@ -729,6 +1328,46 @@ bool Transfer::resume()
 		return restart();
 	}
 
+	if (!m_segments.isEmpty())
+	{
+		QFile *file(new QFile(m_target));
+
+		if (!file->open(QIODevice::ReadWrite))
+		{
+			file->deleteLater();
+
+			return false;
+		}
+
+		m_state = RunningState;
+		m_device = file;
+		m_timeStarted = QDateTime::currentDateTime();
+		m_timeFinished = QDateTime();
+		m_bytesStart = 0;
+		m_bytesReceived = 0;
+
+		createWriter();
+
+		for (int i = 0; i < m_segments.count(); ++i)
+		{
+			m_bytesReceived += m_segments.at(i).bytesReceived;
+
+			if ((m_segments.at(i).start + m_segments.at(i).bytesReceived) < m_segments.at(i).end)
+			{
+				startSegment(i);
+			}
+		}
+
+		if (m_updateTimer == 0 && m_updateInterval > 0)
+		{
+			m_updateTimer = startTimer(m_updateInterval);
+		}
+
+		emit changed();
+
+		return true;
+	}
+
 	QFile *file(new QFile(m_target));
 
 	if (!file->open(QIODevice::WriteOnly | QIODevice::Append))
@@ -764,6 +1403,8 @@ bool Transfer::resume()
 		m_updateTimer = startTimer(m_updateInterval);
 	}
 
+	emit changed();
+
 	return true;
 }
 
@@ -771,6 +1412,8 @@ bool Transfer::restart()
 {
 	stop();
 
+	m_segments.clear();
+
 	QFile *file(new QFile(m_target));
 
 	if (!file->open(QIODevice::WriteOnly))
@@ -785,6 +1428,7 @@ bool Transfer::restart()
 	m_timeStarted = QDateTime::currentDateTime();
 	m_timeFinished = QDateTime();
 	m_bytesStart = 0;
+	m_canSegment = true;
 
 	QNetworkRequest request;
 	request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::AlwaysNetwork);
@@ -910,8 +1554,14 @@ bool Transfer::setTarget(const QString &target, bool canOverwriteExisting)
 }
 
 TransfersManager::TransfersManager(QObject *parent) : QObject(parent),
-	m_saveTimer(0)
+	m_saveTimer(0),
+	m_queueTimer(0),
+	m_pageLoadsTimer(0),
+	m_isLoadingPage(false)
 {
+	updateBandwidth();
+
+	connect(SettingsManager::getInstance(), SIGNAL(optionChanged(int,QVariant)), this, SLOT(handleOptionChanged(int)));
 }
 
 void TransfersManager::createInstance()
@@ -932,6 +1582,41 @@ void TransfersManager::timerEvent(QTimerEvent *event)
 
 		save();
 	}
+	else if (event->timerId() == m_queueTimer)
+	{
+		killTimer(m_queueTimer);
+
+		m_queueTimer = 0;
+
+		processQueue();
+	}
+	else if (event->timerId() == m_pageLoadsTimer)
+	{
+		const QVector<MainWindow*> mainWindows(Application::getWindows());
+		bool isLoadingPage(false);
+
+		for (int i = 0; i < mainWindows.count() && !isLoadingPage; ++i)
+		{
+			for (int j = 0; j < mainWindows.at(i)->getWindowCount(); ++j)
+			{
+				const Window *window(mainWindows.at(i)->getWindowByIndex(j));
+
+				if (window && window->getLoadingState() == WebWidget::OngoingLoadingState)
+				{
+					isLoadingPage = true;
+
+					break;
+				}
+			}
+		}
+
+		if (isLoadingPage != m_isLoadingPage)
+		{
+			m_isLoadingPage = isLoadingPage;
+
+			updateBandwidth();
+		}
+	}
 }
 
 void TransfersManager::scheduleSave()
@@ -942,6 +1627,70 @@ void TransfersManager::scheduleSave()
 	}
 }
 
+void TransfersManager::scheduleQueue()
+{
+	if (m_queueTimer == 0)
+	{
+		m_queueTimer = startTimer(0);
+	}
+}
+
+void TransfersManager::processQueue()
+{
+	const int limit(SettingsManager::getOption(SettingsManager::Network_ActiveTransfersLimitOption).toInt());
+	int amount(getRunningTransfersAmount());
+
+	while (!m_queuedTransfers.isEmpty() && (limit <= 0 || amount < limit))
+	{
+		Transfer *transfer(m_queuedTransfers.takeFirst());
+
+		if (transfer->getState() != Transfer::QueuedState)
+		{
+			continue;
+		}
+
+		if (transfer->resume())
+		{
+			++amount;
+		}
+		else
+		{
+			transfer->stop();
+		}
+	}
+}
+
+void TransfersManager::updateBandwidth()
+{
+	const bool isPrioritizingPageLoads(SettingsManager::getOption(SettingsManager::Network_PrioritizePageLoadsOption).toBool());
+
+	if (isPrioritizingPageLoads && m_pageLoadsTimer == 0)
+	{
+		m_pageLoadsTimer = startTimer(500);
+	}
+	else if (!isPrioritizingPageLoads && m_pageLoadsTimer != 0)
+	{
+		killTimer(m_pageLoadsTimer);
+
+		m_pageLoadsTimer = 0;
+		m_isLoadingPage = false;
+	}
+
+	qint64 limit(SettingsManager::getOption(SettingsManager::Network_TransferSpeedLimitOption).toLongLong() * 1024);
+
+	if (m_isLoadingPage)
+	{
+		limit = ((limit > 0) ? (limit / 4) : m_backgroundSpeedLimit);
+	}
+
+	m_bandwidth.setRate(limit);
+}
+
+void TransfersManager::consumeBandwidth(qint64 amount)
+{
+	m_bandwidth.consume(amount);
+}
+
 void TransfersManager::addTransfer(Transfer *transfer)
 {
 	m_transfers.append(transfer);
@@ -953,6 +1702,13 @@ void TransfersManager::addTransfer(Transfer *transfer)
 	connect(transfer, SIGNAL(changed()), m_instance, SLOT(transferChanged()));
 	connect(transfer, SIGNAL(stopped()), m_instance, SLOT(transferStopped()));
 
+	const int limit(SettingsManager::getOption(SettingsManager::Network_ActiveTransfersLimitOption).toInt());
+
+	if (limit > 0 && transfer->getState() == Transfer::RunningState && getRunningTransfersAmount() > limit && transfer->queue())
+	{
+		m_queuedTransfers.append(transfer);
+	}
+
 	if (transfer->getOptions().testFlag(Transfer::CanNotifyOption) && transfer->getState() != Transfer::CancelledState)
 	{
 		emit m_instance->transferStarted(transfer);
@@ -994,7 +1750,32 @@ void TransfersManager::save()
 		history.setValue(QStringLiteral("%1/timeStarted").arg(entry), m_transfers.at(i)->getTimeStarted().toString(Qt::ISODate));
 		history.setValue(QStringLiteral("%1/timeFinished").arg(entry), ((m_transfers.at(i)->getTimeFinished().isValid() && m_transfers.at(i)->getState() != Transfer::RunningState) ? m_transfers.at(i)->getTimeFinished() : QDateTime::currentDateTime()).toString(Qt::ISODate));
 		history.setValue(QStringLiteral("%1/bytesTotal").arg(entry), m_transfers.at(i)->getBytesTotal());
-		history.setValue(QStringLiteral("%1/bytesReceived").arg(entry), m_transfers.at(i)->getBytesReceived());
+		history.setValue(QStringLiteral("%1/bytesReceived").arg(entry), m_transfers.at(i)->getBytesStored());
+
+		if (m_transfers.at(i)->getSpeedLimit() > 0)
+		{
+			history.setValue(QStringLiteral("%1/speedLimit").arg(entry), m_transfers.at(i)->getSpeedLimit());
+		}
+
+		if (m_transfers.at(i)->getState() == Transfer::QueuedState)
+		{
+			history.setValue(QStringLiteral("%1/isQueued").arg(entry), true);
+		}
+
+		const QVector<Transfer::TransferSegment> segments(m_transfers.at(i)->getStoredSegments());
+
+		if (!segments.isEmpty())
+		{
+			QStringList values;
+			values.reserve(segments.count());
+
+			for (int j = 0; j < segments.count(); ++j)
+			{
+				values.append(QStringLiteral("%1,%2,%3").arg(segments.at(j).start).arg(segments.at(j).end).arg(segments.at(j).bytesReceived));
+			}
+
+			history.setValue(QStringLiteral("%1/segments").arg(entry), values);
+		}
 
 		++entry;
 	}
@@ -1002,6 +1783,24 @@ void TransfersManager::save()
 	history.sync();
 }
 
+void TransfersManager::handleOptionChanged(int identifier)
+{
+	switch (identifier)
+	{
+		case SettingsManager::Network_ActiveTransfersLimitOption:
+			scheduleQueue();
+
+			break;
+		case SettingsManager::Network_PrioritizePageLoadsOption:
+		case SettingsManager::Network_TransferSpeedLimitOption:
+			updateBandwidth();
+
+			break;
+		default:
+			break;
+	}
+}
+
 void TransfersManager::transferStarted()
 {
 	Transfer *transfer(qobject_cast<Transfer*>(sender()));
@@ -1031,6 +1830,8 @@ void TransfersManager::transferFinished()
 		{
 			scheduleSave();
 		}
+
+		scheduleQueue();
 	}
 }
 
@@ -1055,6 +1856,7 @@ void TransfersManager::transferStopped()
 		emit transferStopped(transfer);
 
 		scheduleSave();
+		scheduleQueue();
 	}
 }
 
@@ -1074,6 +1876,11 @@ TransfersManager* TransfersManager::getInstance()
 	return m_instance;
 }
 
+qint64 TransfersManager::getAvailableBandwidth()
+{
+	return m_bandwidth.getAvailable();
+}
+
 Transfer* TransfersManager::startTransfer(const QUrl &source, const QString &target, Transfer::TransferOptions options)
 {
 	Transfer *transfer(new Transfer(source, target, options, m_instance));
@@ -1137,12 +1944,24 @@ QVector<Transfer*> TransfersManager::getTransfers()
 
 			if (!history.value(QLatin1String("source")).toString().isEmpty() && !history.value(QLatin1String("target")).toString().isEmpty())
 			{
-				addTransfer(new Transfer(history, m_instance));
+				Transfer *transfer(new Transfer(history, m_instance));
+
+				addTransfer(transfer);
+
+				if (transfer->getState() == Transfer::QueuedState)
+				{
+					m_queuedTransfers.append(transfer);
+				}
 			}
 
 			history.endGroup();
 		}
 
+		if (!m_queuedTransfers.isEmpty())
+		{
+			m_instance->scheduleQueue();
+		}
+
 		m_isInitilized = true;
 
 		connect(QCoreApplication::instance(), SIGNAL(aboutToQuit()), m_instance, SLOT(save()));
@@ -1162,6 +1981,8 @@ bool TransfersManager::removeTransfer(Transfer *transfer, bool keepFile)
 
 	m_privateTransfers.removeAll(transfer);
 
+	m_queuedTransfers.removeAll(transfer);
+
 	if (transfer->getState() == Transfer::RunningState)
 	{
 		transfer->stop();
@@ -1179,6 +2000,21 @@ bool TransfersManager::removeTransfer(Transfer *transfer, bool keepFile)
 	return true;
 }
 
+int TransfersManager::getRunningTransfersAmount()
+{
+	int amount(0);
+
+	for (int i = 0; i < m_transfers.count(); ++i)
+	{
+		if (m_transfers.at(i)->getState() == Transfer::RunningState)
+		{
+			++amount;
+		}
+	}
+
+	return amount;
+}
+
 bool TransfersManager::isDownloading(const QString &source, const QString &target)
 {
 	if (source.isEmpty() && target.isEmpty())
@@ -20,6 +20,8 @@
 #ifndef OTTER_TRANSFERSMANAGER_H
 #define OTTER_TRANSFERSMANAGER_H
 
+#include "TokenBucket.h"
+
 #include <QtCore/QFile>
 #include <QtCore/QMimeType>
 #include <QtCore/QPointer>
@@ -30,6 +32,7 @@ namespace Otter
 {
 
 class NetworkManager;
+class TransferWriter;
 
 class Transfer : public QObject
 {
@@ -56,7 +59,17 @@ public:
 		RunningState = 1,
 		FinishedState = 2,
 		ErrorState = 3,
-		CancelledState = 4
+		CancelledState = 4,
+		QueuedState = 5
+	};
+
+	struct TransferSegment
+	{
+		QPointer<QNetworkReply> reply;
+		qint64 start = 0;
+		qint64 end = 0;
+		qint64 bytesReceived = 0;
+		int retriesAmount = 0;
 	};
 
 	explicit Transfer(TransferOptions options = CanAskForPathOption, QObject *parent = nullptr);
@@ -67,6 +80,7 @@ public:
 	~Transfer();
 
 	virtual void setUpdateInterval(int interval);
+	void setSpeedLimit(qint64 limit);
 	virtual QUrl getSource() const;
 	virtual QString getSuggestedFileName();
 	virtual QString getTarget() const;
@@ -74,10 +88,13 @@ public:
 	virtual QDateTime getTimeFinished() const;
 	virtual QMimeType getMimeType() const;
 	virtual qint64 getSpeed() const;
+	qint64 getSpeedLimit() const;
 	virtual qint64 getBytesReceived() const;
 	virtual qint64 getBytesTotal() const;
+	virtual QVector<TransferSegment> getSegments() const;
 	TransferOptions getOptions() const;
 	virtual TransferState getState() const;
+	virtual int getActiveSegmentsAmount() const;
 
 public slots:
 	void openTarget() const;
@@ -91,18 +108,37 @@ public slots:
 protected:
 	void timerEvent(QTimerEvent *event) override;
 	void start(QNetworkReply *reply, const QString &target);
+	void createWriter();
+	void closeWriter();
+	qint64 getBytesStored() const;
+	QVector<TransferSegment> getStoredSegments() const;
+	qint64 writeData(QNetworkReply *reply, qint64 offset, qint64 limit = -1);
+	qint64 getAvailableBandwidth();
+	bool queue();
+	void startSegments();
+	void startSegment(int index);
+	void writeSegment(QNetworkReply *reply, bool isForced = false);
+	void rebalanceSegments();
+	void abortSegments();
+	void finishSegments();
+	int getSegmentIndex(QNetworkReply *reply) const;
 
 protected slots:
 	void downloadProgress(qint64 bytesReceived, qint64 bytesTotal);
 	void downloadData();
 	void downloadFinished();
 	void downloadError(QNetworkReply::NetworkError error);
+	void downloadSegmentData();
+	void downloadSegmentFinished();
+	void readData();
+	void handleWriterFinished(bool isSuccess);
 	void markStarted();
 	void markFinished(bool reset = false);
 
 private:
 	QPointer<QNetworkReply> m_reply;
 	QPointer<QFile> m_device;
+	TransferWriter *m_writer;
 	QUrl m_source;
 	QString m_target;
 	QString m_openCommand;
@@ -110,23 +146,34 @@ private:
 	QDateTime m_timeStarted;
 	QDateTime m_timeFinished;
 	QMimeType m_mimeType;
+	QVector<TransferSegment> m_segments;
+	TokenBucket m_bandwidth;
 	qint64 m_speed;
 	qint64 m_bytesStart;
 	qint64 m_bytesReceivedDifference;
 	qint64 m_bytesReceived;
 	qint64 m_bytesTotal;
+	qint64 m_bytesWritten;
 	TransferOptions m_options;
 	TransferState m_state;
 	int m_updateTimer;
 	int m_updateInterval;
+	int m_throttleTimer;
+	bool m_canSegment;
 	bool m_isSelectingPath;
 
+	static const qint64 m_minimumSegmentSize;
+	static const qint64 m_readBufferSize;
+	static const int m_segmentRetriesLimit;
+
 signals:
 	void progressChanged(qint64 bytesReceived, qint64 bytesTotal);
 	void started();
 	void finished();
 	void changed();
 	void stopped();
+
+friend class TransfersManager;
 };
 
 class TransfersManager final : public QObject
@@ -150,9 +197,16 @@ protected:
 
 	void timerEvent(QTimerEvent *event) override;
 	void scheduleSave();
+	void scheduleQueue();
+	void processQueue();
+	void updateBandwidth();
+	static void consumeBandwidth(qint64 amount);
+	static qint64 getAvailableBandwidth();
+	static int getRunningTransfersAmount();
 
 protected slots:
 	void save();
+	void handleOptionChanged(int identifier);
 	void transferStarted();
 	void transferFinished();
 	void transferChanged();
@@ -160,11 +214,17 @@ protected slots:
 
 private:
 	int m_saveTimer;
+	int m_queueTimer;
+	int m_pageLoadsTimer;
+	bool m_isLoadingPage;
 
 	static TransfersManager *m_instance;
 	static QVector<Transfer*> m_transfers;
 	static QVector<Transfer*> m_privateTransfers;
+	static QVector<Transfer*> m_queuedTransfers;
+	static TokenBucket m_bandwidth;
 	static bool m_isInitilized;
+	static const qint64 m_backgroundSpeedLimit;
 
 signals:
 	void transferStarted(Transfer *transfer);
@@ -172,6 +232,8 @@ signals:
 	void transferChanged(Transfer *transfer);
 	void transferStopped(Transfer *transfer);
 	void transferRemoved(Transfer *transfer);
+
+friend class Transfer;
 };
 
 }
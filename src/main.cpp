@@ -143,6 +143,7 @@ int main(int argc, char *argv[])
 	}
 	else if (startupBehavior != QLatin1String("startEmpty"))
 	{
+		const SessionDefaults defaults(SessionsManager::getDefaults());
 		WindowHistoryEntry entry;
 
 		if (startupBehavior == QLatin1String("startHomePage"))
@@ -158,7 +159,10 @@ int main(int argc, char *argv[])
 			entry.url = QLatin1String("about:blank");
 		}
 
+		entry.zoom = defaults.zoom;
+
 		SessionWindow tab;
+		tab.state = defaults.windowState;
 		tab.history.append(entry);
 		tab.historyIndex = 0;
 
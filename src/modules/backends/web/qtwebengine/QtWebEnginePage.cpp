@@ -43,6 +43,7 @@ namespace Otter
 
 QtWebEnginePage::QtWebEnginePage(bool isPrivate, QtWebEngineWebWidget *parent) : QWebEnginePage((isPrivate ? new QWebEngineProfile(parent) : QWebEngineProfile::defaultProfile()), parent),
 	m_widget(parent),
+	m_styleSheetWatcher(nullptr),
 	m_previousNavigationType(QtWebEnginePage::NavigationTypeOther),
 	m_isIgnoringJavaScriptPopups(false),
 	m_isViewingMedia(false),
@@ -56,10 +57,46 @@ QtWebEnginePage::QtWebEnginePage(bool isPrivate, QtWebEngineWebWidget *parent) :
 	connect(this, SIGNAL(loadFinished(bool)), this, SLOT(pageLoadFinished()));
 }
 
+void QtWebEnginePage::applyContentBlockingRules()
+{
+	if (!m_styleSheetWatcher || !m_styleSheetWatcher->isFinished())
+	{
+		return;
+	}
+
+	QString styleSheet(m_styleSheetWatcher->result());
+
+	m_styleSheetWatcher->deleteLater();
+	m_styleSheetWatcher = nullptr;
+
+	if (styleSheet.isEmpty())
+	{
+		return;
+	}
+
+	QFile file(QLatin1String(":/modules/backends/web/qtwebengine/resources/hideElements.js"));
+
+	if (file.open(QIODevice::ReadOnly))
+	{
+		styleSheet.replace(QLatin1Char('\\'), QLatin1String("\\\\")).replace(QLatin1Char('\''), QLatin1String("\\'")).replace(QLatin1Char('\n'), QLatin1String("\\n"));
+
+		runJavaScript(QString(file.readAll()).arg(QLatin1Char('\'') + styleSheet + QLatin1Char('\'')));
+
+		file.close();
+	}
+}
+
 void QtWebEnginePage::pageLoadFinished()
 {
 	m_isIgnoringJavaScriptPopups = false;
 
+	if (m_styleSheetWatcher)
+	{
+		m_styleSheetWatcher->disconnect(this);
+		m_styleSheetWatcher->deleteLater();
+		m_styleSheetWatcher = nullptr;
+	}
+
 	toHtml([&](const QString &result)
 	{
 		if (m_widget)
@@ -69,35 +106,20 @@ void QtWebEnginePage::pageLoadFinished()
 			if (!profiles.isEmpty() && ContentBlockingManager::getCosmeticFiltersMode() != ContentBlockingManager::NoFiltersMode)
 			{
 				const ContentBlockingManager::CosmeticFiltersMode mode(ContentBlockingManager::checkUrl(profiles, url(), url(), NetworkManager::OtherType).comesticFiltersMode);
-				QStringList styleSheetBlackList;
-				QStringList styleSheetWhiteList;
 
 				if (mode != ContentBlockingManager::NoFiltersMode)
 				{
-					if (mode != ContentBlockingManager::DomainOnlyFiltersMode)
-					{
-						styleSheetBlackList = ContentBlockingManager::getStyleSheet(profiles);
-					}
-
-					const QStringList domainList(ContentBlockingManager::createSubdomainList(url().host()));
-
-					for (int i = 0; i < domainList.count(); ++i)
+					if (m_styleSheetWatcher)
 					{
-						styleSheetBlackList += ContentBlockingManager::getStyleSheetBlackList(domainList.at(i), profiles);
-						styleSheetWhiteList += ContentBlockingManager::getStyleSheetWhiteList(domainList.at(i), profiles);
+						m_styleSheetWatcher->disconnect(this);
+						m_styleSheetWatcher->deleteLater();
 					}
-				}
 
-				if (!styleSheetBlackList.isEmpty() || !styleSheetWhiteList.isEmpty())
-				{
-					QFile file(QLatin1String(":/modules/backends/web/qtwebengine/resources/hideElements.js"));
+					m_styleSheetWatcher = new QFutureWatcher<QString>(this);
 
-					if (file.open(QIODevice::ReadOnly))
-					{
-						runJavaScript(QString(file.readAll()).arg(createJavaScriptList(styleSheetWhiteList)).arg(createJavaScriptList(styleSheetBlackList)));
+					connect(m_styleSheetWatcher, SIGNAL(finished()), this, SLOT(applyContentBlockingRules()));
 
-						file.close();
-					}
+					m_styleSheetWatcher->setFuture(ContentBlockingManager::getCosmeticFiltersStyleSheet(profiles, url().host(), mode));
 				}
 			}
 
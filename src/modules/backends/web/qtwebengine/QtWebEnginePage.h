@@ -23,6 +23,7 @@
 
 #include "../../../../core/SessionsManager.h"
 
+#include <QtCore/QFutureWatcher>
 #include <QtWebEngineWidgets/QWebEnginePage>
 
 namespace Otter
@@ -53,11 +54,13 @@ protected:
 	bool javaScriptPrompt(const QUrl &url, const QString &message, const QString &defaultValue, QString *result) override;
 
 protected slots:
+	void applyContentBlockingRules();
 	void pageLoadFinished();
 	void removePopup(const QUrl &url);
 
 private:
 	QtWebEngineWebWidget *m_widget;
+	QFutureWatcher<QString> *m_styleSheetWatcher;
 	QVector<QtWebEnginePage*> m_popups;
 	QWebEnginePage::NavigationType m_previousNavigationType;
 	bool m_isIgnoringJavaScriptPopups;
@@ -41,8 +41,10 @@ QtWebEngineUrlRequestInterceptor::QtWebEngineUrlRequestInterceptor(QObject *pare
 
 void QtWebEngineUrlRequestInterceptor::clearContentBlockingInformation()
 {
+	m_mutex.lock();
 	m_blockedElements.clear();
 	m_contentBlockingProfiles.clear();
+	m_mutex.unlock();
 
 	QTimer::singleShot(1800000, this, SLOT(clearContentBlockingInformation()));
 }
@@ -66,6 +68,8 @@ void QtWebEngineUrlRequestInterceptor::handleOptionChanged(int identifier)
 
 QStringList QtWebEngineUrlRequestInterceptor::getBlockedElements(const QString &domain) const
 {
+	QMutexLocker locker(&m_mutex);
+
 	return m_blockedElements.value(domain);
 }
 
@@ -78,19 +82,26 @@ void QtWebEngineUrlRequestInterceptor::interceptRequest(QWebEngineUrlRequestInfo
 		return;
 	}
 
-	if (!m_contentBlockingProfiles.contains(request.firstPartyUrl().host()))
+	const QString host(request.firstPartyUrl().host());
+
+	m_mutex.lock();
+
+	const bool hasProfiles(m_contentBlockingProfiles.contains(host));
+	QVector<int> contentBlockingProfiles(m_contentBlockingProfiles.value(host));
+
+	m_mutex.unlock();
+
+	if (!hasProfiles)
 	{
 		if (SettingsManager::getOption(SettingsManager::ContentBlocking_EnableContentBlockingOption, request.firstPartyUrl()).toBool())
 		{
-			m_contentBlockingProfiles[request.firstPartyUrl().host()] = ContentBlockingManager::getProfileList(SettingsManager::getOption(SettingsManager::ContentBlocking_ProfilesOption, request.firstPartyUrl()).toStringList());
-		}
-		else
-		{
-			m_contentBlockingProfiles[request.firstPartyUrl().host()] = QVector<int>();
+			contentBlockingProfiles = ContentBlockingManager::getProfileList(SettingsManager::getOption(SettingsManager::ContentBlocking_ProfilesOption, request.firstPartyUrl()).toStringList());
 		}
-	}
 
-	const QVector<int> contentBlockingProfiles(m_contentBlockingProfiles.value(request.firstPartyUrl().host()));
+		m_mutex.lock();
+		m_contentBlockingProfiles[host] = contentBlockingProfiles;
+		m_mutex.unlock();
+	}
 
 	if (contentBlockingProfiles.isEmpty())
 	{
@@ -155,9 +166,18 @@ void QtWebEngineUrlRequestInterceptor::interceptRequest(QWebEngineUrlRequestInfo
 
 	if (result.isBlocked)
 	{
-		if (storeBlockedUrl && !m_blockedElements.value(request.firstPartyUrl().host()).contains(request.requestUrl().url()))
+		if (storeBlockedUrl)
 		{
-			m_blockedElements[request.firstPartyUrl().host()].append(request.requestUrl().url());
+			const QString url(request.requestUrl().url());
+
+			m_mutex.lock();
+
+			if (!m_blockedElements.value(host).contains(url))
+			{
+				m_blockedElements[host].append(url);
+			}
+
+			m_mutex.unlock();
 		}
 
 		Console::addMessage(QCoreApplication::translate("main", "Request blocked with rule: %1").arg(result.rule), Console::NetworkCategory, Console::LogLevel, request.requestUrl().toString(), -1);
@@ -22,6 +22,7 @@
 #define OTTER_QTWEBENGINEURLREQUESTINTERCEPTOR_H
 
 #include <QtCore/QMap>
+#include <QtCore/QMutex>
 #include <QtCore/QVector>
 #include <QtWebEngineCore/QWebEngineUrlRequestInterceptor>
 
@@ -45,6 +46,7 @@ protected slots:
 private:
 	QMap<QString, QStringList> m_blockedElements;
 	QMap<QString, QVector<int> > m_contentBlockingProfiles;
+	mutable QMutex m_mutex;
 	bool m_areImagesEnabled;
 };
 
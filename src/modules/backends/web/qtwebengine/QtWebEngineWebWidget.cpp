@@ -1616,6 +1616,7 @@ WindowHistoryInformation QtWebEngineWebWidget::getHistory() const
 
 	const QString requestedUrl(m_page->requestedUrl().toString());
 	const int historyCount(history->count());
+	const int defaultZoom(SessionsManager::getDefaults().zoom);
 
 	for (int i = 0; i < historyCount; ++i)
 	{
@@ -1623,6 +1624,7 @@ WindowHistoryInformation QtWebEngineWebWidget::getHistory() const
 		WindowHistoryEntry entry;
 		entry.url = item.url().toString();
 		entry.title = item.title();
+		entry.zoom = defaultZoom;
 
 		information.entries.append(entry);
 	}
@@ -1632,6 +1634,7 @@ WindowHistoryInformation QtWebEngineWebWidget::getHistory() const
 		WindowHistoryEntry entry;
 		entry.url = requestedUrl;
 		entry.title = getTitle();
+		entry.zoom = defaultZoom;
 
 		information.index = historyCount;
 		information.entries.append(entry);
@@ -19,38 +19,251 @@
 
 #include "QtWebKitHistoryInterface.h"
 #include "../../../../core/HistoryManager.h"
+#include "../../../../core/Utils.h"
+
+#include <QtConcurrent/QtConcurrentRun>
 
 namespace Otter
 {
 
-QtWebKitHistoryInterface::QtWebKitHistoryInterface(QObject *parent) : QWebHistoryInterface(parent)
+const int QtWebKitHistoryInterface::m_filterSize(16384);
+
+QtWebKitHistoryInterface::QtWebKitHistoryInterface(QObject *parent) : QWebHistoryInterface(parent),
+	m_hashesWatcher(nullptr),
+	m_filter(m_filterSize, 0),
+	m_isReady(false)
 {
+	populateHashes();
+
 	connect(HistoryManager::getBrowsingHistoryModel(), SIGNAL(cleared()), this, SLOT(clear()));
+	connect(HistoryManager::getBrowsingHistoryModel(), SIGNAL(entryAdded(HistoryEntryItem*)), this, SLOT(handleEntryAdded(HistoryEntryItem*)));
+	connect(HistoryManager::getBrowsingHistoryModel(), SIGNAL(entryRemoved(HistoryEntryItem*)), this, SLOT(handleEntryRemoved(HistoryEntryItem*)));
+	connect(HistoryManager::getBrowsingHistoryModel(), SIGNAL(entriesRemoved(QVector<QUrl>)), this, SLOT(handleEntriesRemoved(QVector<QUrl>)));
 }
 
 void QtWebKitHistoryInterface::clear()
 {
-	m_urls.clear();
+	m_visitedHashes.clear();
+
+	populateHashes();
 }
 
-void QtWebKitHistoryInterface::addHistoryEntry(const QString &url)
+void QtWebKitHistoryInterface::populateHashes()
+{
+	if (m_hashesWatcher)
+	{
+		m_hashesWatcher->disconnect(this);
+		m_hashesWatcher->deleteLater();
+	}
+
+	m_filter.fill(0);
+	m_historyHashes.clear();
+	m_removedHashes.clear();
+
+	m_isReady = false;
+
+	m_hashesWatcher = new QFutureWatcher<QSet<quint64> >(this);
+
+	connect(m_hashesWatcher, SIGNAL(finished()), this, SLOT(handleHashesCreated()));
+
+	m_hashesWatcher->setFuture(QtConcurrent::run(&QtWebKitHistoryInterface::createHashes, HistoryManager::getBrowsingHistoryModel()->getIndex()));
+}
+
+void QtWebKitHistoryInterface::handleEntryAdded(HistoryEntryItem *entry)
 {
-	if (m_urls.contains(url))
+	if (entry)
+	{
+		addHash(createHash(Utils::normalizeUrl(entry->data(HistoryModel::UrlRole).toUrl()).toString(QUrl::FullyEncoded)));
+	}
+}
+
+void QtWebKitHistoryInterface::handleEntryRemoved(HistoryEntryItem *entry)
+{
+	if (!entry)
 	{
 		return;
 	}
 
-	m_urls.append(url);
+	const QUrl url(entry->data(HistoryModel::UrlRole).toUrl());
+
+	if (HistoryManager::getBrowsingHistoryModel()->getVisitsAmount(url) <= 1)
+	{
+		removeHash(createHash(Utils::normalizeUrl(url).toString(QUrl::FullyEncoded)));
+	}
+}
+
+void QtWebKitHistoryInterface::handleEntriesRemoved(const QVector<QUrl> &urls)
+{
+	const HistoryModel *model(HistoryManager::getBrowsingHistoryModel());
+
+	for (int i = 0; i < urls.count(); ++i)
+	{
+		if (!model->hasEntry(urls.at(i)))
+		{
+			removeHash(createHash(Utils::normalizeUrl(urls.at(i)).toString(QUrl::FullyEncoded)));
+		}
+	}
+}
+
+void QtWebKitHistoryInterface::handleHashesCreated()
+{
+	if (!m_hashesWatcher)
+	{
+		return;
+	}
+
+	const QSet<quint64> hashes((m_hashesWatcher->result() - m_removedHashes) + m_historyHashes);
+
+	m_historyHashes.reserve(hashes.count());
+
+	QSet<quint64>::const_iterator iterator;
+
+	for (iterator = hashes.constBegin(); iterator != hashes.constEnd(); ++iterator)
+	{
+		addHash(*iterator);
+	}
+
+	m_hashesWatcher->deleteLater();
+	m_hashesWatcher = nullptr;
+
+	m_removedHashes.clear();
+
+	m_isReady = true;
+}
+
+void QtWebKitHistoryInterface::addHash(quint64 hash)
+{
+	const quint64 mask((static_cast<quint64>(m_filterSize) * 64) - 1);
+	const quint64 firstBit(hash & mask);
+	const quint64 secondBit((hash >> 32) & mask);
+
+	m_filter[static_cast<int>(firstBit / 64)] |= (Q_UINT64_C(1) << (firstBit % 64));
+	m_filter[static_cast<int>(secondBit / 64)] |= (Q_UINT64_C(1) << (secondBit % 64));
+
+	m_historyHashes.insert(hash);
+
+	if (m_hashesWatcher)
+	{
+		m_removedHashes.remove(hash);
+	}
+}
+
+void QtWebKitHistoryInterface::removeHash(quint64 hash)
+{
+	m_historyHashes.remove(hash);
+	m_visitedHashes.remove(hash);
+
+	if (m_hashesWatcher)
+	{
+		m_removedHashes.insert(hash);
+	}
+}
+
+void QtWebKitHistoryInterface::addHistoryEntry(const QString &url)
+{
+	m_visitedHashes.insert(createHash(url));
+}
+
+QSet<quint64> QtWebKitHistoryInterface::createHashes(std::shared_ptr<const HistoryStore::Index> index)
+{
+	QSet<quint64> hashes;
+	hashes.reserve(index->urls.count());
+
+	QHash<QUrl, QVector<quint64> >::const_iterator iterator;
 
-	if (m_urls.length() > 100)
+	for (iterator = index->urls.constBegin(); iterator != index->urls.constEnd(); ++iterator)
 	{
-		m_urls.removeAt(0);
+		hashes.insert(createHash(iterator.key().toString(QUrl::FullyEncoded)));
 	}
+
+	return hashes;
+}
+
+quint64 QtWebKitHistoryInterface::createHash(const QString &url)
+{
+	int end(url.indexOf(QLatin1Char('#')));
+
+	if (end < 0)
+	{
+		end = url.length();
+	}
+
+	int queryStart(url.indexOf(QLatin1Char('?')));
+
+	if (queryStart < 0 || queryStart > end)
+	{
+		queryStart = end;
+	}
+
+	const int authorityStart(url.indexOf(QLatin1String("://")));
+	int pathStart(0);
+
+	if (authorityStart >= 0 && authorityStart < queryStart)
+	{
+		pathStart = url.indexOf(QLatin1Char('/'), (authorityStart + 3));
+
+		if (pathStart < 0 || pathStart > queryStart)
+		{
+			pathStart = queryStart;
+		}
+	}
+	else
+	{
+		pathStart = (url.indexOf(QLatin1Char(':')) + 1);
+	}
+
+	int pathEnd(queryStart);
+
+	while (pathEnd > pathStart && url.at(pathEnd - 1) == QLatin1Char('/'))
+	{
+		--pathEnd;
+	}
+
+	const QChar *data(url.constData());
+	quint64 hash(Q_UINT64_C(14695981039346656037));
+
+	for (int i = 0; i < pathEnd; ++i)
+	{
+		hash = ((hash ^ data[i].unicode()) * Q_UINT64_C(1099511628211));
+	}
+
+	for (int i = queryStart; i < end; ++i)
+	{
+		hash = ((hash ^ data[i].unicode()) * Q_UINT64_C(1099511628211));
+	}
+
+	return hash;
 }
 
 bool QtWebKitHistoryInterface::historyContains(const QString &url) const
 {
-	return (m_urls.contains(url) || HistoryManager::hasEntry(url));
+	const quint64 hash(createHash(url));
+
+	if (m_visitedHashes.contains(hash))
+	{
+		return true;
+	}
+
+	if (!HistoryManager::isEnabled())
+	{
+		return false;
+	}
+
+	if (!m_isReady)
+	{
+		return HistoryManager::hasEntry(url);
+	}
+
+	const quint64 mask((static_cast<quint64>(m_filterSize) * 64) - 1);
+	const quint64 firstBit(hash & mask);
+	const quint64 secondBit((hash >> 32) & mask);
+
+	if (!(m_filter.at(static_cast<int>(firstBit / 64)) & (Q_UINT64_C(1) << (firstBit % 64))) || !(m_filter.at(static_cast<int>(secondBit / 64)) & (Q_UINT64_C(1) << (secondBit % 64))))
+	{
+		return false;
+	}
+
+	return m_historyHashes.contains(hash);
 }
 
 }
@@ -20,12 +20,17 @@
 #ifndef OTTER_QTWEBKITHISTORYINTERFACE_H
 #define OTTER_QTWEBKITHISTORYINTERFACE_H
 
-#include <QtCore/QStringList>
+#include "../../../../core/HistoryStore.h"
+
+#include <QtCore/QFutureWatcher>
+#include <QtCore/QSet>
 #include <QtWebKit/QWebHistoryInterface>
 
 namespace Otter
 {
 
+class HistoryEntryItem;
+
 class QtWebKitHistoryInterface final : public QWebHistoryInterface
 {
 	Q_OBJECT
@@ -36,11 +41,29 @@ public:
 	void addHistoryEntry(const QString &url) override;
 	bool historyContains(const QString &url) const override;
 
+protected:
+	void addHash(quint64 hash);
+	void removeHash(quint64 hash);
+	static QSet<quint64> createHashes(std::shared_ptr<const HistoryStore::Index> index);
+	static quint64 createHash(const QString &url);
+
 protected slots:
 	void clear();
+	void populateHashes();
+	void handleEntryAdded(HistoryEntryItem *entry);
+	void handleEntryRemoved(HistoryEntryItem *entry);
+	void handleEntriesRemoved(const QVector<QUrl> &urls);
+	void handleHashesCreated();
 
 private:
-	QStringList m_urls;
+	QFutureWatcher<QSet<quint64> > *m_hashesWatcher;
+	QVector<quint64> m_filter;
+	QSet<quint64> m_historyHashes;
+	QSet<quint64> m_removedHashes;
+	QSet<quint64> m_visitedHashes;
+	bool m_isReady;
+
+	static const int m_filterSize;
 };
 
 }
@@ -50,6 +50,7 @@ namespace Otter
 QtWebKitFrame::QtWebKitFrame(QWebFrame *frame, QtWebKitWebWidget *parent) : QObject(parent),
 	m_frame(frame),
 	m_widget(parent),
+	m_styleSheetWatcher(nullptr),
 	m_isErrorPage(false)
 {
 	connect(frame, SIGNAL(destroyed(QObject*)), this, SLOT(deleteLater()));
@@ -66,25 +67,31 @@ void QtWebKitFrame::runUserScripts(const QUrl &url) const
 	}
 }
 
-void QtWebKitFrame::applyContentBlockingRules(const QStringList &rules, bool remove)
+void QtWebKitFrame::applyContentBlockingRules()
 {
-	const QWebElement document(m_frame->documentElement());
-	const QString value(remove ? QLatin1String("none !important") : QString());
+	if (!m_styleSheetWatcher || !m_styleSheetWatcher->isFinished())
+	{
+		return;
+	}
 
-	for (int i = 0; i < rules.count(); ++i)
+	QString styleSheet(m_styleSheetWatcher->result());
+
+	m_styleSheetWatcher->deleteLater();
+	m_styleSheetWatcher = nullptr;
+
+	if (styleSheet.isEmpty())
 	{
-		const QWebElementCollection elements(document.findAll(rules.at(i)));
+		return;
+	}
 
-		for (int j = 0; j < elements.count(); ++j)
-		{
-			QWebElement element(elements.at(j));
+	QWebElement element(m_frame->documentElement().findFirst(QLatin1String("head")));
 
-			if (!element.isNull())
-			{
-				element.setStyleProperty(QLatin1String("display"), value);
-			}
-		}
+	if (element.isNull())
+	{
+		element = m_frame->documentElement();
 	}
+
+	element.appendInside(QLatin1String("<style type=\"text/css\">") + styleSheet.replace(QLatin1String("</"), QLatin1String("<\\/")) + QLatin1String("</style>"));
 }
 
 void QtWebKitFrame::handleErrorPageChanged(QWebFrame *frame, bool isErrorPage)
@@ -97,6 +104,13 @@ void QtWebKitFrame::handleErrorPageChanged(QWebFrame *frame, bool isErrorPage)
 
 void QtWebKitFrame::handleLoadFinished()
 {
+	if (m_styleSheetWatcher)
+	{
+		m_styleSheetWatcher->disconnect(this);
+		m_styleSheetWatcher->deleteLater();
+		m_styleSheetWatcher = nullptr;
+	}
+
 	if (!m_widget)
 	{
 		return;
@@ -143,18 +157,11 @@ void QtWebKitFrame::handleLoadFinished()
 
 		if (mode != ContentBlockingManager::NoFiltersMode)
 		{
-			if (mode != ContentBlockingManager::DomainOnlyFiltersMode)
-			{
-				applyContentBlockingRules(ContentBlockingManager::getStyleSheet(profiles), true);
-			}
+			m_styleSheetWatcher = new QFutureWatcher<QString>(this);
 
-			const QStringList domainList(ContentBlockingManager::createSubdomainList(url.host()));
+			connect(m_styleSheetWatcher, SIGNAL(finished()), this, SLOT(applyContentBlockingRules()));
 
-			for (int i = 0; i < domainList.count(); ++i)
-			{
-				applyContentBlockingRules(ContentBlockingManager::getStyleSheetBlackList(domainList.at(i), profiles), true);
-				applyContentBlockingRules(ContentBlockingManager::getStyleSheetWhiteList(domainList.at(i), profiles), false);
-			}
+			m_styleSheetWatcher->setFuture(ContentBlockingManager::getCosmeticFiltersStyleSheet(profiles, url.host(), mode));
 		}
 	}
 
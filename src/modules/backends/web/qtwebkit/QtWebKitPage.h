@@ -23,6 +23,7 @@
 
 #include "../../../../core/SessionsManager.h"
 
+#include <QtCore/QFutureWatcher>
 #include <QtWebKit/QWebElement>
 #include <QtWebKitWidgets/QWebPage>
 
@@ -44,16 +45,15 @@ public:
 	void runUserScripts(const QUrl &url) const;
 	bool isErrorPage() const;
 
-protected:
-	void applyContentBlockingRules(const QStringList &rules, bool remove);
-
 protected slots:
+	void applyContentBlockingRules();
 	void handleErrorPageChanged(QWebFrame *frame, bool isErrorPage);
 	void handleLoadFinished();
 
 private:
 	QWebFrame *m_frame;
 	QtWebKitWebWidget *m_widget;
+	QFutureWatcher<QString> *m_styleSheetWatcher;
 	bool m_isErrorPage;
 };
 
@@ -112,6 +112,7 @@ bool OperaSessionImporter::import(const QString &path)
 	session.title = QFileInfo(path).completeBaseName();
 
 	const int windowCount(originalSession.getValue(QLatin1String("window count")).toInt());
+	const int defaultZoom(SessionsManager::getDefaults().zoom);
 
 	for (int i = 1; i <= windowCount; ++i)
 	{
@@ -195,6 +196,7 @@ bool OperaSessionImporter::import(const QString &path)
 			{
 				WindowHistoryEntry entry;
 				entry.url = QLatin1String("about:") + panel.toLower();
+				entry.zoom = defaultZoom;
 
 				window.history.append(entry);
 
@@ -226,7 +228,10 @@ bool OperaSessionImporter::import(const QString &path)
 
 		if (originalSession.getValue(QLatin1String("has speeddial in history")).toInt())
 		{
-			window.history.prepend(WindowHistoryEntry());
+			WindowHistoryEntry entry;
+			entry.zoom = defaultZoom;
+
+			window.history.prepend(entry);
 
 			window.historyIndex = (window.historyIndex + 1);
 		}
@@ -31,6 +31,7 @@
 #include <QtCore/QDateTime>
 #include <QtCore/QMimeDatabase>
 #include <QtCore/QTimer>
+#include <QtCore/QTimerEvent>
 #include <QtGui/QClipboard>
 #include <QtGui/QMouseEvent>
 #include <QtWidgets/QMenu>
@@ -40,6 +41,8 @@ namespace Otter
 
 CacheContentsWidget::CacheContentsWidget(const QVariantMap &parameters, Window *window) : ContentsWidget(parameters, window),
 	m_model(new QStandardItemModel(this)),
+	m_populateTimer(0),
+	m_populatedEntriesAmount(0),
 	m_isLoading(true),
 	m_ui(new Ui::CacheContentsWidget)
 {
@@ -68,6 +71,46 @@ CacheContentsWidget::~CacheContentsWidget()
 	delete m_ui;
 }
 
+void CacheContentsWidget::timerEvent(QTimerEvent *event)
+{
+	if (event->timerId() != m_populateTimer)
+	{
+		ContentsWidget::timerEvent(event);
+
+		return;
+	}
+
+	const int limit(qMin((m_populatedEntriesAmount + 500), m_pendingEntries.count()));
+
+	for (int i = m_populatedEntriesAmount; i < limit; ++i)
+	{
+		addEntry(m_pendingEntries.at(i));
+	}
+
+	m_populatedEntriesAmount = limit;
+
+	if (m_populatedEntriesAmount < m_pendingEntries.count())
+	{
+		emit pageInformationChanged(WebWidget::DocumentLoadingProgressInformation, getPageInformation(WebWidget::DocumentLoadingProgressInformation));
+
+		return;
+	}
+
+	killTimer(m_populateTimer);
+
+	m_populateTimer = 0;
+	m_populatedEntriesAmount = 0;
+
+	m_pendingEntries.clear();
+
+	m_model->sort(0);
+
+	m_isLoading = false;
+
+	emit pageInformationChanged(WebWidget::DocumentLoadingProgressInformation, 100);
+	emit loadingStateChanged(WebWidget::FinishedLoadingState);
+}
+
 void CacheContentsWidget::changeEvent(QEvent *event)
 {
 	ContentsWidget::changeEvent(event);
@@ -114,50 +157,81 @@ void CacheContentsWidget::populateCache()
 	m_model->setHorizontalHeaderLabels(QStringList({tr("Address"), tr("Type"), tr("Size"), tr("Last Modified"), tr("Expires")}));
 	m_model->setSortRole(Qt::DisplayRole);
 
-	const NetworkCache *cache(NetworkManagerFactory::getCache());
-	const QVector<QUrl> entries(cache->getEntries());
-
-	for (int i = 0; i < entries.count(); ++i)
-	{
-		addEntry(entries.at(i));
-	}
+	m_domains.clear();
+	m_entries.clear();
 
-	m_model->sort(0);
+	NetworkCache *cache(NetworkManagerFactory::getCache());
 
-	if (m_isLoading)
+	if (m_ui->cacheViewWidget->getSourceModel() != m_model)
 	{
 		m_ui->cacheViewWidget->setModel(m_model);
 		m_ui->cacheViewWidget->setLayoutDirection(Qt::LeftToRight);
 		m_ui->cacheViewWidget->setFilterRoles(QSet<int>({Qt::DisplayRole, Qt::UserRole}));
 
-		m_isLoading = false;
-
-		emit loadingStateChanged(WebWidget::FinishedLoadingState);
-
 		connect(cache, SIGNAL(cleared()), this, SLOT(populateCache()));
+		connect(cache, SIGNAL(indexReady()), this, SLOT(populateCache()));
 		connect(cache, SIGNAL(entryAdded(QUrl)), this, SLOT(addEntry(QUrl)));
 		connect(cache, SIGNAL(entryRemoved(QUrl)), this, SLOT(removeEntry(QUrl)));
 		connect(m_model, SIGNAL(modelReset()), this, SLOT(updateActions()));
 		connect(m_ui->cacheViewWidget, SIGNAL(needsActionsUpdate()), this, SLOT(updateActions()));
 	}
+
+	if (!m_isLoading)
+	{
+		m_isLoading = true;
+
+		emit loadingStateChanged(WebWidget::OngoingLoadingState);
+	}
+
+	m_pendingEntries.clear();
+
+	m_populatedEntriesAmount = 0;
+
+	if (!cache->isIndexReady())
+	{
+		if (m_populateTimer != 0)
+		{
+			killTimer(m_populateTimer);
+
+			m_populateTimer = 0;
+		}
+
+		return;
+	}
+
+	m_pendingEntries = cache->getEntries();
+
+	if (m_populateTimer == 0)
+	{
+		m_populateTimer = startTimer(0);
+	}
 }
 
 void CacheContentsWidget::addEntry(const QUrl &entry)
 {
-	const QString domain(entry.host());
-	QStandardItem *domainItem(findDomain(domain));
+	if (m_entries.contains(entry))
+	{
+		return;
+	}
 
-	if (domainItem)
+	const NetworkCache *cache(NetworkManagerFactory::getCache());
+
+	if (sender() && !cache->isIndexReady())
 	{
-		for (int i = 0; i < domainItem->rowCount(); ++i)
-		{
-			if (domainItem->index().child(i, 0).data(Qt::UserRole).toUrl() == entry)
-			{
-				return;
-			}
-		}
+		return;
 	}
-	else
+
+	const NetworkCache::EntryInformation information(cache->getEntry(entry));
+
+	if (!information.url.isValid())
+	{
+		return;
+	}
+
+	const QString domain(entry.host());
+	QStandardItem *domainItem(m_domains.value(domain));
+
+	if (!domainItem)
 	{
 		domainItem = new QStandardItem(HistoryManager::getIcon(QUrl(QStringLiteral("http://%1/").arg(domain))), domain);
 		domainItem->setToolTip(domain);
@@ -165,55 +239,40 @@ void CacheContentsWidget::addEntry(const QUrl &entry)
 		m_model->appendRow(domainItem);
 		m_model->setItem(domainItem->row(), 2, new QStandardItem(QString()));
 
-		if (sender())
-		{
-			m_model->sort(0);
-		}
-	}
+		m_domains[domain] = domainItem;
 
-	NetworkCache *cache(NetworkManagerFactory::getCache());
-	QIODevice *device(cache->data(entry));
-	const QNetworkCacheMetaData metaData(cache->metaData(entry));
-	const QList<QPair<QByteArray, QByteArray> > headers(metaData.rawHeaders());
-	QString type;
-
-	for (int i = 0; i < headers.count(); ++i)
-	{
-		if (headers.at(i).first == QStringLiteral("Content-Type").toLatin1())
+		if (sender() && !m_isLoading)
 		{
-			type = QString(headers.at(i).second);
-
-			break;
+			m_model->sort(0);
 		}
 	}
 
-	const QMimeType mimeType((type.isEmpty() && device) ? QMimeDatabase().mimeTypeForData(device) : QMimeDatabase().mimeTypeForName(type));
-	QList<QStandardItem*> entryItems({new QStandardItem(entry.path()), new QStandardItem(mimeType.name()), new QStandardItem(device ? Utils::formatUnit(device->size()) : QString()), new QStandardItem(Utils::formatDateTime(metaData.lastModified())), new QStandardItem(Utils::formatDateTime(metaData.expirationDate()))});
+	QList<QStandardItem*> entryItems({new QStandardItem(entry.path()), new QStandardItem(information.contentType), new QStandardItem((information.size > 0) ? Utils::formatUnit(information.size) : QString()), new QStandardItem(Utils::formatDateTime(information.lastModified)), new QStandardItem(Utils::formatDateTime(information.expirationDate))});
 	entryItems[0]->setData(entry, Qt::UserRole);
 	entryItems[0]->setFlags(entryItems[0]->flags() | Qt::ItemNeverHasChildren);
 	entryItems[1]->setFlags(entryItems[1]->flags() | Qt::ItemNeverHasChildren);
-	entryItems[2]->setData((device ? device->size() : 0), Qt::UserRole);
+	entryItems[2]->setData(information.size, Qt::UserRole);
 	entryItems[2]->setFlags(entryItems[2]->flags() | Qt::ItemNeverHasChildren);
 	entryItems[3]->setFlags(entryItems[3]->flags() | Qt::ItemNeverHasChildren);
 	entryItems[4]->setFlags(entryItems[4]->flags() | Qt::ItemNeverHasChildren);
 
-	if (device)
+	if (information.size > 0)
 	{
 		QStandardItem *sizeItem(m_model->item(domainItem->row(), 2));
 
 		if (sizeItem)
 		{
-			sizeItem->setData((sizeItem->data(Qt::UserRole).toLongLong() + device->size()), Qt::UserRole);
+			sizeItem->setData((sizeItem->data(Qt::UserRole).toLongLong() + information.size), Qt::UserRole);
 			sizeItem->setText(Utils::formatUnit(sizeItem->data(Qt::UserRole).toLongLong()));
 		}
-
-		device->deleteLater();
 	}
 
 	domainItem->appendRow(entryItems);
 	domainItem->setText(QStringLiteral("%1 (%2)").arg(domain).arg(domainItem->rowCount()));
 
-	if (sender())
+	m_entries[entry] = entryItems[0];
+
+	if (sender() && !m_isLoading)
 	{
 		domainItem->sortChildren(0, Qt::DescendingOrder);
 	}
@@ -221,7 +280,7 @@ void CacheContentsWidget::addEntry(const QUrl &entry)
 
 void CacheContentsWidget::removeEntry(const QUrl &entry)
 {
-	QStandardItem *entryItem(findEntry(entry));
+	QStandardItem *entryItem(m_entries.take(entry));
 
 	if (entryItem)
 	{
@@ -235,6 +294,8 @@ void CacheContentsWidget::removeEntry(const QUrl &entry)
 
 			if (domainItem->rowCount() == 0)
 			{
+				m_domains.remove(entry.host());
+
 				m_model->invisibleRootItem()->removeRow(domainItem->row());
 			}
 			else
@@ -487,37 +548,12 @@ void CacheContentsWidget::updateActions()
 
 QStandardItem* CacheContentsWidget::findDomain(const QString &domain)
 {
-	for (int i = 0; i < m_model->rowCount(); ++i)
-	{
-		QStandardItem *domainItem(m_model->item(i, 0));
-
-		if (domainItem && domain == domainItem->toolTip())
-		{
-			return domainItem;
-		}
-	}
-
-	return nullptr;
+	return m_domains.value(domain, nullptr);
 }
 
 QStandardItem* CacheContentsWidget::findEntry(const QUrl &entry)
 {
-	for (int i = 0; i < m_model->rowCount(); ++i)
-	{
-		const QModelIndex domainIndex(m_model->index(i, 0));
-
-		for (int j = 0; j < m_model->rowCount(domainIndex); ++j)
-		{
-			const QModelIndex index(domainIndex.child(j, 0));
-
-			if (index.data(Qt::UserRole).toUrl() == entry)
-			{
-				return m_model->itemFromIndex(index);
-			}
-		}
-	}
-
-	return nullptr;
+	return m_entries.value(entry, nullptr);
 }
 
 Action* CacheContentsWidget::createAction(int identifier, const QVariantMap parameters, bool followState)
@@ -554,6 +590,21 @@ QLatin1String CacheContentsWidget::getType() const
 	return QLatin1String("cache");
 }
 
+QVariant CacheContentsWidget::getPageInformation(WebWidget::PageInformation key) const
+{
+	if (key == WebWidget::DocumentLoadingProgressInformation || key == WebWidget::TotalLoadingProgressInformation)
+	{
+		if (!m_isLoading)
+		{
+			return 100;
+		}
+
+		return (m_pendingEntries.isEmpty() ? 0 : ((m_populatedEntriesAmount * 100) / m_pendingEntries.count()));
+	}
+
+	return ContentsWidget::getPageInformation(key);
+}
+
 QUrl CacheContentsWidget::getUrl() const
 {
 	return QUrl(QLatin1String("about:cache"));
@@ -46,6 +46,7 @@ public:
 	Action* createAction(int identifier, const QVariantMap parameters = {}, bool followState = true) override;
 	QString getTitle() const override;
 	QLatin1String getType() const override;
+	QVariant getPageInformation(WebWidget::PageInformation key) const override;
 	QUrl getUrl() const override;
 	QIcon getIcon() const override;
 	WebWidget::LoadingState getLoadingState() const override;
@@ -55,6 +56,7 @@ public slots:
 	void triggerAction(int identifier, const QVariantMap &parameters = {}) override;
 
 protected:
+	void timerEvent(QTimerEvent *event) override;
 	void changeEvent(QEvent *event) override;
 	QStandardItem* findDomain(const QString &domain);
 	QStandardItem* findEntry(const QUrl &entry);
@@ -74,7 +76,12 @@ protected slots:
 
 private:
 	QStandardItemModel *m_model;
+	QVector<QUrl> m_pendingEntries;
+	QHash<QString, QStandardItem*> m_domains;
+	QHash<QUrl, QStandardItem*> m_entries;
 	QHash<int, Action*> m_actions;
+	int m_populateTimer;
+	int m_populatedEntriesAmount;
 	bool m_isLoading;
 	Ui::CacheContentsWidget *m_ui;
 };
@@ -138,6 +138,8 @@ void CookiesContentsWidget::addCookie(const QNetworkCookie &cookie)
 
 		m_model->appendRow(domainItem);
 
+		m_domains[domain] = domainItem;
+
 		if (sender())
 		{
 			m_model->sort(0);
@@ -176,6 +178,8 @@ void CookiesContentsWidget::removeCookie(const QNetworkCookie &cookie)
 
 		if (domainItem->rowCount() == 0)
 		{
+			m_domains.remove(domain);
+
 			m_model->invisibleRootItem()->removeRow(domainItem->row());
 		}
 		else
@@ -425,15 +429,7 @@ void CookiesContentsWidget::updateActions()
 
 QStandardItem* CookiesContentsWidget::findDomain(const QString &domain)
 {
-	for (int i = 0; i < m_model->rowCount(); ++i)
-	{
-		if (domain == m_model->item(i, 0)->toolTip())
-		{
-			return m_model->item(i, 0);
-		}
-	}
-
-	return nullptr;
+	return m_domains.value(domain, nullptr);
 }
 
 Action* CookiesContentsWidget::createAction(int identifier, const QVariantMap parameters, bool followState)
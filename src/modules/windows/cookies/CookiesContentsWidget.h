@@ -74,6 +74,7 @@ protected slots:
 
 private:
 	QStandardItemModel *m_model;
+	QHash<QString, QStandardItem*> m_domains;
 	QHash<int, Action*> m_actions;
 	bool m_isLoading;
 	Ui::CookiesContentsWidget *m_ui;
@@ -32,6 +32,7 @@
 #include <QtGui/QClipboard>
 #include <QtGui/QKeyEvent>
 #include <QtWidgets/QApplication>
+#include <QtWidgets/QInputDialog>
 #include <QtWidgets/QMenu>
 #include <QtWidgets/QMessageBox>
 #include <QtWidgets/QProgressBar>
@@ -278,7 +279,20 @@ void TransfersContentsWidget::updateTransfer(Transfer *transfer)
 
 				break;
 			case 5:
-				m_model->setData(index, ((transfer->getState() == Transfer::RunningState) ? Utils::formatUnit(transfer->getSpeed(), true, 1) : QString()), Qt::DisplayRole);
+				if (transfer->getState() == Transfer::RunningState)
+				{
+					const int segmentsAmount(transfer->getActiveSegmentsAmount());
+
+					m_model->setData(index, ((segmentsAmount > 1) ? tr("%1 (%n connection(s))", "", segmentsAmount).arg(Utils::formatUnit(transfer->getSpeed(), true, 1)) : Utils::formatUnit(transfer->getSpeed(), true, 1)), Qt::DisplayRole);
+				}
+				else if (transfer->getState() == Transfer::QueuedState)
+				{
+					m_model->setData(index, tr("Queued"), Qt::DisplayRole);
+				}
+				else
+				{
+					m_model->setData(index, QString(), Qt::DisplayRole);
+				}
 
 				break;
 			case 6:
@@ -382,7 +396,7 @@ void TransfersContentsWidget::stopResumeTransfer()
 
 	if (transfer)
 	{
-		if (transfer->getState() == Transfer::RunningState)
+		if (transfer->getState() == Transfer::RunningState || transfer->getState() == Transfer::QueuedState)
 		{
 			transfer->stop();
 		}
@@ -405,6 +419,24 @@ void TransfersContentsWidget::redownloadTransfer()
 	}
 }
 
+void TransfersContentsWidget::setTransferSpeedLimit()
+{
+	Transfer *transfer(getTransfer(m_ui->transfersViewWidget->getCurrentIndex()));
+
+	if (!transfer)
+	{
+		return;
+	}
+
+	bool isConfirmed(false);
+	const int limit(QInputDialog::getInt(this, tr("Speed Limit"), tr("Maximum speed in KiB/s (0 for unlimited):"), static_cast<int>(transfer->getSpeedLimit() / 1024), 0, 2147483647, 1, &isConfirmed));
+
+	if (isConfirmed)
+	{
+		transfer->setSpeedLimit(static_cast<qint64>(limit) * 1024);
+	}
+}
+
 void TransfersContentsWidget::startQuickTransfer()
 {
 	TransfersManager::startTransfer(m_ui->downloadLineEdit->text(), QString(), (Transfer::CanNotifyOption | Transfer::IsQuickTransferOption | (SessionsManager::isPrivate() ? Transfer::IsPrivateOption : Transfer::NoOption)));
@@ -447,8 +479,9 @@ void TransfersContentsWidget::showContextMenu(const QPoint &position)
 
 		menu.addAction(tr("Open Folder"), this, SLOT(openTransferFolder()));
 		menu.addSeparator();
-		menu.addAction(((transfer->getState() == Transfer::ErrorState) ? tr("Resume") : tr("Stop")), this, SLOT(stopResumeTransfer()))->setEnabled(transfer->getState() == Transfer::RunningState || transfer->getState() == Transfer::ErrorState);
+		menu.addAction(((transfer->getState() == Transfer::ErrorState) ? tr("Resume") : tr("Stop")), this, SLOT(stopResumeTransfer()))->setEnabled(transfer->getState() == Transfer::RunningState || transfer->getState() == Transfer::ErrorState || transfer->getState() == Transfer::QueuedState);
 		menu.addAction(tr("Redownload"), this, SLOT(redownloadTransfer()));
+		menu.addAction(tr("Set Speed Limit…"), this, SLOT(setTransferSpeedLimit()))->setEnabled(transfer->getState() != Transfer::FinishedState && transfer->getState() != Transfer::CancelledState);
 		menu.addSeparator();
 		menu.addAction(tr("Copy Transfer Information"), this, SLOT(copyTransferInformation()));
 		menu.addSeparator();
@@ -485,7 +518,7 @@ void TransfersContentsWidget::updateActions()
 		m_ui->stopResumeButton->setIcon(ThemesManager::createIcon(QLatin1String("task-reject")));
 	}
 
-	m_ui->stopResumeButton->setEnabled(transfer && (transfer->getState() == Transfer::RunningState || transfer->getState() == Transfer::ErrorState));
+	m_ui->stopResumeButton->setEnabled(transfer && (transfer->getState() == Transfer::RunningState || transfer->getState() == Transfer::ErrorState || transfer->getState() == Transfer::QueuedState));
 	m_ui->redownloadButton->setEnabled(transfer);
 
 	createAction(ActionsManager::CopyAction)->setEnabled(transfer);
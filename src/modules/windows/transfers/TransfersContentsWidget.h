@@ -87,6 +87,7 @@ protected slots:
 	void copyTransferInformation();
 	void stopResumeTransfer();
 	void redownloadTransfer();
+	void setTransferSpeedLimit();
 	void startQuickTransfer();
 	void clearFinishedTransfers();
 	void showContextMenu(const QPoint &position);
@@ -558,7 +558,7 @@ void MainWindow::triggerAction(int identifier, const QVariantMap &parameters)
 				}
 
 				const bool isReplacing(hints.testFlag(SessionsManager::CurrentTabOpen) && activeWindow);
-				const WindowState windowState(isReplacing ? activeWindow->getWindowState() : WindowState());
+				const WindowState windowState(isReplacing ? activeWindow->getWindowState() : SessionsManager::getDefaults().windowState);
 				const bool isAlwaysOnTop(isReplacing ? activeWindow->getSession().isAlwaysOnTop : false);
 
 				mutableParameters[QLatin1String("hints")] = QVariant(hints);
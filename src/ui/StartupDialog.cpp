@@ -174,6 +174,7 @@ SessionInformation StartupDialog::getSession() const
 	}
 	else
 	{
+		const SessionDefaults defaults(SessionsManager::getDefaults());
 		WindowHistoryEntry entry;
 
 		if (m_ui->homePageButton->isChecked())
@@ -189,7 +190,10 @@ SessionInformation StartupDialog::getSession() const
 			entry.url = QLatin1String("about:blank");
 		}
 
+		entry.zoom = defaults.zoom;
+
 		SessionWindow tab;
+		tab.state = defaults.windowState;
 		tab.history.append(entry);
 		tab.historyIndex = 0;
 